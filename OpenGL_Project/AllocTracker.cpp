@@ -0,0 +1,195 @@
+#include "AllocTracker.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace gps {
+
+    namespace {
+        std::atomic<unsigned long long> allocationCount(0);
+        std::atomic<unsigned long long> freeCount(0);
+        std::atomic<unsigned long long> allocatedBytes(0);
+
+        // fixed table, operator new must not allocate to record an allocation
+        struct ScopeCounter {
+            std::atomic<const char*> name;
+            std::atomic<unsigned long long> count;
+            std::atomic<unsigned long long> bytes;
+        };
+        ScopeCounter scopes[AllocTracker::MAX_SCOPES];
+        ScopeCounter otherScope;
+
+        thread_local const char* currentScope = "unscoped";
+
+        // scope names are string literals, so the pointer identifies them
+        ScopeCounter& findScope(const char* name)
+        {
+            for (int i = 0; i < AllocTracker::MAX_SCOPES; i++) {
+                const char* slotName = scopes[i].name.load(std::memory_order_acquire);
+                if (slotName == name) {
+                    return scopes[i];
+                }
+                if (slotName == NULL) {
+                    const char* expected = NULL;
+                    if (scopes[i].name.compare_exchange_strong(expected, name) || expected == name) {
+                        return scopes[i];
+                    }
+                }
+            }
+            return otherScope;
+        }
+
+        void* allocate(std::size_t size)
+        {
+            allocationCount.fetch_add(1, std::memory_order_relaxed);
+            allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+            ScopeCounter& scope = findScope(currentScope);
+            scope.count.fetch_add(1, std::memory_order_relaxed);
+            scope.bytes.fetch_add(size, std::memory_order_relaxed);
+
+            void* ptr = malloc(size == 0 ? 1 : size);
+            if (ptr == NULL) {
+                throw std::bad_alloc();
+            }
+            return ptr;
+        }
+
+        void release(void* ptr)
+        {
+            if (ptr != NULL) {
+                freeCount.fetch_add(1, std::memory_order_relaxed);
+                free(ptr);
+            }
+        }
+    }
+
+    unsigned long long AllocTracker::GetAllocationCount()
+    {
+        return allocationCount.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long AllocTracker::GetFreeCount()
+    {
+        return freeCount.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long AllocTracker::GetAllocatedBytes()
+    {
+        return allocatedBytes.load(std::memory_order_relaxed);
+    }
+
+    const char* AllocTracker::PushScope(const char* name)
+    {
+        const char* previous = currentScope;
+        currentScope = name;
+        return previous;
+    }
+
+    void AllocTracker::PopScope(const char* previous)
+    {
+        currentScope = previous;
+    }
+
+    // printf rather than iostreams, printing must not allocate either
+    void AllocTracker::PrintScopes()
+    {
+        for (int i = 0; i < MAX_SCOPES; i++) {
+            const char* name = scopes[i].name.load(std::memory_order_acquire);
+            if (name == NULL) {
+                break;
+            }
+            unsigned long long count = scopes[i].count.load(std::memory_order_relaxed);
+            if (count > 0) {
+                printf("  %-28s %llu allocations, %llu bytes\n", name, count, scopes[i].bytes.load(std::memory_order_relaxed));
+            }
+        }
+        if (otherScope.count.load(std::memory_order_relaxed) > 0) {
+            printf("  %-28s %llu allocations, %llu bytes\n", "other",
+                otherScope.count.load(std::memory_order_relaxed), otherScope.bytes.load(std::memory_order_relaxed));
+        }
+    }
+
+    void AllocTracker::ResetScopes()
+    {
+        for (int i = 0; i < MAX_SCOPES; i++) {
+            scopes[i].count.store(0, std::memory_order_relaxed);
+            scopes[i].bytes.store(0, std::memory_order_relaxed);
+        }
+        otherScope.count.store(0, std::memory_order_relaxed);
+        otherScope.bytes.store(0, std::memory_order_relaxed);
+    }
+
+    AllocScope::AllocScope(const char* name)
+    {
+        previous = AllocTracker::PushScope(name);
+    }
+
+    AllocScope::~AllocScope()
+    {
+        AllocTracker::PopScope(previous);
+    }
+}
+
+// global replacements, every container and string allocation goes through these
+
+void* operator new(std::size_t size)
+{
+    return gps::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return gps::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return gps::allocate(size);
+    }
+    catch (const std::bad_alloc&) {
+        return NULL;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return gps::allocate(size);
+    }
+    catch (const std::bad_alloc&) {
+        return NULL;
+    }
+}
+
+void operator delete(void* ptr) noexcept
+{
+    gps::release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    gps::release(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    gps::release(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    gps::release(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    gps::release(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    gps::release(ptr);
+}
@@ -0,0 +1,46 @@
+#ifndef AllocTracker_hpp
+#define AllocTracker_hpp
+
+// Attributes the heap allocations of the enclosing scope to name (a string
+// literal). Profiler scopes do this too, so most of the frame is covered.
+#define GPS_ALLOC_CONCAT_(a, b) a##b
+#define GPS_ALLOC_CONCAT(a, b) GPS_ALLOC_CONCAT_(a, b)
+#define GPS_ALLOC_SCOPE(name) gps::AllocScope GPS_ALLOC_CONCAT(allocScope, __LINE__)(name)
+
+namespace gps {
+
+    // Counts every call of the global operator new / delete. The replacement
+    // operators live in AllocTracker.cpp and forward to malloc / free; each
+    // allocation is also charged to the innermost named scope of its thread.
+    class AllocTracker
+    {
+    public:
+        // distinct scope names that can be attributed, later ones go to "other"
+        static const int MAX_SCOPES = 128;
+
+        // allocations since the program started
+        static unsigned long long GetAllocationCount();
+        static unsigned long long GetFreeCount();
+        static unsigned long long GetAllocatedBytes();
+
+        // makes name the current scope of the calling thread, returns the previous one
+        static const char* PushScope(const char* name);
+        static void PopScope(const char* previous);
+
+        // prints the scopes that allocated since the last reset
+        static void PrintScopes();
+        static void ResetScopes();
+    };
+
+    class AllocScope
+    {
+    public:
+        explicit AllocScope(const char* name);
+        ~AllocScope();
+
+    private:
+        const char* previous;
+    };
+}
+
+#endif /* AllocTracker_hpp */
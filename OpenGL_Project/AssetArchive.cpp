@@ -0,0 +1,342 @@
+#include "AssetArchive.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gps {
+
+    namespace {
+        unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        void WritePadding(std::ofstream& file, unsigned long long bytes)
+        {
+            static const char zeros[256] = {};
+            while (bytes > 0) {
+                std::streamsize chunk = (std::streamsize)std::min(bytes, (unsigned long long)sizeof(zeros));
+                file.write(zeros, chunk);
+                bytes -= chunk;
+            }
+        }
+    }
+
+    AssetArchive::AssetArchive()
+    {
+        mapping = NULL;
+        mappingSize = 0;
+        header = NULL;
+        slots = NULL;
+    }
+
+    AssetArchive::~AssetArchive()
+    {
+        Close();
+    }
+
+    bool AssetArchive::Open(const std::string& fileName)
+    {
+        GPS_PROFILE_SCOPE("AssetArchive::Open");
+        Close();
+        if (!Map(fileName)) {
+            return false;
+        }
+        if (!Validate()) {
+            std::cerr << fileName << " is not a valid asset archive" << std::endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    bool AssetArchive::IsOpen()
+    {
+        return mapping != NULL;
+    }
+
+    void AssetArchive::Close()
+    {
+        Unmap();
+        header = NULL;
+        slots = NULL;
+    }
+
+#ifdef _WIN32
+    bool AssetArchive::Map(const std::string& fileName)
+    {
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(Header)) {
+            CloseHandle(file);
+            return false;
+        }
+        // the view keeps the mapping and the file alive, both handles can go
+        HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (fileMapping == NULL) {
+            return false;
+        }
+        mapping = (const unsigned char*)MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(fileMapping);
+        if (mapping == NULL) {
+            return false;
+        }
+        mappingSize = (size_t)size.QuadPart;
+        return true;
+    }
+
+    void AssetArchive::Unmap()
+    {
+        if (mapping != NULL) {
+            UnmapViewOfFile(mapping);
+        }
+        mapping = NULL;
+        mappingSize = 0;
+    }
+#else
+    bool AssetArchive::Map(const std::string& fileName)
+    {
+        int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(Header)) {
+            close(file);
+            return false;
+        }
+        // the mapping keeps the file alive, the descriptor can go
+        void* view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        mapping = (const unsigned char*)view;
+        mappingSize = (size_t)status.st_size;
+        return true;
+    }
+
+    void AssetArchive::Unmap()
+    {
+        if (mapping != NULL) {
+            munmap((void*)mapping, mappingSize);
+        }
+        mapping = NULL;
+        mappingSize = 0;
+    }
+#endif
+
+    bool AssetArchive::Validate()
+    {
+        header = (const Header*)mapping;
+        if (header->magic != MAGIC || header->version != VERSION) {
+            return false;
+        }
+        unsigned long long slotCount = header->slotCount;
+        if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0 || header->entryCount > slotCount / 2
+            || slotCount > (mappingSize - sizeof(Header)) / sizeof(Slot)) {
+            return false;
+        }
+        slots = (const Slot*)(mapping + sizeof(Header));
+        unsigned int entries = 0;
+        for (unsigned long long i = 0; i < slotCount; i++) {
+            const Slot& slot = slots[i];
+            if (slot.nameLength == 0) {
+                continue;
+            }
+            entries++;
+            // written so that none of the sums can wrap
+            if (slot.nameOffset > mappingSize || slot.nameLength > mappingSize - slot.nameOffset
+                || slot.offset > mappingSize || slot.size > mappingSize - slot.offset) {
+                return false;
+            }
+        }
+        return entries == header->entryCount;
+    }
+
+    bool AssetArchive::Find(const std::string& path, const unsigned char*& data, size_t& size) const
+    {
+        if (mapping == NULL) {
+            return false;
+        }
+        std::string name = NormalizePath(path);
+        unsigned long long hash = Hash(name);
+        unsigned long long mask = header->slotCount - 1;
+        // at most half full, an empty slot always ends the probe
+        for (unsigned long long i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.nameLength == 0) {
+                return false;
+            }
+            if (slot.hash == hash && slot.nameLength == name.size()
+                && memcmp(mapping + slot.nameOffset, name.data(), name.size()) == 0) {
+                data = mapping + slot.offset;
+                size = (size_t)slot.size;
+                return true;
+            }
+        }
+    }
+
+    int AssetArchive::GetEntryCount() const
+    {
+        return header != NULL ? (int)header->entryCount : 0;
+    }
+
+    unsigned long long AssetArchive::Hash(const std::string& path)
+    {
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < path.size(); i++) {
+            hash ^= (unsigned char)path[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string AssetArchive::NormalizePath(const std::string& path)
+    {
+        std::string normalized = path;
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+        while (normalized.compare(0, 2, "./") == 0) {
+            normalized.erase(0, 2);
+        }
+        return normalized;
+    }
+
+    bool AssetArchive::Cook(const std::string& fileName, const std::vector<std::string>& files)
+    {
+        return Cook(fileName, files, std::vector<CookedFile>());
+    }
+
+    bool AssetArchive::Cook(const std::string& fileName, const std::vector<std::string>& files, const std::vector<CookedFile>& cooked)
+    {
+        GPS_PROFILE_SCOPE("AssetArchive::Cook");
+        std::vector<std::string> names;
+        // parallel to names, NULL for the files read from disk
+        std::vector<const CookedFile*> contents;
+        for (size_t i = 0; i < files.size(); i++) {
+            std::string name = NormalizePath(files[i]);
+            if (std::find(names.begin(), names.end(), name) == names.end()) {
+                names.push_back(name);
+                contents.push_back(NULL);
+            }
+        }
+        for (size_t i = 0; i < cooked.size(); i++) {
+            std::string name = NormalizePath(cooked[i].name);
+            if (std::find(names.begin(), names.end(), name) == names.end()) {
+                names.push_back(name);
+                contents.push_back(&cooked[i]);
+            }
+        }
+
+        Header archiveHeader;
+        archiveHeader.magic = MAGIC;
+        archiveHeader.version = VERSION;
+        archiveHeader.entryCount = (unsigned int)names.size();
+        archiveHeader.slotCount = 16;
+        while (archiveHeader.slotCount < archiveHeader.entryCount * 2) {
+            archiveHeader.slotCount *= 2;
+        }
+
+        // sizes first: every offset is known before anything is written
+        std::vector<unsigned long long> sizes(names.size());
+        unsigned long long namesOffset = sizeof(Header) + (unsigned long long)archiveHeader.slotCount * sizeof(Slot);
+        unsigned long long namesSize = 0;
+        for (size_t i = 0; i < names.size(); i++) {
+            namesSize += names[i].size();
+            if (contents[i] != NULL) {
+                sizes[i] = contents[i]->bytes.size();
+                continue;
+            }
+            std::ifstream file(names[i].c_str(), std::ios::binary | std::ios::ate);
+            if (!file.is_open()) {
+                std::cerr << "Could not open " << names[i] << std::endl;
+                return false;
+            }
+            sizes[i] = (unsigned long long)file.tellg();
+        }
+
+        std::vector<Slot> table(archiveHeader.slotCount);
+        memset(&table[0], 0, table.size() * sizeof(Slot));
+        std::vector<unsigned long long> offsets(names.size());
+        unsigned long long nameOffset = namesOffset;
+        unsigned long long blobOffset = AlignUp(namesOffset + namesSize, BLOB_ALIGNMENT);
+        unsigned long long mask = archiveHeader.slotCount - 1;
+        for (size_t i = 0; i < names.size(); i++) {
+            unsigned long long hash = Hash(names[i]);
+            unsigned long long index = hash & mask;
+            while (table[index].nameLength != 0) {
+                index = (index + 1) & mask;
+            }
+            Slot& slot = table[index];
+            slot.hash = hash;
+            slot.offset = blobOffset;
+            slot.size = sizes[i];
+            slot.nameOffset = nameOffset;
+            slot.nameLength = names[i].size();
+            offsets[i] = blobOffset;
+            nameOffset += names[i].size();
+            blobOffset = AlignUp(blobOffset + sizes[i], BLOB_ALIGNMENT);
+        }
+
+        std::ofstream archive(fileName.c_str(), std::ios::binary | std::ios::trunc);
+        if (!archive.is_open()) {
+            std::cerr << "Could not create " << fileName << std::endl;
+            return false;
+        }
+        archive.write((const char*)&archiveHeader, sizeof(archiveHeader));
+        archive.write((const char*)&table[0], (std::streamsize)(table.size() * sizeof(Slot)));
+        for (size_t i = 0; i < names.size(); i++) {
+            archive.write(names[i].data(), (std::streamsize)names[i].size());
+        }
+
+        unsigned long long written = namesOffset + namesSize;
+        std::vector<char> buffer;
+        for (size_t i = 0; i < names.size(); i++) {
+            WritePadding(archive, offsets[i] - written);
+            written = offsets[i] + sizes[i];
+            if (contents[i] != NULL) {
+                if (sizes[i] > 0) {
+                    archive.write((const char*)&contents[i]->bytes[0], (std::streamsize)sizes[i]);
+                }
+                continue;
+            }
+            buffer.resize((size_t)sizes[i]);
+            std::ifstream file(names[i].c_str(), std::ios::binary);
+            if (sizes[i] > 0 && !file.read(&buffer[0], (std::streamsize)sizes[i])) {
+                std::cerr << "Could not read " << names[i] << std::endl;
+                return false;
+            }
+            if (sizes[i] > 0) {
+                archive.write(&buffer[0], (std::streamsize)sizes[i]);
+            }
+        }
+        // the last blob is padded too, so every blob ends inside whole pages
+        WritePadding(archive, AlignUp(written, BLOB_ALIGNMENT) - written);
+
+        if (!archive) {
+            std::cerr << "Could not write " << fileName << std::endl;
+            return false;
+        }
+        std::cout << "Packed " << names.size() << " files into " << fileName << " ("
+            << AlignUp(written, BLOB_ALIGNMENT) / (1024 * 1024) << " MB)" << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef AssetArchive_hpp
+#define AssetArchive_hpp
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // a file made at cook time (prebuilt mip levels, say), archived like the others
+    struct CookedFile {
+        std::string name;
+        std::vector<unsigned char> bytes;
+    };
+
+    // One file holding every asset, mapped into memory once. Lookups hash the
+    // path into an open-addressed table of contents stored in the file, so
+    // finding an asset opens nothing and copies nothing: the loaders get a
+    // pointer into the mapping and the OS pages it in on first touch. Blobs
+    // start on page boundaries, so each one maps (and is read ahead) on its
+    // own pages.
+    //
+    // Layout, little endian:
+    //   header        magic "GPAK", version, entry count, slot count
+    //   slots         slotCount entries (a power of two, at most half full),
+    //                 probed linearly from hash & (slotCount - 1)
+    //   names         the paths of the entries, not terminated
+    //   blobs         file contents, each at a multiple of BLOB_ALIGNMENT
+    //
+    // Paths are relative to the working directory with forward slashes, as
+    // the application spells them ("textures/skybox/top.tga").
+    class AssetArchive
+    {
+    public:
+        static const unsigned int MAGIC = 0x4b415047;
+        static const unsigned int VERSION = 1;
+        static const size_t BLOB_ALIGNMENT = 4096;
+
+        AssetArchive();
+        ~AssetArchive();
+
+        bool Open(const std::string& fileName);
+        bool IsOpen();
+        void Close();
+
+        // points data at the contents of path inside the mapping; false when
+        // the archive does not hold it. Safe from any thread while open
+        bool Find(const std::string& path, const unsigned char*& data, size_t& size) const;
+        int GetEntryCount() const;
+
+        // writes files (read from disk) into a new archive
+        static bool Cook(const std::string& fileName, const std::vector<std::string>& files);
+        // the same plus files made in memory; a cooked file whose name is
+        // already taken is left out
+        static bool Cook(const std::string& fileName, const std::vector<std::string>& files, const std::vector<CookedFile>& cooked);
+        // FNV-1a of the path after NormalizePath
+        static unsigned long long Hash(const std::string& path);
+        // forward slashes, no leading "./"
+        static std::string NormalizePath(const std::string& path);
+
+    private:
+        struct Header {
+            unsigned int magic;
+            unsigned int version;
+            unsigned int entryCount;
+            unsigned int slotCount;
+        };
+
+        // an empty slot has nameLength 0
+        struct Slot {
+            unsigned long long hash;
+            unsigned long long offset;
+            unsigned long long size;
+            unsigned long long nameOffset;
+            unsigned long long nameLength;
+        };
+
+        const unsigned char* mapping;
+        size_t mappingSize;
+        const Header* header;
+        const Slot* slots;
+
+        bool Map(const std::string& fileName);
+        void Unmap();
+        // checks every slot points inside the mapping, so Find can trust them
+        bool Validate();
+    };
+}
+
+#endif /* AssetArchive_hpp */
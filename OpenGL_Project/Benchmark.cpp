@@ -0,0 +1,242 @@
+#include "Benchmark.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace gps {
+
+    namespace {
+        struct Summary {
+            double mean;
+            double p50;
+            double p95;
+            double p99;
+            double min;
+            double max;
+        };
+
+        // nearest-rank percentiles over the measured frames
+        Summary summarize(std::vector<double> values)
+        {
+            Summary summary = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+            if (values.empty()) {
+                return summary;
+            }
+            std::sort(values.begin(), values.end());
+
+            double total = 0.0;
+            for (size_t i = 0; i < values.size(); i++) {
+                total += values[i];
+            }
+            size_t last = values.size() - 1;
+            summary.mean = total / values.size();
+            summary.p50 = values[(size_t)(0.50 * last + 0.5)];
+            summary.p95 = values[(size_t)(0.95 * last + 0.5)];
+            summary.p99 = values[(size_t)(0.99 * last + 0.5)];
+            summary.min = values.front();
+            summary.max = values.back();
+            return summary;
+        }
+
+        void writeSummary(std::ofstream& file, const char* name, const Summary& summary, bool last)
+        {
+            file << "    \"" << name << "\": { \"mean\": " << summary.mean << ", \"p50\": " << summary.p50
+                << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+                << ", \"min\": " << summary.min << ", \"max\": " << summary.max << " }" << (last ? "\n" : ",\n");
+        }
+
+        std::string glString(GLenum name)
+        {
+            const GLubyte* value = glGetString(name);
+            std::string text = value ? std::string((const char*)value) : std::string();
+            // keep the JSON valid
+            std::replace(text.begin(), text.end(), '"', '\'');
+            std::replace(text.begin(), text.end(), '\\', '/');
+            return text;
+        }
+    }
+
+    Benchmark::Benchmark()
+    {
+        frames = 0;
+        warmupFrames = 0;
+        timeStep = 1.0 / 60.0;
+        frameIndex = 0;
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            queries[i] = 0;
+            queryFrame[i] = -1;
+        }
+    }
+
+    Benchmark::~Benchmark()
+    {
+        Delete();
+    }
+
+    void Benchmark::Init(int frames, int warmupFrames, double timeStep)
+    {
+        this->frames = frames;
+        this->warmupFrames = warmupFrames;
+        this->timeStep = timeStep;
+        this->frameIndex = 0;
+        samples.clear();
+        samples.reserve(frames);
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            passMs[p].clear();
+            passMs[p].reserve(frames);
+        }
+
+        glGenQueries(QUERY_COUNT, queries);
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            queryFrame[i] = -1;
+        }
+    }
+
+    void Benchmark::Delete()
+    {
+        if (queries[0] != 0) {
+            glDeleteQueries(QUERY_COUNT, queries);
+            for (int i = 0; i < QUERY_COUNT; i++) {
+                queries[i] = 0;
+            }
+        }
+    }
+
+    void Benchmark::BeginFrame()
+    {
+        frameStart = std::chrono::high_resolution_clock::now();
+
+        FrameSample sample = { 0.0, 0.0, -1.0, 0, 0 };
+        samples.push_back(sample);
+
+        // reuse the oldest query, reading it first if the GPU is slow to deliver
+        int slot = frameIndex % QUERY_COUNT;
+        if (queryFrame[slot] != -1) {
+            CollectQueries(true);
+        }
+        queryFrame[slot] = frameIndex;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+    }
+
+    void Benchmark::EndSubmit()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+
+        std::chrono::duration<double, std::milli> cpu = std::chrono::high_resolution_clock::now() - frameStart;
+        samples[frameIndex].cpuMs = cpu.count();
+        samples[frameIndex].drawCalls = Stats::GetCurrent(STAT_DRAW_CALLS);
+        samples[frameIndex].triangles = Stats::GetCurrent(STAT_TRIANGLES);
+    }
+
+    void Benchmark::EndFrame()
+    {
+        // present to present, so time spent outside BeginFrame/EndFrame is counted too
+        std::chrono::high_resolution_clock::time_point present = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> frame = present - (frameIndex == 0 ? frameStart : lastPresent);
+        samples[frameIndex].frameMs = frame.count();
+        lastPresent = present;
+
+        CollectQueries(false);
+        frameIndex++;
+    }
+
+    void Benchmark::CollectQueries(bool wait)
+    {
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            if (queryFrame[i] == -1) {
+                continue;
+            }
+            GLint available = GL_FALSE;
+            if (!wait) {
+                glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) {
+                    continue;
+                }
+            }
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+            samples[queryFrame[i]].gpuMs = elapsed / 1000000.0;
+            queryFrame[i] = -1;
+        }
+    }
+
+    void Benchmark::AddGpuPasses(const GpuFrameResult& result)
+    {
+        if ((int)result.frame < warmupFrames) {
+            return;
+        }
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            passMs[p].push_back(result.passMs[p]);
+        }
+    }
+
+    void Benchmark::Finish()
+    {
+        CollectQueries(true);
+    }
+
+    void Benchmark::PrintSummary()
+    {
+        std::vector<double> frameMs, cpuMs, gpuMs;
+        for (size_t i = warmupFrames; i < samples.size(); i++) {
+            frameMs.push_back(samples[i].frameMs);
+            cpuMs.push_back(samples[i].cpuMs);
+            gpuMs.push_back(samples[i].gpuMs);
+        }
+        Summary frame = summarize(frameMs);
+        Summary cpu = summarize(cpuMs);
+        Summary gpu = summarize(gpuMs);
+
+        std::cout << "Benchmark: " << frameMs.size() << " frames (" << warmupFrames << " warm-up skipped)\n"
+            << "  frame ms  mean " << frame.mean << "  p50 " << frame.p50 << "  p95 " << frame.p95 << "  p99 " << frame.p99 << "\n"
+            << "  cpu ms    mean " << cpu.mean << "  p50 " << cpu.p50 << "  p95 " << cpu.p95 << "  p99 " << cpu.p99 << "\n"
+            << "  gpu ms    mean " << gpu.mean << "  p50 " << gpu.p50 << "  p95 " << gpu.p95 << "  p99 " << gpu.p99 << std::endl;
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            Summary pass = summarize(passMs[p]);
+            std::cout << "    " << GpuTimer::GetName((GPU_PASS)p) << "  mean " << pass.mean << "  p95 " << pass.p95 << std::endl;
+        }
+    }
+
+    bool Benchmark::WriteReport(const std::string& fileName, int width, int height)
+    {
+        std::ofstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not write benchmark report " << fileName << std::endl;
+            return false;
+        }
+
+        std::vector<double> frameMs, cpuMs, gpuMs, drawCalls, triangles;
+        for (size_t i = warmupFrames; i < samples.size(); i++) {
+            frameMs.push_back(samples[i].frameMs);
+            cpuMs.push_back(samples[i].cpuMs);
+            gpuMs.push_back(samples[i].gpuMs);
+            drawCalls.push_back((double)samples[i].drawCalls);
+            triangles.push_back((double)samples[i].triangles);
+        }
+
+        file << "{\n"
+            << "  \"renderer\": \"" << glString(GL_RENDERER) << "\",\n"
+            << "  \"gl_version\": \"" << glString(GL_VERSION) << "\",\n"
+            << "  \"width\": " << width << ",\n"
+            << "  \"height\": " << height << ",\n"
+            << "  \"frames\": " << frameMs.size() << ",\n"
+            << "  \"warmup_frames\": " << warmupFrames << ",\n"
+            << "  \"time_step\": " << timeStep << ",\n"
+            << "  \"stats\": {\n";
+        writeSummary(file, "frame_ms", summarize(frameMs), false);
+        writeSummary(file, "cpu_ms", summarize(cpuMs), false);
+        writeSummary(file, "gpu_ms", summarize(gpuMs), false);
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            std::string name = std::string("gpu_") + GpuTimer::GetName((GPU_PASS)p) + "_ms";
+            writeSummary(file, name.c_str(), summarize(passMs[p]), false);
+        }
+        writeSummary(file, "draw_calls", summarize(drawCalls), false);
+        writeSummary(file, "triangles", summarize(triangles), true);
+        file << "  }\n}\n";
+
+        std::cout << "Benchmark report written to " << fileName << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include "GL/glew.h"
+#include "GpuTimer.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Runs a fixed number of frames at a fixed simulated time step and collects
+    // frame time (present to present), CPU submit time, GPU time, draw calls and triangles per frame.
+    // GPU times come from GL_TIME_ELAPSED queries that are only read once the
+    // result is available, so measuring does not stall the pipeline.
+    class Benchmark
+    {
+    public:
+        Benchmark();
+        ~Benchmark();
+
+        void Init(int frames, int warmupFrames, double timeStep);
+        void Delete();
+
+        // call before the first GL command of the frame
+        void BeginFrame();
+        // call once every command of the frame is issued (before the swap)
+        void EndSubmit();
+        // call after the swap
+        void EndFrame();
+
+        // adds the per-pass GPU times of a frame collected by the GpuTimer
+        void AddGpuPasses(const GpuFrameResult& result);
+
+        // waits for the outstanding GPU queries
+        void Finish();
+        void PrintSummary();
+        bool WriteReport(const std::string& fileName, int width, int height);
+
+    private:
+        static const int QUERY_COUNT = 4;
+
+        struct FrameSample {
+            // time since the previous frame's swap, the first frame counts from BeginFrame
+            double frameMs;
+            double cpuMs;
+            double gpuMs;
+            unsigned long long drawCalls;
+            unsigned long long triangles;
+        };
+
+        int frames;
+        int warmupFrames;
+        double timeStep;
+        int frameIndex;
+
+        std::chrono::high_resolution_clock::time_point frameStart;
+        std::chrono::high_resolution_clock::time_point lastPresent;
+        std::vector<FrameSample> samples;
+
+        // GL_TIME_ELAPSED ring, queryFrame[i] is the sample index it measures (-1 = free)
+        GLuint queries[QUERY_COUNT];
+        int queryFrame[QUERY_COUNT];
+
+        // per-pass GPU times of the measured frames, they arrive a few frames late
+        std::vector<double> passMs[GPU_PASS_COUNT];
+
+        void CollectQueries(bool wait);
+    };
+}
+
+#endif /* Benchmark_hpp */
@@ -21,26 +21,24 @@ namespace gps {
     //update the camera internal parameters following a camera move event
 	void Camera::move(MOVE_DIRECTION direction, float speed)
 	{
-		if (this->cameraPosition.y <= 1081949816 && this->cameraPosition.y >= -1065283000 && this->cameraPosition.x <= 1610612736 && this->cameraPosition.x >= -1073741824) {
-
-			glm::vec3 v = speed * cameraFrontDirection;
-			switch (direction) {
-			case MOVE_FORWARD:
-				cameraPosition += glm::vec3(v.x, 0.0f, v.z);
-				break;
-
-			case MOVE_BACKWARD:
-				cameraPosition -= glm::vec3(v.x, 0.0f, v.z);
-				break;
-
-			case MOVE_RIGHT:
-				cameraPosition += cameraRightDirection * speed;
-				break;
-
-			case MOVE_LEFT:
-				cameraPosition -= cameraRightDirection * speed;
-				break;
-			}
+		// the world streams around the camera, so there is nothing to clamp against
+		glm::vec3 v = speed * cameraFrontDirection;
+		switch (direction) {
+		case MOVE_FORWARD:
+			cameraPosition += glm::vec3(v.x, 0.0f, v.z);
+			break;
+
+		case MOVE_BACKWARD:
+			cameraPosition -= glm::vec3(v.x, 0.0f, v.z);
+			break;
+
+		case MOVE_RIGHT:
+			cameraPosition += cameraRightDirection * speed;
+			break;
+
+		case MOVE_LEFT:
+			cameraPosition -= cameraRightDirection * speed;
+			break;
 		}
 	}
 
@@ -55,4 +53,14 @@ namespace gps {
 
 		cameraRightDirection = glm::normalize(glm::cross(this->cameraFrontDirection, glm::vec3(0.0f, 1.0f, 0.0f)));
 	}
+
+    //return the camera position in world space
+    glm::vec3 Camera::getPosition() {
+        return cameraPosition;
+    }
+
+    //place the camera without changing where it looks (used by scripted paths)
+    void Camera::setPosition(glm::vec3 position) {
+        cameraPosition = position;
+    }
 }
\ No newline at end of file
@@ -23,6 +23,11 @@ namespace gps {
         //yaw - camera rotation around the y axis
         //pitch - camera rotation around the x axis
         void rotate(float pitch, float yaw);
+        //return the camera position relative to the floating origin (single
+        //precision); World::ToWorld gives the absolute world position
+        glm::vec3 getPosition();
+        //place the camera without changing where it looks (used by scripted paths)
+        void setPosition(glm::vec3 position);
         
     private:
         glm::vec3 cameraPosition;
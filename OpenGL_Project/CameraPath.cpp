@@ -0,0 +1,131 @@
+#include "CameraPath.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    namespace {
+        template <typename T>
+        T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+        {
+            float t2 = t * t;
+            float t3 = t2 * t;
+            return 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+        }
+    }
+
+    bool CameraPath::Load(const std::string& fileName)
+    {
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not open camera path " << fileName << std::endl;
+            return false;
+        }
+
+        keys.clear();
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream values(line);
+            CameraKey key;
+            if (!(values >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)) {
+                continue;
+            }
+            // a span has to have a length to be interpolated over
+            if (!keys.empty() && !(key.time > keys.back().time)) {
+                std::cerr << "Camera path " << fileName << ": key at " << key.time << " s is not after the previous one, skipped" << std::endl;
+                continue;
+            }
+            AddKey(key);
+        }
+        std::cout << "Camera path " << fileName << ": " << keys.size() << " keys, " << GetDuration() << " s" << std::endl;
+        return !keys.empty();
+    }
+
+    bool CameraPath::Save(const std::string& fileName)
+    {
+        std::ofstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not write camera path " << fileName << std::endl;
+            return false;
+        }
+        file << "# time x y z yaw pitch\n";
+        for (size_t i = 0; i < keys.size(); i++) {
+            file << keys[i].time << " " << keys[i].position.x << " " << keys[i].position.y << " " << keys[i].position.z
+                << " " << keys[i].yaw << " " << keys[i].pitch << "\n";
+        }
+        return true;
+    }
+
+    void CameraPath::CreateOrbit(float duration, float radius, float height)
+    {
+        keys.clear();
+        const int segments = 16;
+        for (int i = 0; i <= segments; i++) {
+            float fraction = (float)i / segments;
+            float angle = glm::radians(90.0f + 360.0f * fraction);
+
+            CameraKey key;
+            key.time = duration * fraction;
+            key.position = glm::vec3(radius * cos(angle), height, radius * sin(angle));
+            // look back at the center of the scene, the yaw keeps growing so it never wraps
+            key.yaw = glm::degrees(angle) + 180.0f;
+            key.pitch = -10.0f;
+            AddKey(key);
+        }
+    }
+
+    void CameraPath::AddKey(const CameraKey& key)
+    {
+        keys.push_back(key);
+    }
+
+    CameraKey CameraPath::Sample(float time)
+    {
+        if (keys.empty()) {
+            CameraKey key = { 0.0f, glm::vec3(0.0f, 0.0f, 3.0f), -90.0f, 0.0f };
+            return key;
+        }
+        if (time <= keys.front().time || keys.size() == 1) {
+            return keys.front();
+        }
+        if (time >= keys.back().time) {
+            return keys.back();
+        }
+
+        size_t i = 1;
+        while (keys[i].time < time) {
+            i++;
+        }
+        // segment keys[i - 1] -> keys[i], with clamped neighbours
+        const CameraKey& k0 = keys[i >= 2 ? i - 2 : 0];
+        const CameraKey& k1 = keys[i - 1];
+        const CameraKey& k2 = keys[i];
+        const CameraKey& k3 = keys[i + 1 < keys.size() ? i + 1 : i];
+        // keys added in code may repeat a time, the pose then steps
+        float span = k2.time - k1.time;
+        float t = span > 0.0f ? (time - k1.time) / span : 1.0f;
+
+        CameraKey result;
+        result.time = time;
+        result.position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        result.yaw = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+        result.pitch = catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+        return result;
+    }
+
+    float CameraPath::GetDuration()
+    {
+        return keys.empty() ? 0.0f : keys.back().time;
+    }
+
+    bool CameraPath::IsEmpty()
+    {
+        return keys.empty();
+    }
+}
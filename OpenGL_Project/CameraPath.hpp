@@ -0,0 +1,44 @@
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include "glm/glm.hpp"
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // camera pose at a point in time
+    struct CameraKey {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    // Timed camera keyframes sampled with a Catmull-Rom spline, used to replay
+    // the same flythrough in every benchmark run. Text format, one key per line:
+    // time x y z yaw pitch   (lines starting with # are comments)
+    // Key times have to increase from one line to the next.
+    class CameraPath
+    {
+    public:
+        bool Load(const std::string& fileName);
+        bool Save(const std::string& fileName);
+
+        // built-in orbit around the city, used when no path file is given
+        void CreateOrbit(float duration, float radius, float height);
+
+        void AddKey(const CameraKey& key);
+        // interpolated pose at time t (clamped to the path)
+        CameraKey Sample(float time);
+
+        float GetDuration();
+        bool IsEmpty();
+
+    private:
+        std::vector<CameraKey> keys;
+    };
+}
+
+#endif /* CameraPath_hpp */
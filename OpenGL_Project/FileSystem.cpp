@@ -0,0 +1,191 @@
+#include "FileSystem.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace gps {
+
+    namespace {
+        AssetArchive archive;
+        std::atomic<unsigned int> archiveReads(0);
+        std::atomic<unsigned int> looseReads(0);
+    }
+
+    const char* FileSystem::DEFAULT_ARCHIVE = "assets.pak";
+
+    FileData::FileData()
+    {
+        mapped = NULL;
+        mappedSize = 0;
+    }
+
+    const unsigned char* FileData::GetData() const
+    {
+        if (mapped != NULL) {
+            return mapped;
+        }
+        return bytes.empty() ? NULL : &bytes[0];
+    }
+
+    size_t FileData::GetSize() const
+    {
+        return mapped != NULL ? mappedSize : bytes.size();
+    }
+
+    bool FileData::IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+    bool FileData::IsMapped() const
+    {
+        return mapped != NULL;
+    }
+
+    bool FileSystem::Mount(const std::string& archiveFile)
+    {
+        if (!archive.Open(archiveFile)) {
+            return false;
+        }
+        std::cout << "Mounted " << archiveFile << ": " << archive.GetEntryCount() << " files" << std::endl;
+        return true;
+    }
+
+    void FileSystem::Unmount()
+    {
+        archive.Close();
+    }
+
+    bool FileSystem::IsMounted()
+    {
+        return archive.IsOpen();
+    }
+
+    bool FileSystem::ReadFile(const std::string& path, FileData& file)
+    {
+        file.mapped = NULL;
+        file.mappedSize = 0;
+        file.bytes.clear();
+        if (archive.Find(path, file.mapped, file.mappedSize)) {
+            archiveReads++;
+            return true;
+        }
+        file.mapped = NULL;
+
+        GPS_PROFILE_SCOPE("FileSystem::ReadLoose");
+        std::ifstream stream(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!stream.is_open()) {
+            return false;
+        }
+        std::streamoff size = stream.tellg();
+        if (size > 0) {
+            file.bytes.resize((size_t)size);
+            stream.seekg(0, std::ios::beg);
+            stream.read((char*)&file.bytes[0], size);
+        }
+        looseReads++;
+        return true;
+    }
+
+    bool FileSystem::ReadRange(const std::string& path, size_t offset, size_t size, FileData& file)
+    {
+        file.mapped = NULL;
+        file.mappedSize = 0;
+        file.bytes.clear();
+        const unsigned char* data;
+        size_t dataSize;
+        if (archive.Find(path, data, dataSize)) {
+            if (offset > dataSize || size > dataSize - offset) {
+                return false;
+            }
+            file.mapped = data + offset;
+            file.mappedSize = size;
+            archiveReads++;
+            return true;
+        }
+
+        GPS_PROFILE_SCOPE("FileSystem::ReadLoose");
+        std::ifstream stream(path.c_str(), std::ios::binary);
+        if (!stream.is_open()) {
+            return false;
+        }
+        file.bytes.resize(size);
+        stream.seekg((std::streamoff)offset, std::ios::beg);
+        if (size > 0 && !stream.read((char*)&file.bytes[0], (std::streamsize)size)) {
+            file.bytes.clear();
+            return false;
+        }
+        looseReads++;
+        return true;
+    }
+
+    std::vector<std::string> FileSystem::ListFiles(const std::vector<std::string>& directories)
+    {
+        std::vector<std::string> files;
+        for (size_t i = 0; i < directories.size(); i++) {
+            std::error_code error;
+            std::filesystem::recursive_directory_iterator entry(directories[i], error);
+            if (error) {
+                std::cerr << "Could not list " << directories[i] << std::endl;
+                continue;
+            }
+            for (; entry != std::filesystem::recursive_directory_iterator(); entry.increment(error)) {
+                if (entry->is_regular_file(error)) {
+                    files.push_back(entry->path().generic_string());
+                }
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    unsigned int FileSystem::GetArchiveReads()
+    {
+        return archiveReads;
+    }
+
+    unsigned int FileSystem::GetLooseReads()
+    {
+        return looseReads;
+    }
+
+    MemoryBuffer::MemoryBuffer(const unsigned char* data, size_t size)
+    {
+        // the get area is never written through, streambuf just wants char*
+        char* begin = (char*)data;
+        setg(begin, begin, begin + size);
+    }
+
+    MemoryBuffer::pos_type MemoryBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+    {
+        if ((which & std::ios_base::in) == 0) {
+            return pos_type(off_type(-1));
+        }
+        off_type position = offset;
+        if (direction == std::ios_base::cur) {
+            position += gptr() - eback();
+        }
+        else if (direction == std::ios_base::end) {
+            position += egptr() - eback();
+        }
+        if (position < 0 || position > egptr() - eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + position, egptr());
+        return pos_type(position);
+    }
+
+    MemoryBuffer::pos_type MemoryBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+    {
+        return seekoff(off_type(position), std::ios_base::beg, which);
+    }
+
+    MemoryStream::MemoryStream(const unsigned char* data, size_t size)
+        : MemoryBuffer(data, size), std::istream(static_cast<MemoryBuffer*>(this))
+    {
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef FileSystem_hpp
+#define FileSystem_hpp
+
+#include "AssetArchive.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // contents of one asset: a view into the mounted archive, or the bytes
+    // read from a loose file
+    class FileData
+    {
+    public:
+        FileData();
+
+        const unsigned char* GetData() const;
+        size_t GetSize() const;
+        bool IsEmpty() const;
+        // true when the data points into the archive, valid until Unmount
+        bool IsMapped() const;
+
+    private:
+        friend class FileSystem;
+        const unsigned char* mapped;
+        size_t mappedSize;
+        std::vector<unsigned char> bytes;
+    };
+
+    // Where the loaders read assets from. With an archive mounted, the files
+    // it holds are served straight from its mapping; anything else (or
+    // everything, without an archive) is read from the loose file as before.
+    class FileSystem
+    {
+    public:
+        // used when no archive is named and the file exists
+        static const char* DEFAULT_ARCHIVE;
+
+        // mount before anything loads and unmount after the last load; the
+        // lookups in between are safe from any thread
+        static bool Mount(const std::string& archiveFile);
+        static void Unmount();
+        static bool IsMounted();
+
+        // false when the file is neither in the archive nor on disk
+        static bool ReadFile(const std::string& path, FileData& file);
+        // size bytes from offset, for assets embedded in another file; false
+        // when the file is shorter
+        static bool ReadRange(const std::string& path, size_t offset, size_t size, FileData& file);
+
+        // the regular files below directories, with forward slashes and sorted,
+        // so a model's files end up next to each other in a cooked archive
+        static std::vector<std::string> ListFiles(const std::vector<std::string>& directories);
+
+        // files served from the archive and from disk since startup
+        static unsigned int GetArchiveReads();
+        static unsigned int GetLooseReads();
+    };
+
+    // read-only stream over memory, for the parsers that want an std::istream
+    // without the copy into an std::istringstream
+    class MemoryBuffer : public std::streambuf
+    {
+    public:
+        MemoryBuffer(const unsigned char* data, size_t size);
+
+    protected:
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which);
+        pos_type seekpos(pos_type position, std::ios_base::openmode which);
+    };
+
+    class MemoryStream : private MemoryBuffer, public std::istream
+    {
+    public:
+        MemoryStream(const unsigned char* data, size_t size);
+    };
+}
+
+#endif /* FileSystem_hpp */
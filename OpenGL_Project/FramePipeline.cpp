@@ -0,0 +1,106 @@
+#include "FramePipeline.hpp"
+#include "Profiler.hpp"
+
+#include <chrono>
+
+namespace gps {
+
+    FramePipeline::FramePipeline()
+    {
+        writeIndex = 0;
+        readIndex = 0;
+        filled = 0;
+        stopped = false;
+        producerWaitMs = 0.0f;
+        consumerWaitMs = 0.0f;
+    }
+
+    FramePacket* FramePipeline::BeginWrite()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (filled == 2 && !stopped) {
+            GPS_PROFILE_SCOPE("WaitForFreePacket");
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            while (filled == 2 && !stopped) {
+                changed.wait(lock);
+            }
+            std::chrono::duration<float, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+            producerWaitMs = waited.count();
+        }
+        else {
+            producerWaitMs = 0.0f;
+        }
+        if (stopped) {
+            return NULL;
+        }
+        return &packets[writeIndex];
+    }
+
+    void FramePipeline::EndWrite()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writeIndex = 1 - writeIndex;
+            filled++;
+        }
+        changed.notify_all();
+    }
+
+    const FramePacket* FramePipeline::BeginRead()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (filled == 0 && !stopped) {
+            GPS_PROFILE_SCOPE("WaitForPacket");
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            while (filled == 0 && !stopped) {
+                changed.wait(lock);
+            }
+            std::chrono::duration<float, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+            consumerWaitMs = waited.count();
+        }
+        else {
+            consumerWaitMs = 0.0f;
+        }
+        if (filled == 0) {
+            return NULL;
+        }
+        return &packets[readIndex];
+    }
+
+    void FramePipeline::EndRead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readIndex = 1 - readIndex;
+            filled--;
+        }
+        changed.notify_all();
+    }
+
+    void FramePipeline::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        changed.notify_all();
+    }
+
+    bool FramePipeline::IsStopped()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stopped;
+    }
+
+    float FramePipeline::GetProducerWaitMs()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return producerWaitMs;
+    }
+
+    float FramePipeline::GetConsumerWaitMs()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return consumerWaitMs;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef FramePipeline_hpp
+#define FramePipeline_hpp
+
+#include "ResidencyManager.hpp"
+#include "Scene.hpp"
+
+#include "glm/glm.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace gps {
+
+    // Everything the render thread needs to draw one frame, produced by the
+    // simulation and not modified after it is handed over.
+    struct FramePacket {
+        unsigned int frameIndex;
+        // final view matrix, presentation mode included
+        glm::mat4 view;
+        // direction towards the light, world space
+        glm::vec3 lightDir;
+        // entities that survived culling, sorted by pass; the vector keeps
+        // its capacity between frames so the steady state does not allocate
+        std::vector<DrawItem> drawItems;
+        // items actually drawn, drawItems clamped to the object stream size
+        int drawCount;
+        // meshes of visible entities left out by frustum culling
+        unsigned int culledMeshes;
+
+        // mode toggles
+        int fog;
+        int sceneMode;
+        bool showOverlay;
+
+        int framebufferWidth;
+        int framebufferHeight;
+        // CPU time spent simulating and building the packet
+        float simulationMs;
+        // world matrices the scene recomputed for this frame
+        int transformsUpdated;
+        ResidencyStats residency;
+        int streamedTiles;
+        int worldTiles;
+    };
+
+    // Two packet slots shared by one producer (simulation) and one consumer
+    // (render thread): the simulation fills the next packet while the previous
+    // one is drawn, and blocks only when it gets a whole frame ahead.
+    class FramePipeline
+    {
+    public:
+        FramePipeline();
+
+        // returns the slot to fill, waits while both slots are taken (NULL after Stop)
+        FramePacket* BeginWrite();
+        // publishes the packet returned by BeginWrite
+        void EndWrite();
+
+        // returns the oldest published packet, waits for one to arrive
+        // (NULL once stopped and every published packet was read)
+        const FramePacket* BeginRead();
+        // frees the packet returned by BeginRead
+        void EndRead();
+
+        // wakes both sides; packets already published are still delivered
+        void Stop();
+        bool IsStopped();
+
+        // time the last BeginWrite / BeginRead spent blocked, in milliseconds
+        float GetProducerWaitMs();
+        float GetConsumerWaitMs();
+
+    private:
+        FramePacket packets[2];
+        int writeIndex;
+        int readIndex;
+        // published packets not yet freed by EndRead
+        int filled;
+        bool stopped;
+
+        float producerWaitMs;
+        float consumerWaitMs;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+    };
+}
+
+#endif /* FramePipeline_hpp */
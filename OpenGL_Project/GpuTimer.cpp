@@ -0,0 +1,194 @@
+#include "GpuTimer.hpp"
+#include "Profiler.hpp"
+
+namespace gps {
+
+    namespace {
+        const char* passNames[GPU_PASS_COUNT] = {
+            "grass",
+            "skybox",
+            "city",
+            "vehicles"
+        };
+    }
+
+    GpuTimer::GpuTimer()
+    {
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            slots[i].pending = false;
+        }
+        frameIndex = 0;
+        currentSlot = -1;
+        created = false;
+        resultCount = 0;
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            lastPassMs[p] = 0.0;
+        }
+        droppedFrames = 0;
+        clockOffset = 0;
+    }
+
+    GpuTimer::~GpuTimer()
+    {
+        Delete();
+    }
+
+    void GpuTimer::Create()
+    {
+        Delete();
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            glGenQueries(GPU_PASS_COUNT * 2, &slots[i].queries[0][0]);
+            slots[i].pending = false;
+        }
+        frameIndex = 0;
+        currentSlot = -1;
+        resultCount = 0;
+        droppedFrames = 0;
+        created = true;
+        Calibrate();
+    }
+
+    void GpuTimer::Delete()
+    {
+        if (!created) {
+            return;
+        }
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            glDeleteQueries(GPU_PASS_COUNT * 2, &slots[i].queries[0][0]);
+        }
+        created = false;
+    }
+
+    // maps GPU timestamps onto the profiler clock for the trace
+    void GpuTimer::Calibrate()
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        clockOffset = Profiler::Now() - gpuNow;
+    }
+
+    void GpuTimer::BeginFrame()
+    {
+        if (!created) {
+            return;
+        }
+        // frames complete in order, stop at the first one still in flight
+        for (int i = 1; i <= FRAMES_IN_FLIGHT; i++) {
+            FrameQueries& slot = slots[(currentSlot + i + FRAMES_IN_FLIGHT) % FRAMES_IN_FLIGHT];
+            if (!slot.pending) {
+                continue;
+            }
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+            Collect(slot);
+        }
+
+        currentSlot = (currentSlot + 1) % FRAMES_IN_FLIGHT;
+        FrameQueries& slot = slots[currentSlot];
+        if (slot.pending) {
+            // the GPU is more than FRAMES_IN_FLIGHT frames behind, give up on this one
+            slot.pending = false;
+            droppedFrames++;
+        }
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            slot.issued[p] = false;
+        }
+        slot.lastQuery = 0;
+        slot.frame = frameIndex++;
+
+        // keep the trace aligned with the CPU clock over long sessions
+        if (frameIndex % 256 == 0) {
+            Calibrate();
+        }
+    }
+
+    void GpuTimer::BeginPass(GPU_PASS pass)
+    {
+        if (currentSlot < 0) {
+            return;
+        }
+        glQueryCounter(slots[currentSlot].queries[pass][0], GL_TIMESTAMP);
+    }
+
+    void GpuTimer::EndPass(GPU_PASS pass)
+    {
+        if (currentSlot < 0) {
+            return;
+        }
+        FrameQueries& slot = slots[currentSlot];
+        glQueryCounter(slot.queries[pass][1], GL_TIMESTAMP);
+        slot.issued[pass] = true;
+        slot.lastQuery = slot.queries[pass][1];
+    }
+
+    void GpuTimer::EndFrame()
+    {
+        if (currentSlot < 0) {
+            return;
+        }
+        FrameQueries& slot = slots[currentSlot];
+        slot.pending = slot.lastQuery != 0;
+    }
+
+    void GpuTimer::Collect(FrameQueries& slot)
+    {
+        GpuFrameResult result;
+        result.frame = slot.frame;
+        result.totalMs = 0.0;
+        for (int p = 0; p < GPU_PASS_COUNT; p++) {
+            result.passMs[p] = 0.0;
+            if (!slot.issued[p]) {
+                continue;
+            }
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(slot.queries[p][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(slot.queries[p][1], GL_QUERY_RESULT, &end);
+            result.passMs[p] = (end - begin) / 1000000.0;
+            result.totalMs += result.passMs[p];
+            lastPassMs[p] = result.passMs[p];
+            Profiler::RecordTrack("GPU", passNames[p], (long long)begin + clockOffset, (long long)end + clockOffset);
+        }
+        slot.pending = false;
+
+        // the oldest result is dropped when nobody reads them
+        if (resultCount == FRAMES_IN_FLIGHT) {
+            for (int i = 1; i < resultCount; i++) {
+                results[i - 1] = results[i];
+            }
+            resultCount--;
+        }
+        results[resultCount++] = result;
+    }
+
+    bool GpuTimer::PopResult(GpuFrameResult& result)
+    {
+        if (resultCount == 0) {
+            return false;
+        }
+        result = results[0];
+        for (int i = 1; i < resultCount; i++) {
+            results[i - 1] = results[i];
+        }
+        resultCount--;
+        return true;
+    }
+
+    double GpuTimer::GetPassMilliseconds(GPU_PASS pass)
+    {
+        return lastPassMs[pass];
+    }
+
+    unsigned int GpuTimer::GetDroppedFrames()
+    {
+        return droppedFrames;
+    }
+
+    const char* GpuTimer::GetName(GPU_PASS pass)
+    {
+        return passNames[pass];
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#include "GL/glew.h"
+
+namespace gps {
+
+    // logical passes of a frame, each timed separately on the GPU
+    enum GPU_PASS {
+        GPU_PASS_GRASS,
+        GPU_PASS_SKYBOX,
+        GPU_PASS_CITY,
+        GPU_PASS_VEHICLES,
+        GPU_PASS_COUNT
+    };
+
+    // GPU time of every pass of one finished frame (0 for passes that did not run)
+    struct GpuFrameResult {
+        unsigned int frame;
+        double passMs[GPU_PASS_COUNT];
+        double totalMs;
+    };
+
+    // Brackets each pass with a pair of GL_TIMESTAMP queries. The query objects
+    // form a pool FRAMES_IN_FLIGHT frames deep and are only read once
+    // GL_QUERY_RESULT_AVAILABLE says so, so timing never stalls the pipeline;
+    // results arrive a few frames late. Finished passes are also added to the
+    // profiler trace on a "GPU" track.
+    class GpuTimer
+    {
+    public:
+        static const int FRAMES_IN_FLIGHT = 4;
+
+        GpuTimer();
+        ~GpuTimer();
+
+        void Create();
+        void Delete();
+
+        // collects the frames the GPU has finished and opens a new query slot
+        void BeginFrame();
+        void BeginPass(GPU_PASS pass);
+        void EndPass(GPU_PASS pass);
+        void EndFrame();
+
+        // returns the oldest collected frame not handed out yet
+        bool PopResult(GpuFrameResult& result);
+        // newest collected value of a pass, in milliseconds
+        double GetPassMilliseconds(GPU_PASS pass);
+        // frames whose queries were still busy when their slot was needed again
+        unsigned int GetDroppedFrames();
+
+        static const char* GetName(GPU_PASS pass);
+
+    private:
+        struct FrameQueries {
+            // begin/end timestamp per pass
+            GLuint queries[GPU_PASS_COUNT][2];
+            bool issued[GPU_PASS_COUNT];
+            // end query of the last pass issued, its result arrives last
+            GLuint lastQuery;
+            unsigned int frame;
+            bool pending;
+        };
+
+        FrameQueries slots[FRAMES_IN_FLIGHT];
+        unsigned int frameIndex;
+        int currentSlot;
+        bool created;
+
+        // collected results waiting for PopResult
+        GpuFrameResult results[FRAMES_IN_FLIGHT];
+        int resultCount;
+        double lastPassMs[GPU_PASS_COUNT];
+        unsigned int droppedFrames;
+
+        // profiler time minus GPU time, in nanoseconds
+        long long clockOffset;
+
+        void Calibrate();
+        void Collect(FrameQueries& slot);
+    };
+}
+
+#endif /* GpuTimer_hpp */
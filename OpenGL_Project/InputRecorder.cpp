@@ -0,0 +1,176 @@
+#include "InputRecorder.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace gps {
+
+    namespace {
+        // file layout: magic, version, then packed events until the end of file
+        //   key:    u32 tick, f32 time, u8 type, i16 key, i16 scancode, u8 action, u8 mods
+        //   cursor: u32 tick, f32 time, u8 type, f64 x, f64 y
+        const char INPUT_MAGIC[4] = { 'G', 'P', 'S', 'I' };
+        // version 2 stamps events with simulation ticks instead of frames
+        const unsigned int INPUT_FILE_VERSION = 2;
+
+        template <typename T>
+        void writeValue(std::ofstream& file, T value)
+        {
+            file.write((const char*)&value, sizeof(T));
+        }
+
+        template <typename T>
+        bool readValue(std::ifstream& file, T& value)
+        {
+            file.read((char*)&value, sizeof(T));
+            return (bool)file;
+        }
+    }
+
+    InputRecorder::InputRecorder()
+    {
+        eventCount = 0;
+    }
+
+    InputRecorder::~InputRecorder()
+    {
+        End();
+    }
+
+    bool InputRecorder::Begin(const std::string& fileName)
+    {
+        file.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Could not write input log " << fileName << std::endl;
+            return false;
+        }
+        file.write(INPUT_MAGIC, sizeof(INPUT_MAGIC));
+        writeValue(file, INPUT_FILE_VERSION);
+        eventCount = 0;
+        return true;
+    }
+
+    void InputRecorder::End()
+    {
+        if (file.is_open()) {
+            file.close();
+            std::cout << "Input log: " << eventCount << " events recorded" << std::endl;
+        }
+    }
+
+    bool InputRecorder::IsRecording()
+    {
+        return file.is_open();
+    }
+
+    void InputRecorder::RecordKey(unsigned long long tick, float time, int key, int scancode, int action, int mods)
+    {
+        if (!file.is_open()) {
+            return;
+        }
+        writeValue(file, (unsigned int)tick);
+        writeValue(file, time);
+        writeValue(file, (unsigned char)INPUT_KEY);
+        writeValue(file, (short)key);
+        writeValue(file, (short)scancode);
+        writeValue(file, (unsigned char)action);
+        writeValue(file, (unsigned char)mods);
+        eventCount++;
+    }
+
+    void InputRecorder::RecordCursor(unsigned long long tick, float time, double x, double y)
+    {
+        if (!file.is_open()) {
+            return;
+        }
+        writeValue(file, (unsigned int)tick);
+        writeValue(file, time);
+        writeValue(file, (unsigned char)INPUT_CURSOR);
+        writeValue(file, x);
+        writeValue(file, y);
+        eventCount++;
+    }
+
+    InputReplay::InputReplay()
+    {
+        nextEvent = 0;
+        active = false;
+    }
+
+    bool InputReplay::Load(const std::string& fileName)
+    {
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Could not open input log " << fileName << std::endl;
+            return false;
+        }
+
+        char magic[4];
+        unsigned int version = 0;
+        file.read(magic, sizeof(magic));
+        if (!file || memcmp(magic, INPUT_MAGIC, sizeof(magic)) != 0 || !readValue(file, version) || version != INPUT_FILE_VERSION) {
+            std::cerr << "Not an input log: " << fileName << std::endl;
+            return false;
+        }
+
+        events.clear();
+        while (true) {
+            InputEvent event;
+            memset(&event, 0, sizeof(event));
+            unsigned int tick = 0;
+            if (!readValue(file, tick) || !readValue(file, event.time) || !readValue(file, event.type)) {
+                break;
+            }
+            event.tick = tick;
+            if (event.type == INPUT_KEY) {
+                short key, scancode;
+                unsigned char action, mods;
+                if (!readValue(file, key) || !readValue(file, scancode) || !readValue(file, action) || !readValue(file, mods)) {
+                    break;
+                }
+                event.key = key;
+                event.scancode = scancode;
+                event.action = action;
+                event.mods = mods;
+            }
+            else if (event.type == INPUT_CURSOR) {
+                if (!readValue(file, event.x) || !readValue(file, event.y)) {
+                    break;
+                }
+            }
+            else {
+                std::cerr << "Corrupt input log " << fileName << " after " << events.size() << " events" << std::endl;
+                break;
+            }
+            events.push_back(event);
+        }
+
+        std::cout << "Input replay " << fileName << ": " << events.size() << " events" << std::endl;
+        nextEvent = 0;
+        active = true;
+        return true;
+    }
+
+    bool InputReplay::IsActive()
+    {
+        return active;
+    }
+
+    bool InputReplay::IsFinished()
+    {
+        return nextEvent >= events.size();
+    }
+
+    void InputReplay::Dispatch(unsigned long long tick, KeyHandler keyHandler, CursorHandler cursorHandler)
+    {
+        while (nextEvent < events.size() && events[nextEvent].tick <= tick) {
+            const InputEvent& event = events[nextEvent++];
+            if (event.type == INPUT_KEY) {
+                keyHandler(event.key, event.scancode, event.action, event.mods);
+            }
+            else {
+                cursorHandler(event.x, event.y);
+            }
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef InputRecorder_hpp
+#define InputRecorder_hpp
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    enum INPUT_EVENT_TYPE { INPUT_KEY = 1, INPUT_CURSOR = 2 };
+
+    // one GLFW key or cursor event, stamped with the number of simulation
+    // ticks run before it was received
+    struct InputEvent {
+        unsigned long long tick;
+        // seconds since the recording started (informational)
+        float time;
+        unsigned char type;
+        int key;
+        int scancode;
+        int action;
+        int mods;
+        double x;
+        double y;
+    };
+
+    // Writes the GLFW input of a session to a compact binary log.
+    class InputRecorder
+    {
+    public:
+        InputRecorder();
+        ~InputRecorder();
+
+        bool Begin(const std::string& fileName);
+        void End();
+        bool IsRecording();
+
+        void RecordKey(unsigned long long tick, float time, int key, int scancode, int action, int mods);
+        void RecordCursor(unsigned long long tick, float time, double x, double y);
+
+    private:
+        std::ofstream file;
+        unsigned int eventCount;
+    };
+
+    // Feeds a recorded log back through the same handlers, tick by tick, so
+    // the simulation sees exactly the input of the original session.
+    class InputReplay
+    {
+    public:
+        typedef void (*KeyHandler)(int key, int scancode, int action, int mods);
+        typedef void (*CursorHandler)(double x, double y);
+
+        InputReplay();
+
+        bool Load(const std::string& fileName);
+        bool IsActive();
+        bool IsFinished();
+
+        // dispatches every event stamped with this tick (or earlier)
+        void Dispatch(unsigned long long tick, KeyHandler keyHandler, CursorHandler cursorHandler);
+
+    private:
+        std::vector<InputEvent> events;
+        size_t nextEvent;
+        bool active;
+    };
+}
+
+#endif /* InputRecorder_hpp */
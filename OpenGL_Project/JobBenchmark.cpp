@@ -0,0 +1,171 @@
+#include "JobBenchmark.hpp"
+#include "JobSystem.hpp"
+#include "Model3D.hpp"
+#include "Profiler.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cstdio>
+#include <thread>
+
+namespace gps {
+
+    namespace {
+        const int TRANSFORM_PASSES = 20;
+
+        struct ParseTask {
+            Model3D* model;
+            const std::string* fileName;
+            bool parsed;
+        };
+
+        struct DecodeTask {
+            Model3D* model;
+            int index;
+        };
+
+        struct TransformTask {
+            const glm::vec3* positions;
+            glm::vec3* output;
+            glm::mat4 matrix;
+            // bounds of each batch, merged afterwards like a culling pass would
+            glm::vec3 minimum[JobSystem::MAX_BATCHES];
+            glm::vec3 maximum[JobSystem::MAX_BATCHES];
+            std::atomic<int> nextBatch;
+        };
+
+        void ParseModel(void* data)
+        {
+            ParseTask* task = (ParseTask*)data;
+            task->parsed = task->model->Parse(*task->fileName);
+        }
+
+        void DecodeTextures(int begin, int end, void* data)
+        {
+            std::vector<DecodeTask>& tasks = *(std::vector<DecodeTask>*)data;
+            for (int i = begin; i < end; i++) {
+                tasks[i].model->DecodeTexture(tasks[i].index);
+            }
+        }
+
+        void TransformPositions(int begin, int end, void* data)
+        {
+            TransformTask* task = (TransformTask*)data;
+            glm::vec3 minimum(1e30f);
+            glm::vec3 maximum(-1e30f);
+            for (int i = begin; i < end; i++) {
+                glm::vec3 position = glm::vec3(task->matrix * glm::vec4(task->positions[i], 1.0f));
+                task->output[i] = position;
+                minimum = glm::min(minimum, position);
+                maximum = glm::max(maximum, position);
+            }
+            int batch = task->nextBatch.fetch_add(1);
+            task->minimum[batch] = minimum;
+            task->maximum[batch] = maximum;
+        }
+
+        double Milliseconds(long long start)
+        {
+            return (Profiler::Now() - start) / 1000000.0;
+        }
+
+        // parses every model and decodes its textures, returns the elapsed time
+        double LoadScene(const std::vector<std::string>& modelFiles, std::vector<glm::vec3>* positions)
+        {
+            long long start = Profiler::Now();
+            size_t count = modelFiles.size();
+            Model3D* models = new Model3D[count];
+            std::vector<ParseTask> parseTasks(count);
+            std::vector<Job> jobs(count);
+            for (size_t i = 0; i < count; i++) {
+                parseTasks[i].model = &models[i];
+                parseTasks[i].fileName = &modelFiles[i];
+                parseTasks[i].parsed = false;
+                jobs[i].function = ParseModel;
+                jobs[i].data = &parseTasks[i];
+                jobs[i].dependency = NULL;
+            }
+            JobCounter parsed;
+            JobSystem::Run(count > 0 ? &jobs[0] : NULL, (int)count, &parsed);
+            JobSystem::Wait(&parsed);
+
+            std::vector<DecodeTask> decodeTasks;
+            for (size_t i = 0; i < count; i++) {
+                for (int t = 0; t < models[i].GetPendingTextureCount(); t++) {
+                    DecodeTask task = { &models[i], t };
+                    decodeTasks.push_back(task);
+                }
+            }
+            JobSystem::ParallelFor((int)decodeTasks.size(), 1, DecodeTextures, &decodeTasks);
+            double elapsed = Milliseconds(start);
+
+            if (positions != NULL) {
+                for (size_t i = 0; i < count; i++) {
+                    models[i].GetPositions(*positions);
+                }
+            }
+            delete[] models;
+            return elapsed;
+        }
+
+        // average time of one pass over every position
+        double TransformScene(const std::vector<glm::vec3>& positions, std::vector<glm::vec3>& output)
+        {
+            TransformTask* task = new TransformTask();
+            task->positions = positions.empty() ? NULL : &positions[0];
+            task->output = output.empty() ? NULL : &output[0];
+            long long start = Profiler::Now();
+            for (int pass = 0; pass < TRANSFORM_PASSES; pass++) {
+                task->matrix = glm::rotate(glm::mat4(1.0f), glm::radians((float)pass), glm::vec3(0.0f, 1.0f, 0.0f));
+                task->nextBatch = 0;
+                JobSystem::ParallelFor((int)positions.size(), 4096, TransformPositions, task);
+                glm::vec3 minimum(1e30f);
+                glm::vec3 maximum(-1e30f);
+                for (int i = 0; i < task->nextBatch; i++) {
+                    minimum = glm::min(minimum, task->minimum[i]);
+                    maximum = glm::max(maximum, task->maximum[i]);
+                }
+            }
+            double elapsed = Milliseconds(start) / TRANSFORM_PASSES;
+            delete task;
+            return elapsed;
+        }
+    }
+
+    void JobBenchmark::Run(const std::vector<std::string>& modelFiles, int maxThreads)
+    {
+        if (maxThreads <= 0) {
+            maxThreads = (int)std::thread::hardware_concurrency();
+        }
+        if (maxThreads < 1) {
+            maxThreads = 1;
+        }
+        if (maxThreads > JobSystem::MAX_WORKERS + 1) {
+            maxThreads = JobSystem::MAX_WORKERS + 1;
+        }
+
+        // a first load warms the file cache and collects the vertices to transform
+        JobSystem::Init(maxThreads - 1);
+        std::vector<glm::vec3> positions;
+        LoadScene(modelFiles, &positions);
+        std::vector<glm::vec3> output(positions.size());
+        printf("Job benchmark: %u models, %u vertices\n", (unsigned int)modelFiles.size(), (unsigned int)positions.size());
+
+        double loadBase = 0.0;
+        double transformBase = 0.0;
+        printf("threads   load ms  speedup   transform ms  speedup\n");
+        for (int threads = 1; threads <= maxThreads; threads++) {
+            JobSystem::Init(threads - 1);
+            double loadMs = LoadScene(modelFiles, NULL);
+            double transformMs = TransformScene(positions, output);
+            if (threads == 1) {
+                loadBase = loadMs;
+                transformBase = transformMs;
+            }
+            printf("%7d %9.2f %8.2f %14.3f %8.2f\n", threads,
+                loadMs, loadMs > 0.0 ? loadBase / loadMs : 0.0,
+                transformMs, transformMs > 0.0 ? transformBase / transformMs : 0.0);
+        }
+        JobSystem::Shutdown();
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef JobBenchmark_hpp
+#define JobBenchmark_hpp
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // --jobs-bench: runs the CPU side of the scene on the job system with 1..N
+    // threads and prints the time and speedup of each workload:
+    //   load      - .obj parsing (a job per model) and texture decoding (ParallelFor)
+    //   transform - every scene vertex through a model matrix, with bounds
+    // Needs no GL context, nothing is uploaded.
+    class JobBenchmark
+    {
+    public:
+        // maxThreads 0 = one per core
+        static void Run(const std::vector<std::string>& modelFiles, int maxThreads);
+    };
+}
+
+#endif /* JobBenchmark_hpp */
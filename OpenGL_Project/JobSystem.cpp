@@ -0,0 +1,298 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace gps {
+
+    namespace {
+        struct QueuedJob {
+            JobFunction function;
+            void* data;
+            JobCounter* counter;
+            JobCounter* dependency;
+            JOB_PRIORITY priority;
+        };
+
+        // fixed ring: the owner works at the back, thieves take from the front
+        struct JobQueue {
+            std::mutex mutex;
+            QueuedJob jobs[JobSystem::QUEUE_CAPACITY];
+            unsigned int head;
+            unsigned int tail;
+
+            bool Push(const QueuedJob& job)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (tail - head == JobSystem::QUEUE_CAPACITY) {
+                    return false;
+                }
+                jobs[tail % JobSystem::QUEUE_CAPACITY] = job;
+                tail++;
+                return true;
+            }
+
+            bool Pop(QueuedJob& job)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (tail == head) {
+                    return false;
+                }
+                tail--;
+                job = jobs[tail % JobSystem::QUEUE_CAPACITY];
+                return true;
+            }
+
+            bool Steal(QueuedJob& job)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (tail == head) {
+                    return false;
+                }
+                job = jobs[head % JobSystem::QUEUE_CAPACITY];
+                head++;
+                return true;
+            }
+        };
+
+        // queue 0 is shared by every thread that is not a worker
+        JobQueue queues[JobSystem::MAX_WORKERS + 1];
+        JobQueue lowQueues[JobSystem::MAX_WORKERS + 1];
+        std::thread workers[JobSystem::MAX_WORKERS];
+        char workerNames[JobSystem::MAX_WORKERS][16];
+        int workerCount = 0;
+
+        // queued jobs not yet picked up, lets idle workers sleep
+        std::atomic<int> queuedJobs(0);
+        std::atomic<bool> quitting(false);
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+
+        thread_local int queueIndex = 0;
+        // of the job the thread is running, inherited by the jobs it starts
+        thread_local JOB_PRIORITY currentPriority = JOB_PRIORITY_HIGH;
+
+        struct ParallelForBatch {
+            ParallelForFunction function;
+            void* data;
+            int begin;
+            int end;
+        };
+
+        void RunBatch(void* data)
+        {
+            ParallelForBatch* batch = (ParallelForBatch*)data;
+            batch->function(batch->begin, batch->end, batch->data);
+        }
+
+        // own queue first (newest job, still warm in the cache), then the oldest job of the others
+        bool FindJob(JobQueue* set, QueuedJob& job)
+        {
+            if (set[queueIndex].Pop(job)) {
+                return true;
+            }
+            int queueCount = workerCount + 1;
+            for (int i = 1; i < queueCount; i++) {
+                if (set[(queueIndex + i) % queueCount].Steal(job)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // frame work before loads
+        bool FindJob(QueuedJob& job, bool allowLow)
+        {
+            return FindJob(queues, job) || (allowLow && FindJob(lowQueues, job));
+        }
+
+        void Execute(const QueuedJob& job)
+        {
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            JOB_PRIORITY previousPriority = currentPriority;
+            currentPriority = job.priority;
+            if (job.dependency != NULL) {
+                JobSystem::Wait(job.dependency);
+            }
+            job.function(job.data);
+            currentPriority = previousPriority;
+            if (job.counter != NULL) {
+                job.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        void WorkerMain(int index)
+        {
+            queueIndex = index;
+            Profiler::SetThreadName(workerNames[index - 1]);
+            QueuedJob job;
+            while (true) {
+                if (FindJob(job, true)) {
+                    Execute(job);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                if (quitting.load() && queuedJobs.load() == 0) {
+                    return;
+                }
+                if (queuedJobs.load() == 0) {
+                    wakeUp.wait(lock);
+                }
+            }
+        }
+    }
+
+    JobCounter::JobCounter()
+        : pending(0)
+    {
+    }
+
+    bool JobCounter::IsDone() const
+    {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+    void JobSystem::Init(int count)
+    {
+        Shutdown();
+        if (count < 0) {
+            count = (int)std::thread::hardware_concurrency() - 1;
+        }
+        if (count < 0) {
+            count = 0;
+        }
+        if (count > MAX_WORKERS) {
+            count = MAX_WORKERS;
+        }
+
+        quitting = false;
+        workerCount = count;
+        for (int i = 0; i < count; i++) {
+            snprintf(workerNames[i], sizeof(workerNames[i]), "Worker %d", i + 1);
+            workers[i] = std::thread(WorkerMain, i + 1);
+        }
+    }
+
+    void JobSystem::Shutdown()
+    {
+        if (workerCount == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quitting = true;
+        }
+        wakeUp.notify_all();
+        for (int i = 0; i < workerCount; i++) {
+            workers[i].join();
+        }
+        workerCount = 0;
+    }
+
+    int JobSystem::GetThreadCount()
+    {
+        return workerCount + 1;
+    }
+
+    void JobSystem::Run(const Job* jobs, int count, JobCounter* counter, JOB_PRIORITY priority)
+    {
+        if (counter != NULL) {
+            counter->pending.fetch_add(count, std::memory_order_relaxed);
+        }
+        if (currentPriority == JOB_PRIORITY_LOW) {
+            priority = JOB_PRIORITY_LOW;
+        }
+        JobQueue& queue = priority == JOB_PRIORITY_LOW ? lowQueues[queueIndex] : queues[queueIndex];
+        for (int i = 0; i < count; i++) {
+            QueuedJob job = { jobs[i].function, jobs[i].data, counter, jobs[i].dependency, priority };
+            queuedJobs.fetch_add(1, std::memory_order_relaxed);
+            if (!queue.Push(job)) {
+                // queue full: run it right here instead of growing it
+                Execute(job);
+            }
+        }
+        {
+            // pairs with the check under the lock in WorkerMain, no wake-up gets lost
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        if (count == 1) {
+            wakeUp.notify_one();
+        }
+        else {
+            wakeUp.notify_all();
+        }
+    }
+
+    void JobSystem::Run(JobFunction function, void* data, JobCounter* counter, JobCounter* dependency, JOB_PRIORITY priority)
+    {
+        Job job = { function, data, dependency };
+        Run(&job, 1, counter, priority);
+    }
+
+    void JobSystem::Wait(JobCounter* counter, JOB_PRIORITY lowest)
+    {
+        // inside a load, its own batches are low priority as well
+        bool allowLow = lowest == JOB_PRIORITY_LOW || currentPriority == JOB_PRIORITY_LOW;
+        QueuedJob job;
+        while (!counter->IsDone()) {
+            if (FindJob(job, allowLow)) {
+                Execute(job);
+            }
+            else {
+                // the remaining jobs are running on other threads
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    int JobSystem::RunPending(int maxJobs)
+    {
+        QueuedJob job;
+        int ran = 0;
+        while (ran < maxJobs && FindJob(job, true)) {
+            Execute(job);
+            ran++;
+        }
+        return ran;
+    }
+
+    void JobSystem::ParallelFor(int count, int minBatch, ParallelForFunction function, void* data)
+    {
+        if (count <= 0) {
+            return;
+        }
+        if (minBatch < 1) {
+            minBatch = 1;
+        }
+        // a few batches per thread keeps everyone busy when batches differ in cost
+        int batchCount = (count + minBatch - 1) / minBatch;
+        if (batchCount > GetThreadCount() * 4) {
+            batchCount = GetThreadCount() * 4;
+        }
+        if (batchCount > MAX_BATCHES) {
+            batchCount = MAX_BATCHES;
+        }
+        if (batchCount == 1) {
+            function(0, count, data);
+            return;
+        }
+
+        ParallelForBatch batches[MAX_BATCHES];
+        Job jobs[MAX_BATCHES];
+        for (int i = 0; i < batchCount; i++) {
+            batches[i].function = function;
+            batches[i].data = data;
+            batches[i].begin = (int)((long long)count * i / batchCount);
+            batches[i].end = (int)((long long)count * (i + 1) / batchCount);
+            jobs[i].function = RunBatch;
+            jobs[i].data = &batches[i];
+            jobs[i].dependency = NULL;
+        }
+        JobCounter counter;
+        Run(jobs, batchCount, &counter);
+        Wait(&counter);
+    }
+}
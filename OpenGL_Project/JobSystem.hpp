@@ -0,0 +1,77 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <atomic>
+
+namespace gps {
+
+    typedef void (*JobFunction)(void* data);
+    // processes the items [begin, end) of a ParallelFor
+    typedef void (*ParallelForFunction)(int begin, int end, void* data);
+
+    // number of unfinished jobs started with it; Wait returns once it is zero
+    struct JobCounter {
+        std::atomic<int> pending;
+
+        JobCounter();
+        bool IsDone() const;
+    };
+
+    enum JOB_PRIORITY {
+        // per-frame work, short enough to run inside any Wait
+        JOB_PRIORITY_HIGH,
+        // loads that may take hundreds of milliseconds: run by the workers,
+        // and by a Wait only when asked to or from inside another such job
+        JOB_PRIORITY_LOW
+    };
+
+    struct Job {
+        JobFunction function;
+        void* data;
+        // jobs that must finish first (optional, already started): the thread
+        // that picks this job up runs other queued work until they are done
+        JobCounter* dependency;
+    };
+
+    // Work-stealing scheduler shared by the loaders and the per-frame systems.
+    // Every worker owns a fixed-size deque: it pushes and pops its own jobs at
+    // the back and steals from the front of the others when it runs dry.
+    // Threads that are not workers (main, render) share one extra deque and
+    // help out while they Wait. Low priority jobs have deques of their own,
+    // so a frame waiting on its ParallelFor never picks up a load; the jobs a
+    // low priority job starts are low priority too. Nothing is allocated
+    // once Init returns.
+    class JobSystem
+    {
+    public:
+        static const int MAX_WORKERS = 32;
+        static const int QUEUE_CAPACITY = 1024;
+        // ParallelFor never splits into more batches than this
+        static const int MAX_BATCHES = 256;
+
+        // starts workerCount threads (0 = the callers do all the work,
+        // negative = one per core besides the caller)
+        static void Init(int workerCount = -1);
+        // finishes the queued jobs and joins the workers
+        static void Shutdown();
+        // worker threads plus the calling thread
+        static int GetThreadCount();
+
+        // queues jobs; counter (optional) is raised by count now and lowered as each one finishes
+        static void Run(const Job* jobs, int count, JobCounter* counter, JOB_PRIORITY priority = JOB_PRIORITY_HIGH);
+        static void Run(JobFunction function, void* data, JobCounter* counter, JobCounter* dependency = 0,
+            JOB_PRIORITY priority = JOB_PRIORITY_HIGH);
+        // runs queued jobs on the calling thread until the counter drops to
+        // zero; low priority ones only with lowest = JOB_PRIORITY_LOW
+        static void Wait(JobCounter* counter, JOB_PRIORITY lowest = JOB_PRIORITY_HIGH);
+        // runs at most maxJobs queued jobs of any priority on the calling
+        // thread and returns how many ran; without workers nothing else would
+        static int RunPending(int maxJobs);
+
+        // splits [0, count) into batches of at least minBatch items, runs them
+        // on every thread including the caller and returns when all are done
+        static void ParallelFor(int count, int minBatch, ParallelForFunction function, void* data);
+    };
+}
+
+#endif /* JobSystem_hpp */
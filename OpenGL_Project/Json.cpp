@@ -0,0 +1,385 @@
+#include "Json.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace gps {
+
+    namespace {
+        const JsonValue NULL_VALUE;
+        const std::string EMPTY_STRING;
+    }
+
+    // recursive descent over the text, one value at a time
+    class JsonParser
+    {
+    public:
+        JsonParser(const char* text, size_t length)
+            : text(text), end(text + length), current(text)
+        {
+        }
+
+        bool ParseDocument(JsonValue& value, std::string& error)
+        {
+            if (!ParseValue(value, 0)) {
+                error = message + " at offset " + std::to_string(current - text);
+                return false;
+            }
+            SkipSpace();
+            if (current != end) {
+                error = "trailing characters at offset " + std::to_string(current - text);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        const char* text;
+        const char* end;
+        const char* current;
+        std::string message;
+
+        bool Fail(const char* reason)
+        {
+            message = reason;
+            return false;
+        }
+
+        void SkipSpace()
+        {
+            while (current != end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r')) {
+                current++;
+            }
+        }
+
+        bool Match(const char* word)
+        {
+            size_t length = strlen(word);
+            if ((size_t)(end - current) < length || memcmp(current, word, length) != 0) {
+                return false;
+            }
+            current += length;
+            return true;
+        }
+
+        bool ParseValue(JsonValue& value, int depth)
+        {
+            if (depth > JsonValue::MAX_DEPTH) {
+                return Fail("nested too deeply");
+            }
+            SkipSpace();
+            if (current == end) {
+                return Fail("unexpected end");
+            }
+            switch (*current) {
+            case '{':
+                return ParseObject(value, depth);
+            case '[':
+                return ParseArray(value, depth);
+            case '"':
+                value.type = JSON_STRING;
+                return ParseString(value.text);
+            case 't':
+            case 'f':
+                value.type = JSON_BOOL;
+                value.boolean = *current == 't';
+                return Match(value.boolean ? "true" : "false") || Fail("invalid literal");
+            case 'n':
+                value.type = JSON_NULL;
+                return Match("null") || Fail("invalid literal");
+            default:
+                return ParseNumber(value);
+            }
+        }
+
+        bool ParseObject(JsonValue& value, int depth)
+        {
+            value.type = JSON_OBJECT;
+            current++;
+            SkipSpace();
+            if (current != end && *current == '}') {
+                current++;
+                return true;
+            }
+            while (true) {
+                SkipSpace();
+                if (current == end || *current != '"') {
+                    return Fail("expected a member name");
+                }
+                value.keys.push_back(std::string());
+                if (!ParseString(value.keys.back())) {
+                    return false;
+                }
+                SkipSpace();
+                if (current == end || *current != ':') {
+                    return Fail("expected ':'");
+                }
+                current++;
+                value.elements.push_back(JsonValue());
+                if (!ParseValue(value.elements.back(), depth + 1)) {
+                    return false;
+                }
+                SkipSpace();
+                if (current != end && *current == ',') {
+                    current++;
+                    continue;
+                }
+                if (current != end && *current == '}') {
+                    current++;
+                    return true;
+                }
+                return Fail("expected ',' or '}'");
+            }
+        }
+
+        bool ParseArray(JsonValue& value, int depth)
+        {
+            value.type = JSON_ARRAY;
+            current++;
+            SkipSpace();
+            if (current != end && *current == ']') {
+                current++;
+                return true;
+            }
+            while (true) {
+                value.elements.push_back(JsonValue());
+                if (!ParseValue(value.elements.back(), depth + 1)) {
+                    return false;
+                }
+                SkipSpace();
+                if (current != end && *current == ',') {
+                    current++;
+                    continue;
+                }
+                if (current != end && *current == ']') {
+                    current++;
+                    return true;
+                }
+                return Fail("expected ',' or ']'");
+            }
+        }
+
+        bool ParseNumber(JsonValue& value)
+        {
+            const char* start = current;
+            while (current != end && *current != '\0' && (strchr("+-.eE", *current) != NULL || (*current >= '0' && *current <= '9'))) {
+                current++;
+            }
+            if (current == start) {
+                return Fail("unexpected character");
+            }
+            // strtod needs a terminated string, the text may not be
+            std::string token(start, current);
+            char* parsed = NULL;
+            value.type = JSON_NUMBER;
+            value.number = strtod(token.c_str(), &parsed);
+            if (parsed != token.c_str() + token.size()) {
+                current = start;
+                return Fail("invalid number");
+            }
+            return true;
+        }
+
+        static int HexDigit(char c)
+        {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        bool ParseCodeUnit(unsigned int& unit)
+        {
+            if (end - current < 4) {
+                return Fail("truncated \\u escape");
+            }
+            unit = 0;
+            for (int i = 0; i < 4; i++) {
+                int digit = HexDigit(current[i]);
+                if (digit < 0) {
+                    return Fail("invalid \\u escape");
+                }
+                unit = unit * 16 + digit;
+            }
+            current += 4;
+            return true;
+        }
+
+        static void AppendUtf8(std::string& out, unsigned int codePoint)
+        {
+            if (codePoint < 0x80) {
+                out += (char)codePoint;
+            }
+            else if (codePoint < 0x800) {
+                out += (char)(0xC0 | (codePoint >> 6));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000) {
+                out += (char)(0xE0 | (codePoint >> 12));
+                out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            }
+            else {
+                out += (char)(0xF0 | (codePoint >> 18));
+                out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+                out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                out += (char)(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        bool ParseString(std::string& out)
+        {
+            current++;
+            while (true) {
+                if (current == end) {
+                    return Fail("unterminated string");
+                }
+                char c = *current++;
+                if (c == '"') {
+                    return true;
+                }
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (current == end) {
+                    return Fail("unterminated string");
+                }
+                char escape = *current++;
+                switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned int unit;
+                    if (!ParseCodeUnit(unit)) {
+                        return false;
+                    }
+                    // a high surrogate followed by a low one is one code point
+                    if (unit >= 0xD800 && unit < 0xDC00 && end - current >= 6 && current[0] == '\\' && current[1] == 'u') {
+                        current += 2;
+                        unsigned int low;
+                        if (!ParseCodeUnit(low)) {
+                            return false;
+                        }
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        else {
+                            AppendUtf8(out, unit);
+                            unit = low;
+                        }
+                    }
+                    AppendUtf8(out, unit);
+                    break;
+                }
+                default:
+                    return Fail("invalid escape");
+                }
+            }
+        }
+    };
+
+    JsonValue::JsonValue()
+    {
+        type = JSON_NULL;
+        boolean = false;
+        number = 0.0;
+    }
+
+    bool JsonValue::Parse(const char* text, size_t length, JsonValue& value, std::string& error)
+    {
+        value = JsonValue();
+        JsonParser parser(text, length);
+        if (!parser.ParseDocument(value, error)) {
+            // a half built object may have a key without its value
+            value = JsonValue();
+            return false;
+        }
+        return true;
+    }
+
+    JSON_TYPE JsonValue::GetType() const
+    {
+        return type;
+    }
+
+    bool JsonValue::IsNull() const
+    {
+        return type == JSON_NULL;
+    }
+
+    const JsonValue& JsonValue::operator[](const char* key) const
+    {
+        if (type != JSON_OBJECT) {
+            return NULL_VALUE;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) {
+                return elements[i];
+            }
+        }
+        return NULL_VALUE;
+    }
+
+    const JsonValue& JsonValue::operator[](size_t index) const
+    {
+        if (type != JSON_ARRAY || index >= elements.size()) {
+            return NULL_VALUE;
+        }
+        return elements[index];
+    }
+
+    const JsonValue& JsonValue::operator[](int index) const
+    {
+        if (index < 0) {
+            return NULL_VALUE;
+        }
+        return (*this)[(size_t)index];
+    }
+
+    bool JsonValue::Has(const char* key) const
+    {
+        return !(*this)[key].IsNull();
+    }
+
+    size_t JsonValue::GetSize() const
+    {
+        return type == JSON_ARRAY || type == JSON_OBJECT ? elements.size() : 0;
+    }
+
+    bool JsonValue::GetBool(bool fallback) const
+    {
+        return type == JSON_BOOL ? boolean : fallback;
+    }
+
+    double JsonValue::GetNumber(double fallback) const
+    {
+        return type == JSON_NUMBER ? number : fallback;
+    }
+
+    int JsonValue::GetInt(int fallback) const
+    {
+        // indices and counts: anything that does not fit an int is invalid
+        if (type != JSON_NUMBER || !(number >= -2147483648.0 && number <= 2147483647.0)) {
+            return fallback;
+        }
+        return (int)number;
+    }
+
+    const std::string& JsonValue::GetString() const
+    {
+        return type == JSON_STRING ? text : EMPTY_STRING;
+    }
+}
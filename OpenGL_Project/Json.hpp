@@ -0,0 +1,66 @@
+#ifndef Json_hpp
+#define Json_hpp
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    enum JSON_TYPE {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+
+    // A parsed JSON document, as much of it as the asset loaders need.
+    // Lookups never fail: a missing member or element, or one of the wrong
+    // type, is a null value, so gltf["meshes"][2]["name"] reads safely and
+    // the Get functions return their fallback instead.
+    class JsonValue
+    {
+    public:
+        // nesting deeper than this is rejected instead of overflowing the stack
+        static const int MAX_DEPTH = 64;
+
+        JsonValue();
+
+        // the text does not have to be terminated; false with a message on
+        // malformed input
+        static bool Parse(const char* text, size_t length, JsonValue& value, std::string& error);
+
+        JSON_TYPE GetType() const;
+        bool IsNull() const;
+
+        // members of an object, elements of an array
+        const JsonValue& operator[](const char* key) const;
+        const JsonValue& operator[](size_t index) const;
+        // negative indices (an index read with GetInt(-1)) give a null value
+        const JsonValue& operator[](int index) const;
+        bool Has(const char* key) const;
+        // elements or members, 0 for anything else
+        size_t GetSize() const;
+
+        bool GetBool(bool fallback) const;
+        double GetNumber(double fallback) const;
+        int GetInt(int fallback) const;
+        // empty when not a string
+        const std::string& GetString() const;
+
+    private:
+        JSON_TYPE type;
+        bool boolean;
+        double number;
+        std::string text;
+        // elements of an array or values of an object, keys parallel to them
+        std::vector<JsonValue> elements;
+        std::vector<std::string> keys;
+
+        friend class JsonParser;
+    };
+}
+
+#endif /* Json_hpp */
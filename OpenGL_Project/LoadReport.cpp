@@ -0,0 +1,135 @@
+#include "LoadReport.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace gps {
+
+    std::deque<LoadRecord> LoadReport::records;
+    std::mutex LoadReport::recordsMutex;
+
+    namespace {
+        const char* typeNames[] = { "model", "texture", "shader" };
+
+        double totalMs(const LoadRecord& record)
+        {
+            return record.ioMs + record.parseMs + record.decodeMs + record.mipMs + record.uploadMs + record.compileMs;
+        }
+
+        bool slowerFirst(const LoadRecord* a, const LoadRecord* b)
+        {
+            return totalMs(*a) > totalMs(*b);
+        }
+
+        // names are file paths; keep the JSON and CSV valid
+        std::string escape(const std::string& text)
+        {
+            std::string escaped;
+            for (size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '"' || text[i] == '\\') {
+                    escaped += '\\';
+                }
+                escaped += text[i];
+            }
+            return escaped;
+        }
+    }
+
+    size_t LoadReport::Begin(LOAD_ASSET_TYPE type, const std::string& name)
+    {
+        LoadRecord record = { type, name, 1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0 };
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        records.push_back(record);
+        return records.size() - 1;
+    }
+
+    size_t LoadReport::Begin(LOAD_ASSET_TYPE type, const std::string& name, size_t previous)
+    {
+        {
+            std::lock_guard<std::mutex> lock(recordsMutex);
+            if (previous < records.size() && records[previous].type == type && records[previous].name == name) {
+                LoadRecord& record = records[previous];
+                int loads = record.loads;
+                record = LoadRecord();
+                record.type = type;
+                record.name = name;
+                record.loads = loads + 1;
+                return previous;
+            }
+        }
+        return Begin(type, name);
+    }
+
+    LoadRecord& LoadReport::Get(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        return records[index];
+    }
+
+    size_t LoadReport::GetCount()
+    {
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        return records.size();
+    }
+
+    double LoadReport::Elapsed(long long start, long long end)
+    {
+        return (end - start) / 1000000.0;
+    }
+
+    bool LoadReport::Write(const std::string& fileName)
+    {
+        std::ofstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not write load report " << fileName << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        bool csv = fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+        if (csv) {
+            file << "type,name,loads,io_ms,parse_ms,decode_ms,mip_ms,upload_ms,compile_ms,total_ms,disk_bytes,cpu_bytes,gpu_bytes\n";
+            for (size_t i = 0; i < records.size(); i++) {
+                const LoadRecord& r = records[i];
+                file << typeNames[r.type] << ",\"" << r.name << "\"," << r.loads << "," << r.ioMs << "," << r.parseMs << "," << r.decodeMs << ","
+                    << r.mipMs << "," << r.uploadMs << "," << r.compileMs << "," << totalMs(r) << ","
+                    << r.diskBytes << "," << r.cpuBytes << "," << r.gpuBytes << "\n";
+            }
+        }
+        else {
+            file << "{\n  \"assets\": [\n";
+            for (size_t i = 0; i < records.size(); i++) {
+                const LoadRecord& r = records[i];
+                file << "    { \"type\": \"" << typeNames[r.type] << "\", \"name\": \"" << escape(r.name) << "\""
+                    << ", \"loads\": " << r.loads << ", \"io_ms\": " << r.ioMs << ", \"parse_ms\": " << r.parseMs << ", \"decode_ms\": " << r.decodeMs
+                    << ", \"mip_ms\": " << r.mipMs << ", \"upload_ms\": " << r.uploadMs << ", \"compile_ms\": " << r.compileMs
+                    << ", \"total_ms\": " << totalMs(r)
+                    << ", \"disk_bytes\": " << r.diskBytes << ", \"cpu_bytes\": " << r.cpuBytes << ", \"gpu_bytes\": " << r.gpuBytes
+                    << " }" << (i + 1 < records.size() ? ",\n" : "\n");
+            }
+            file << "  ]\n}\n";
+        }
+
+        std::cout << "Load report: " << records.size() << " assets written to " << fileName << std::endl;
+        return true;
+    }
+
+    void LoadReport::PrintSummary(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        std::vector<const LoadRecord*> sorted;
+        double total = 0.0;
+        for (size_t i = 0; i < records.size(); i++) {
+            sorted.push_back(&records[i]);
+            total += totalMs(records[i]);
+        }
+        std::sort(sorted.begin(), sorted.end(), slowerFirst);
+
+        std::cout << "Asset loading: " << records.size() << " assets, " << total << " ms" << std::endl;
+        for (size_t i = 0; i < sorted.size() && i < count; i++) {
+            std::cout << "  " << totalMs(*sorted[i]) << " ms  " << typeNames[sorted[i]->type] << " " << sorted[i]->name << std::endl;
+        }
+    }
+}
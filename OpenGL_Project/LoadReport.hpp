@@ -0,0 +1,71 @@
+#ifndef LoadReport_hpp
+#define LoadReport_hpp
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace gps {
+
+    enum LOAD_ASSET_TYPE { LOAD_MODEL, LOAD_TEXTURE, LOAD_SHADER };
+
+    // startup cost of one asset; stages that do not apply stay at zero
+    struct LoadRecord {
+        LOAD_ASSET_TYPE type;
+        std::string name;
+        // times the asset was loaded; the figures are those of the last load
+        int loads;
+        // reading the file into memory
+        double ioMs;
+        // .obj parsing and vertex assembly
+        double parseMs;
+        // image decoding (and the vertical flip)
+        double decodeMs;
+        // building the mip chain
+        double mipMs;
+        // buffer / texture uploads, as seen by the CPU
+        double uploadMs;
+        // shader compile and link calls and the status queries waiting on them
+        // (driver threads compiling in parallel are not counted)
+        double compileMs;
+        unsigned long long diskBytes;
+        unsigned long long cpuBytes;
+        unsigned long long gpuBytes;
+    };
+
+    // Collects per-asset load timings while the scene starts up and writes
+    // them as JSON or CSV, to find the asset that dominates cold start.
+    // Records may be added and filled from several loader threads; each record
+    // is written by the thread that began it.
+    class LoadReport
+    {
+    public:
+        // no record yet, for the previous argument of Begin
+        static const size_t NO_RECORD = (size_t)-1;
+
+        // adds an empty record and returns its index
+        static size_t Begin(LOAD_ASSET_TYPE type, const std::string& name);
+        // the same for an asset that may load again (streamed models and their
+        // textures): previous, the record of its last load, is cleared and
+        // reused, so reloads do not grow the report; a new record when it is
+        // NO_RECORD or belongs to another asset
+        static size_t Begin(LOAD_ASSET_TYPE type, const std::string& name, size_t previous);
+        // the reference stays valid while other threads add records
+        static LoadRecord& Get(size_t index);
+        static size_t GetCount();
+
+        // milliseconds between two Profiler::Now() values
+        static double Elapsed(long long start, long long end);
+
+        // format follows the extension (.csv, anything else is JSON)
+        static bool Write(const std::string& fileName);
+        // top assets by total time
+        static void PrintSummary(size_t count);
+
+    private:
+        static std::deque<LoadRecord> records;
+        static std::mutex recordsMutex;
+    };
+}
+
+#endif /* LoadReport_hpp */
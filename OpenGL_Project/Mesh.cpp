@@ -1,4 +1,6 @@
 #include "Mesh.hpp"
+#include "Stats.hpp"
+
 namespace gps {
 
 	/* Mesh Constructor */
@@ -7,29 +9,55 @@ namespace gps {
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
+		this->samplerProgram = 0;
+		this->samplerLocations.assign(textures.size(), -1);
 
 		this->setupMesh();
 	}
 
+	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Buffers buffers)
+	{
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->samplerProgram = 0;
+		this->samplerLocations.assign(textures.size(), -1);
+		this->buffers = buffers;
+		this->buffers.VAO = 0;
+		Stats::AddMemory(MEMORY_BUFFERS, this->vertices.size() * sizeof(Vertex) + this->indices.size() * sizeof(GLuint));
+	}
+
 	Buffers Mesh::getBuffers() {
 	    return this->buffers;
 	}
 
 	/* Mesh drawing function - also applies associated textures */
-	void Mesh::Draw(gps::Shader shader)
+	void Mesh::Draw(const gps::Shader& shader)
 	{
 		shader.useShaderProgram();
 
+		// the variants of a shader are different programs with their own locations
+		if (shader.shaderProgram != this->samplerProgram) {
+			for (GLuint i = 0; i < textures.size(); i++) {
+				this->samplerLocations[i] = glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str());
+			}
+			this->samplerProgram = shader.shaderProgram;
+		}
+
 		//set textures
 		for (GLuint i = 0; i < textures.size(); i++)
 		{
 			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
+			glUniform1i(this->samplerLocations[i], i);
 			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
 
 		glBindVertexArray(this->buffers.VAO);
 		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+		Stats::Add(STAT_DRAW_CALLS, 1);
+		Stats::Add(STAT_TRIANGLES, this->indices.size() / 3);
+		Stats::Add(STAT_VISIBLE_MESHES, 1);
+		Stats::Add(STAT_TEXTURE_BINDS, this->textures.size());
 		glBindVertexArray(0);
 
         for(GLuint i = 0; i < this->textures.size(); i++)
@@ -42,18 +70,28 @@ namespace gps {
 
 	// Initializes all the buffer objects/arrays
 	void Mesh::setupMesh(){
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
+		// Create buffers
 		glGenBuffers(1, &this->buffers.VBO);
 		glGenBuffers(1, &this->buffers.EBO);
 
-		glBindVertexArray(this->buffers.VAO);
 		// Load data into vertex buffers
 		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
 		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffers.EBO);
+		glBufferData(GL_COPY_WRITE_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		Stats::AddMemory(MEMORY_BUFFERS, this->vertices.size() * sizeof(Vertex) + this->indices.size() * sizeof(GLuint));
+
+		this->CreateVertexArray();
+	}
 
+	void Mesh::CreateVertexArray(){
+		glGenVertexArrays(1, &this->buffers.VAO);
+		glBindVertexArray(this->buffers.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
 
 		// Set the vertex attribute pointers
 		// Vertex Positions
@@ -67,5 +105,6 @@ namespace gps {
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
 
 		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
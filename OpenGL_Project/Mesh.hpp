@@ -48,15 +48,25 @@ public:
     std::vector<Texture> textures;
 
 	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
+	// around a VBO and EBO already filled (by the upload thread); the vertex
+	// array is made later by CreateVertexArray, on the context that draws
+	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Buffers buffers);
 
 	Buffers getBuffers();
 
-	void Draw(gps::Shader shader);
+	void Draw(const gps::Shader& shader);
+
+	// vertex arrays are not shared between contexts
+	void CreateVertexArray();
 
 private:
     /*  Render data  */
     Buffers buffers;
 
+    // sampler uniform of each texture, looked up again only when the program changes
+    GLuint samplerProgram;
+    std::vector<GLint> samplerLocations;
+
 	// Initializes all the buffer objects/arrays
 	void setupMesh();
 
@@ -1,173 +1,1193 @@
 #include "Model3D.hpp"
+#include "Profiler.hpp"
+#include "Stats.hpp"
+#include "LoadReport.hpp"
+#include "UploadThread.hpp"
+#include "FileSystem.hpp"
+#include "Json.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <sstream>
 
 namespace gps {
 
+	// reads the .mtl files through the file system, so they come from the archive too
+	class AssetMaterialReader : public tinyobj::MaterialReader {
+	public:
+		explicit AssetMaterialReader(const std::string& basePath) : basePath(basePath) {}
+
+		virtual bool operator()(const std::string& matId, std::vector<tinyobj::material_t>* materials,
+			std::map<std::string, int>* matMap, std::string* err) {
+			FileData file;
+			bool found = FileSystem::ReadFile(basePath + matId, file);
+			// like tinyobj::MaterialFileReader, a missing file still gives the default material
+			MemoryStream stream(file.GetData(), file.GetSize());
+			tinyobj::LoadMtl(matMap, materials, &stream);
+			if (!found && err != NULL) {
+				(*err) += "WARN: Material file [ " + basePath + matId + " ] not found. Created a default material.";
+			}
+			return true;
+		}
+
+	private:
+		std::string basePath;
+	};
+
+	// binary glTF: a 12 byte header, then a JSON chunk and an optional BIN chunk
+	static const unsigned int GLB_MAGIC = 0x46546C67;
+	static const unsigned int GLB_CHUNK_JSON = 0x4E4F534A;
+	static const unsigned int GLB_CHUNK_BIN = 0x004E4942;
+	static const int GLTF_TRIANGLES = 4;
+	// node hierarchies deeper than this are cut, a cycle would never end
+	static const int GLTF_MAX_NODE_DEPTH = 64;
+
+	static unsigned int ReadUint32(const unsigned char* data) {
+		unsigned int value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	// one glTF buffer: the BIN chunk or an external .bin, with the file it is
+	// in so images in it can be read again on their own
+	struct GltfBuffer {
+		const unsigned char* data;
+		size_t size;
+		std::string path;
+		size_t fileOffset;
+	};
+
+	// elements of an accessor, read in place from their buffer
+	struct GltfAccessor {
+		const unsigned char* data;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int components;
+		bool normalized;
+	};
+
+	static int GltfComponentSize(int componentType) {
+		switch (componentType) {
+		case 5120: case 5121: return 1;
+		case 5122: case 5123: return 2;
+		case 5125: case 5126: return 4;
+		default: return 0;
+		}
+	}
+
+	static int GltfComponentCount(const std::string& type) {
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	// splits a .glb into its JSON document and BIN chunk
+	static bool GlbSplit(const unsigned char* data, size_t size, JsonValue& gltf, const unsigned char*& bin, size_t& binSize, std::string& error) {
+		bin = NULL;
+		binSize = 0;
+		if (size < 20 || ReadUint32(data) != GLB_MAGIC || ReadUint32(data + 4) != 2 || ReadUint32(data + 8) > size) {
+			error = "not a binary glTF 2.0 file";
+			return false;
+		}
+		size_t length = ReadUint32(data + 8);
+		size_t jsonLength = ReadUint32(data + 12);
+		if (ReadUint32(data + 16) != GLB_CHUNK_JSON || jsonLength > length - 20) {
+			error = "the first chunk is not JSON";
+			return false;
+		}
+		if (!JsonValue::Parse((const char*)data + 20, jsonLength, gltf, error)) {
+			error = "invalid JSON: " + error;
+			return false;
+		}
+		// chunks are padded to four bytes
+		size_t next = 20 + ((jsonLength + 3) & ~(size_t)3);
+		if (next + 8 <= length && ReadUint32(data + next + 4) == GLB_CHUNK_BIN) {
+			binSize = ReadUint32(data + next);
+			if (binSize > length - next - 8) {
+				error = "truncated BIN chunk";
+				return false;
+			}
+			bin = data + next + 8;
+		}
+		return true;
+	}
+
+	// range of a buffer view, checked against its buffer
+	static bool GltfBufferView(const JsonValue& gltf, const std::vector<GltfBuffer>& buffers, int index,
+		const GltfBuffer*& buffer, size_t& offset, size_t& length, size_t& stride) {
+		const JsonValue& view = gltf["bufferViews"][index];
+		int bufferIndex = view["buffer"].GetInt(-1);
+		double viewOffset = view["byteOffset"].GetNumber(0.0);
+		double viewLength = view["byteLength"].GetNumber(-1.0);
+		if (bufferIndex < 0 || bufferIndex >= (int)buffers.size() || buffers[bufferIndex].data == NULL
+			|| viewOffset < 0.0 || viewLength < 0.0 || viewOffset + viewLength > (double)buffers[bufferIndex].size) {
+			return false;
+		}
+		buffer = &buffers[bufferIndex];
+		offset = (size_t)viewOffset;
+		length = (size_t)viewLength;
+		stride = (size_t)view["byteStride"].GetInt(0);
+		return true;
+	}
+
+	static bool GltfGetAccessor(const JsonValue& gltf, const std::vector<GltfBuffer>& buffers, int index, GltfAccessor& accessor) {
+		const JsonValue& description = gltf["accessors"][index];
+		accessor.componentType = description["componentType"].GetInt(0);
+		accessor.components = GltfComponentCount(description["type"].GetString());
+		accessor.normalized = description["normalized"].GetBool(false);
+		int count = description["count"].GetInt(-1);
+		int componentSize = GltfComponentSize(accessor.componentType);
+		// sparse accessors and accessors without a view (all zeros) are not used by exporters for meshes
+		if (count < 0 || componentSize == 0 || accessor.components == 0 || description.Has("sparse")
+			|| !description.Has("bufferView")) {
+			return false;
+		}
+		const GltfBuffer* buffer;
+		size_t viewOffset;
+		size_t viewLength;
+		size_t stride;
+		if (!GltfBufferView(gltf, buffers, description["bufferView"].GetInt(-1), buffer, viewOffset, viewLength, stride)) {
+			return false;
+		}
+		size_t elementSize = (size_t)componentSize * accessor.components;
+		size_t offset = (size_t)description["byteOffset"].GetInt(0);
+		accessor.count = (size_t)count;
+		accessor.stride = stride != 0 ? stride : elementSize;
+		if (count > 0 && (offset > viewLength || (accessor.count - 1) * accessor.stride + elementSize > viewLength - offset)) {
+			return false;
+		}
+		accessor.data = buffer->data + viewOffset + offset;
+		return true;
+	}
+
+	// one component as a float, normalized integers mapped to [0, 1] or [-1, 1]
+	static float GltfReadFloat(const GltfAccessor& accessor, size_t element, int component) {
+		const unsigned char* source = accessor.data + element * accessor.stride + component * GltfComponentSize(accessor.componentType);
+		switch (accessor.componentType) {
+		case 5126: { float value; memcpy(&value, source, 4); return value; }
+		case 5121: return accessor.normalized ? source[0] / 255.0f : (float)source[0];
+		case 5120: { signed char value = (signed char)source[0]; return accessor.normalized ? std::max(value / 127.0f, -1.0f) : (float)value; }
+		case 5123: { unsigned short value; memcpy(&value, source, 2); return accessor.normalized ? value / 65535.0f : (float)value; }
+		case 5122: { short value; memcpy(&value, source, 2); return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : (float)value; }
+		default: { unsigned int value; memcpy(&value, source, 4); return (float)value; }
+		}
+	}
+
+	static unsigned int GltfReadIndex(const GltfAccessor& accessor, size_t element) {
+		const unsigned char* source = accessor.data + element * accessor.stride;
+		switch (accessor.componentType) {
+		case 5121: return source[0];
+		case 5123: { unsigned short value; memcpy(&value, source, 2); return value; }
+		default: return ReadUint32(source);
+		}
+	}
+
+	static glm::mat4 GltfNodeMatrix(const JsonValue& node) {
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.GetSize() == 16) {
+			glm::mat4 result;
+			// column major, as glm
+			for (int i = 0; i < 16; i++) {
+				result[i / 4][i % 4] = (float)matrix[i].GetNumber(0.0);
+			}
+			return result;
+		}
+		const JsonValue& t = node["translation"];
+		const JsonValue& r = node["rotation"];
+		const JsonValue& s = node["scale"];
+		glm::vec3 translation((float)t[0].GetNumber(0.0), (float)t[1].GetNumber(0.0), (float)t[2].GetNumber(0.0));
+		// stored x, y, z, w; glm's constructor takes w first
+		glm::quat rotation((float)r[3].GetNumber(1.0), (float)r[0].GetNumber(0.0), (float)r[1].GetNumber(0.0), (float)r[2].GetNumber(0.0));
+		glm::vec3 scale((float)s[0].GetNumber(1.0), (float)s[1].GetNumber(1.0), (float)s[2].GetNumber(1.0));
+		return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	// the meshes a node and its children draw, with their object-space transforms
+	static void GltfCollectMeshes(const JsonValue& gltf, int nodeIndex, const glm::mat4& parent, int depth,
+		std::vector<std::pair<int, glm::mat4> >& instances) {
+		const JsonValue& node = gltf["nodes"][nodeIndex];
+		if (node.IsNull() || depth > GLTF_MAX_NODE_DEPTH) {
+			return;
+		}
+		glm::mat4 transform = parent * GltfNodeMatrix(node);
+		if (node.Has("mesh")) {
+			instances.push_back(std::make_pair(node["mesh"].GetInt(-1), transform));
+		}
+		const JsonValue& children = node["children"];
+		for (size_t i = 0; i < children.GetSize(); i++) {
+			GltfCollectMeshes(gltf, children[i].GetInt(-1), transform, depth + 1, instances);
+		}
+	}
+
+	// file and byte range of the image a glTF texture samples
+	static bool GltfTextureImage(const JsonValue& gltf, const std::vector<GltfBuffer>& buffers, int textureIndex,
+		const std::string& basePath, std::string& path, size_t& offset, size_t& size) {
+		const JsonValue& image = gltf["images"][gltf["textures"][textureIndex]["source"].GetInt(-1)];
+		const std::string& uri = image["uri"].GetString();
+		if (!uri.empty()) {
+			// images inlined as base64 are not supported
+			if (uri.compare(0, 5, "data:") == 0) {
+				return false;
+			}
+			path = basePath + uri;
+			offset = 0;
+			size = 0;
+			return true;
+		}
+		const GltfBuffer* buffer;
+		size_t viewOffset;
+		size_t stride;
+		if (!image.Has("bufferView") || !GltfBufferView(gltf, buffers, image["bufferView"].GetInt(-1), buffer, viewOffset, size, stride) || size == 0) {
+			return false;
+		}
+		path = buffer->path;
+		offset = buffer->fileOffset + viewOffset;
+		return true;
+	}
+
+	// edge of a mip level, never below one texel
+	static int MipSize(int size, int level) {
+		return std::max(1, size >> level);
+	}
+
+	static unsigned long long MipBytes(int width, int height, int level) {
+		return (unsigned long long)MipSize(width, level) * MipSize(height, level) * 4;
+	}
+
+	// levels down to 1x1
+	static int MipLevelCount(int width, int height) {
+		int levels = 1;
+		while (MipSize(width, levels - 1) > 1 || MipSize(height, levels - 1) > 1) {
+			levels++;
+		}
+		return levels;
+	}
+
+	// prebuilt small levels of an image, in the archive under MipTailName:
+	// this header, then levels firstLevel to the last packed as in MipLevels
+	struct MipTailHeader {
+		unsigned int magic;
+		unsigned int version;
+		int width;
+		int height;
+		int firstLevel;
+	};
+	static const unsigned int MIP_TAIL_MAGIC = 0x544d5047; // "GPMT"
+	static const unsigned int MIP_TAIL_VERSION = 1;
+
+	// first level whose largest edge fits resolution, 0 for resolution 0
+	static int MipLevelFor(int width, int height, int resolution) {
+		if (resolution <= 0) {
+			return 0;
+		}
+		int levelCount = MipLevelCount(width, height);
+		int level = 0;
+		while (level + 1 < levelCount && std::max(MipSize(width, level), MipSize(height, level)) > resolution) {
+			level++;
+		}
+		return level;
+	}
+
+	// sRGB texels are averaged in linear space, as the sampler filters them
+	struct SrgbTables {
+		float toLinear[256];
+		unsigned char toSrgb[4096];
+
+		SrgbTables() {
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; i++) {
+				float c = i / 4095.0f;
+				float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	// 2x2 box filter of an RGBA8 sRGB image into the next level
+	static void DownsampleSrgb(const unsigned char* source, int width, int height, unsigned char* target) {
+		static const SrgbTables tables;
+		int targetWidth = MipSize(width, 1);
+		int targetHeight = MipSize(height, 1);
+		for (int y = 0; y < targetHeight; y++) {
+			const unsigned char* row0 = source + (size_t)std::min(2 * y, height - 1) * width * 4;
+			const unsigned char* row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+			for (int x = 0; x < targetWidth; x++) {
+				int x0 = std::min(2 * x, width - 1) * 4;
+				int x1 = std::min(2 * x + 1, width - 1) * 4;
+				unsigned char* texel = target + ((size_t)y * targetWidth + x) * 4;
+				for (int c = 0; c < 3; c++) {
+					float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]]
+						+ tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+					texel[c] = tables.toSrgb[(int)(sum * 0.25f * 4095.0f + 0.5f)];
+				}
+				texel[3] = (unsigned char)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4);
+			}
+		}
+	}
+
+	// fills pixels with the levels [firstLevel, endLevel) of the chain built from image
+	static void BuildMipChain(const unsigned char* image, int width, int height, std::vector<unsigned char>& pixels,
+		int firstLevel, int endLevel) {
+		size_t total = 0;
+		for (int level = firstLevel; level < endLevel; level++) {
+			total += (size_t)MipBytes(width, height, level);
+		}
+		pixels.resize(total);
+
+		std::vector<unsigned char> current;
+		std::vector<unsigned char> next;
+		const unsigned char* source = image;
+		size_t offset = 0;
+		for (int level = 0; level < endLevel; level++) {
+			size_t bytes = (size_t)MipBytes(width, height, level);
+			if (level >= firstLevel) {
+				memcpy(&pixels[offset], source, bytes);
+				offset += bytes;
+			}
+			if (level + 1 < endLevel) {
+				next.resize((size_t)MipBytes(width, height, level + 1));
+				DownsampleSrgb(source, MipSize(width, level), MipSize(height, level), &next[0]);
+				current.swap(next);
+				source = &current[0];
+			}
+		}
+	}
+
+	Model3D::Model3D()
+	{
+		report = LoadReport::NO_RECORD;
+		bounds = glm::vec4(0.0f);
+		bufferBytes = 0;
+		textureBytes = 0;
+		maxTextureSize = 0;
+		texelDensity = 0.0f;
+	}
+
 	void Model3D::LoadModel(std::string fileName)
 	{
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		LoadModel(fileName, basePath);
 	}
 
     void Model3D::LoadModel(std::string fileName, std::string basePath)
 	{
-		ReadOBJ(fileName, basePath);
+		if (!Parse(fileName, basePath)) {
+			exit(1);
+		}
+		for (int i = 0; i < GetPendingTextureCount(); i++) {
+			DecodeTexture(i);
+		}
+		Upload();
+	}
+
+	bool Model3D::Parse(std::string fileName)
+	{
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+		return Parse(fileName, basePath);
+	}
+
+	bool Model3D::Parse(std::string fileName, std::string basePath)
+	{
+		size_t dot = fileName.find_last_of('.');
+		std::string extension = dot == std::string::npos ? std::string() : fileName.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		bool parsed = extension == ".glb" ? ReadGLB(fileName, basePath) : ReadOBJ(fileName, basePath);
+		// one slot per texture before they are decoded in parallel
+		if (textureReports.size() < pendingTextures.size()) {
+			textureReports.resize(pendingTextures.size(), (size_t)LoadReport::NO_RECORD);
+		}
+		return parsed;
+	}
+
+	int Model3D::GetPendingTextureCount()
+	{
+		return (int)pendingTextures.size();
+	}
+
+	bool Model3D::DecodeTexture(int index)
+	{
+		return DecodeTexture(index, 0);
+	}
+
+	bool Model3D::DecodeTexture(int index, int resolution)
+	{
+		PendingTexture& texture = pendingTextures[index];
+		textureReports[index] = LoadReport::Begin(LOAD_TEXTURE, texture.path, textureReports[index]);
+		texture.report = textureReports[index];
+		return ReadTextureFromFile(texture.path, texture.fileOffset, texture.fileSize, resolution, -1,
+			&LoadReport::Get(texture.report), texture.width, texture.height, texture.mips);
+	}
+
+	void Model3D::Upload()
+	{
+		UploadData(NULL);
+	}
+
+	void Model3D::Upload(UploadThread& uploader)
+	{
+		UploadData(&uploader);
+	}
+
+	void Model3D::CreateVertexArrays()
+	{
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (meshes[i].getBuffers().VAO == 0) {
+				meshes[i].CreateVertexArray();
+			}
+		}
+	}
+
+	void Model3D::UploadData(UploadThread* uploader)
+	{
+		GPS_PROFILE_SCOPE("Model3D::Upload");
+		for (size_t i = 0; i < pendingTextures.size(); i++) {
+			gps::Texture texture;
+			texture.id = UploadTexture(pendingTextures[i], uploader);
+			texture.type = pendingTextures[i].type;
+			texture.path = pendingTextures[i].path;
+			loadedTextures.push_back(texture);
+		}
+
+		for (size_t i = 0; i < pendingMeshes.size(); i++) {
+			PendingMesh& pending = pendingMeshes[i];
+			std::vector<gps::Texture> textures;
+			for (size_t t = 0; t < pending.textures.size(); t++) {
+				textures.push_back(loadedTextures[pending.textures[t]]);
+			}
+			long long start = Profiler::Now();
+			if (uploader != NULL) {
+				gps::Buffers buffers;
+				buffers.VAO = 0;
+				glGenBuffers(1, &buffers.VBO);
+				glGenBuffers(1, &buffers.EBO);
+				uploader->UploadBuffer(buffers.VBO, pending.vertices.data(), pending.vertices.size() * sizeof(gps::Vertex));
+				uploader->UploadBuffer(buffers.EBO, pending.indices.data(), pending.indices.size() * sizeof(GLuint));
+				meshes.push_back(gps::Mesh(pending.vertices, pending.indices, textures, buffers));
+			}
+			else {
+				meshes.push_back(gps::Mesh(pending.vertices, pending.indices, textures));
+			}
+			LoadReport::Get(report).uploadMs += LoadReport::Elapsed(start, Profiler::Now());
+			unsigned long long meshBytes = pending.vertices.size() * sizeof(gps::Vertex) + pending.indices.size() * sizeof(GLuint);
+			LoadReport::Get(report).gpuBytes += meshBytes;
+			bufferBytes += meshBytes;
+		}
+		FreePendingData();
 	}
 
 	// Draw each mesh from the model
-	void Model3D::Draw(gps::Shader shaderProgram)
+	void Model3D::Draw(const gps::Shader& shaderProgram)
 	{
+		GPS_PROFILE_SCOPE("Model3D::Draw");
 		for (int i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shaderProgram);
 	}
 
-	// Does the parsing of the .obj file and fills in the data structure
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath){
+	// State of one streaming pass over an .obj file. Attributes are kept as
+	// they are read, since faces may refer to any earlier one; every face is
+	// triangulated and welded into the staging arrays of the current shape
+	// right away, so the per-corner index lists of tinyobj::LoadObj and the
+	// per-corner vertices built from them never exist. The staging arrays and
+	// the weld table keep their capacity from one shape to the next, and a
+	// finished shape is copied out at its exact size.
+	struct Model3D::ObjStream {
+		// a position/texcoord/normal triple and the vertex it was welded into;
+		// slots stamped with an older generation belong to earlier shapes
+		struct WeldSlot {
+			int position;
+			int texCoord;
+			int normal;
+			unsigned int generation;
+			GLuint vertex;
+		};
 
-        std::cout << "Loading : " << fileName << std::endl;
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
+		Model3D* model;
+		std::string basePath;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
 		std::vector<tinyobj::material_t> materials;
-		int materialId;
+		// set by usemtl, the shape takes the one of its first face
+		int material;
+
+		// the shape being assembled
+		std::vector<gps::Vertex> vertices;
+		std::vector<GLuint> indices;
+		int shapeMaterial;
+		std::vector<WeldSlot> weld;
+		size_t weldCount;
+		unsigned int generation;
+
+		int shapeCount;
+		int invalidFaces;
+		size_t cornerCount;
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+		// areas of the textured triangles, for the texel density
+		double objectArea;
+		double texCoordArea;
+
+		// OBJ indices are 1-based or, when negative, relative to the end; -1
+		// when missing (0) or out of range
+		static int FixIndex(int index, size_t count) {
+			if (index > 0 && (size_t)index <= count) {
+				return index - 1;
+			}
+			if (index < 0 && (size_t)(-(long long)index) <= count) {
+				return (int)count + index;
+			}
+			return -1;
+		}
+
+		static size_t WeldHash(int position, int texCoord, int normal) {
+			unsigned int hash = (unsigned int)position * 73856093u ^ (unsigned int)texCoord * 19349663u ^ (unsigned int)normal * 83492791u;
+			hash ^= hash >> 15;
+			hash *= 0x2c1b3c6du;
+			hash ^= hash >> 12;
+			return hash;
+		}
+
+		// index of the shape's vertex with these attributes, added when new
+		GLuint Weld(int position, int texCoord, int normal) {
+			// at most half full, a probe always ends on a free slot
+			if ((weldCount + 1) * 2 > weld.size()) {
+				GrowWeld();
+			}
+			size_t mask = weld.size() - 1;
+			size_t slot = WeldHash(position, texCoord, normal) & mask;
+			while (weld[slot].generation == generation) {
+				const WeldSlot& existing = weld[slot];
+				if (existing.position == position && existing.texCoord == texCoord && existing.normal == normal) {
+					return existing.vertex;
+				}
+				slot = (slot + 1) & mask;
+			}
+			WeldSlot& added = weld[slot];
+			added.position = position;
+			added.texCoord = texCoord;
+			added.normal = normal;
+			added.generation = generation;
+			added.vertex = (GLuint)vertices.size();
+			weldCount++;
+
+			gps::Vertex vertex;
+			vertex.Position = positions[position];
+			vertex.Normal = normal >= 0 ? normals[normal] : glm::vec3(0.0f);
+			vertex.TexCoords = texCoord >= 0 ? texCoords[texCoord] : glm::vec2(0.0f);
+			vertices.push_back(vertex);
+			return added.vertex;
+		}
+
+		void GrowWeld() {
+			std::vector<WeldSlot> old;
+			old.swap(weld);
+			WeldSlot empty = { 0, 0, 0, 0, 0 };
+			weld.assign(std::max((size_t)1024, old.size() * 2), empty);
+			size_t mask = weld.size() - 1;
+			for (size_t i = 0; i < old.size(); i++) {
+				if (old[i].generation != generation) {
+					continue;
+				}
+				size_t slot = WeldHash(old[i].position, old[i].texCoord, old[i].normal) & mask;
+				while (weld[slot].generation == generation) {
+					slot = (slot + 1) & mask;
+				}
+				weld[slot] = old[i];
+			}
+		}
+
+		static void OnVertex(void* data, float x, float y, float z, float /*w*/) {
+			ObjStream& stream = *(ObjStream*)data;
+			glm::vec3 position(x, y, z);
+			stream.minimum = glm::min(stream.minimum, position);
+			stream.maximum = glm::max(stream.maximum, position);
+			stream.positions.push_back(position);
+		}
+
+		static void OnNormal(void* data, float x, float y, float z) {
+			((ObjStream*)data)->normals.push_back(glm::vec3(x, y, z));
+		}
+
+		static void OnTexCoord(void* data, float x, float y, float /*z*/) {
+			((ObjStream*)data)->texCoords.push_back(glm::vec2(x, y));
+		}
+
+		static void OnFace(void* data, tinyobj::index_t* corners, int count) {
+			ObjStream& stream = *(ObjStream*)data;
+			if (stream.indices.empty()) {
+				stream.shapeMaterial = stream.material;
+			}
+			// polygons become triangle fans, as with tinyobj::LoadObj's triangulation
+			for (int k = 2; k < count; k++) {
+				const tinyobj::index_t* triangle[3] = { &corners[0], &corners[k - 1], &corners[k] };
+				int position[3];
+				bool valid = true;
+				for (int c = 0; c < 3; c++) {
+					position[c] = FixIndex(triangle[c]->vertex_index, stream.positions.size());
+					valid = valid && position[c] >= 0;
+				}
+				if (!valid) {
+					stream.invalidFaces++;
+					continue;
+				}
+				GLuint welded[3];
+				for (int c = 0; c < 3; c++) {
+					welded[c] = stream.Weld(position[c], FixIndex(triangle[c]->texcoord_index, stream.texCoords.size()),
+						FixIndex(triangle[c]->normal_index, stream.normals.size()));
+					stream.indices.push_back(welded[c]);
+				}
+				stream.cornerCount += 3;
+
+				if (FixIndex(triangle[0]->texcoord_index, stream.texCoords.size()) >= 0) {
+					const gps::Vertex& a = stream.vertices[welded[0]];
+					const gps::Vertex& b = stream.vertices[welded[1]];
+					const gps::Vertex& c = stream.vertices[welded[2]];
+					stream.objectArea += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+					glm::vec2 u = b.TexCoords - a.TexCoords;
+					glm::vec2 w = c.TexCoords - a.TexCoords;
+					stream.texCoordArea += fabs(u.x * w.y - u.y * w.x);
+				}
+			}
+		}
+
+		static void OnUseMaterial(void* data, const char* /*name*/, int materialId) {
+			((ObjStream*)data)->material = materialId;
+		}
+
+		static void OnMaterialLibrary(void* data, const tinyobj::material_t* materials, int count) {
+			((ObjStream*)data)->materials.assign(materials, materials + count);
+		}
+
+		// a group or object line starts a new shape, as in tinyobj::LoadObj
+		static void OnGroup(void* data, const char** /*names*/, int /*count*/) {
+			ObjStream& stream = *(ObjStream*)data;
+			stream.model->FlushObjShape(stream);
+		}
+
+		static void OnObject(void* data, const char* /*name*/) {
+			ObjStream& stream = *(ObjStream*)data;
+			stream.model->FlushObjShape(stream);
+		}
+	};
+
+	// Does the parsing of the .obj file and fills in the pending meshes
+	bool Model3D::ReadOBJ(std::string fileName, std::string basePath){
+		GPS_PROFILE_SCOPE("Model3D::ReadOBJ");
 
+		// the output of parallel loads would interleave, so it is printed in one piece
+        std::ostringstream message;
+        message << "Loading : " << fileName << "\n";
+		report = LoadReport::Begin(LOAD_MODEL, fileName, report);
+
+		// read the file first so disk time and parse time are reported apart
+		long long start = Profiler::Now();
+		FileData objFile;
+		bool read = FileSystem::ReadFile(fileName, objFile) && !objFile.IsEmpty();
+		// parsed in place, from the archive mapping or the loose file's bytes
+		MemoryStream objStream(objFile.GetData(), objFile.GetSize());
+		LoadReport::Get(report).diskBytes = objFile.GetSize();
+		LoadReport::Get(report).ioMs = LoadReport::Elapsed(start, Profiler::Now());
+
+		// welding happens as the faces are read, so all of it counts as parsing;
+		// texture loads have their own records
+		start = Profiler::Now();
+		ObjStream stream;
+		stream.model = this;
+		stream.basePath = basePath;
+		stream.material = -1;
+		stream.shapeMaterial = -1;
+		stream.weldCount = 0;
+		stream.generation = 1;
+		stream.shapeCount = 0;
+		stream.invalidFaces = 0;
+		stream.cornerCount = 0;
+		stream.minimum = glm::vec3(FLT_MAX);
+		stream.maximum = glm::vec3(-FLT_MAX);
+		stream.objectArea = 0.0;
+		stream.texCoordArea = 0.0;
+
+		tinyobj::callback_t callbacks;
+		callbacks.vertex_cb = ObjStream::OnVertex;
+		callbacks.normal_cb = ObjStream::OnNormal;
+		callbacks.texcoord_cb = ObjStream::OnTexCoord;
+		callbacks.index_cb = ObjStream::OnFace;
+		callbacks.usemtl_cb = ObjStream::OnUseMaterial;
+		callbacks.mtllib_cb = ObjStream::OnMaterialLibrary;
+		callbacks.group_cb = ObjStream::OnGroup;
+		callbacks.object_cb = ObjStream::OnObject;
+
+		// the .mtl is small and read by the parser itself
 		std::string err;
-		bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName.c_str(), basePath.c_str(), GL_TRUE);
+		AssetMaterialReader materialReader(basePath);
+		bool ret = read && tinyobj::LoadObjWithCallback(objStream, callbacks, &stream, &materialReader, &err);
+		if (!read) {
+			err = "Could not read " + fileName;
+		}
+		if (ret) {
+			FlushObjShape(stream);
+		}
+		LoadReport::Get(report).parseMs = LoadReport::Elapsed(start, Profiler::Now());
 
+		if (stream.invalidFaces > 0) {
+			err += (err.empty() ? "" : "\n") + fileName + ": " + std::to_string(stream.invalidFaces) + " faces with invalid vertex indices were skipped";
+		}
 		if (!err.empty()) { // `err` may contain warning message.
 			std::cerr << err << std::endl;
 		}
 
 		if (!ret) {
-			exit(1);
+			std::cout << message.str();
+			return false;
 		}
 
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
+		message << "# of shapes    : " << stream.shapeCount << "\n";
+		message << "# of materials : " << stream.materials.size() << "\n";
+		message << "# of vertices  : " << stream.cornerCount << " corners welded into ";
+		size_t welded = 0;
+		for (size_t i = 0; i < pendingMeshes.size(); i++) {
+			welded += pendingMeshes[i].vertices.size();
+		}
+		message << welded << "\n";
+		std::cout << message.str();
 
-		// Loop over shapes
-		for (size_t s = 0; s < shapes.size(); s++) {
-			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+		// bounding sphere around the box of every vertex, used for culling
+		if (!stream.positions.empty()) {
+			bounds = glm::vec4((stream.minimum + stream.maximum) * 0.5f, glm::length(stream.maximum - stream.minimum) * 0.5f);
+		}
+		texelDensity = stream.objectArea > 0.0 ? (float)sqrt(stream.texCoordArea / stream.objectArea) : 0.0f;
+		return true;
+	}
 
-			// Loop over faces(polygon)
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-				int fv = shapes[s].mesh.num_face_vertices[f];
-
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
-
-				// Loop over vertices in the face.
-				for (size_t v = 0; v < fv; v++) {
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-					float vx = attrib.vertices[3 * idx.vertex_index + 0];
-					float vy = attrib.vertices[3 * idx.vertex_index + 1];
-					float vz = attrib.vertices[3 * idx.vertex_index + 2];
-					float nx = attrib.normals[3 * idx.normal_index + 0];
-					float ny = attrib.normals[3 * idx.normal_index + 1];
-					float nz = attrib.normals[3 * idx.normal_index + 2];
-					float tx = 0.0f;
-					float ty = 0.0f;
-					if (idx.texcoord_index != -1) {
-						tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-						ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-					}
+	void Model3D::FlushObjShape(ObjStream& stream) {
+		if (stream.indices.empty()) {
+			return;
+		}
+		// exact sizes: the staging arrays keep their capacity for the next shape
+		pendingMeshes.push_back(PendingMesh());
+		std::vector<gps::Vertex>& vertices = pendingMeshes.back().vertices;
+		std::vector<GLuint>& indices = pendingMeshes.back().indices;
+		std::vector<int>& textures = pendingMeshes.back().textures;
+		vertices.assign(stream.vertices.begin(), stream.vertices.end());
+		indices.assign(stream.indices.begin(), stream.indices.end());
+		stream.vertices.clear();
+		stream.indices.clear();
+		// a new generation empties the weld table without touching it
+		stream.weldCount = 0;
+		stream.generation++;
+		stream.shapeCount++;
 
-					glm::vec3 vertexPosition(vx, vy, vz);
-					glm::vec3 vertexNormal(nx, ny, nz);
-					glm::vec2 vertexTexCoords(tx, ty);
+		// get material id
+		// Only try to read materials if the .mtl file is present
+		int materialId = stream.shapeMaterial;
+		if (materialId >= 0 && materialId < (int)stream.materials.size()) {
+			const tinyobj::material_t& material = stream.materials[materialId];
 
-					gps::Vertex currentVertex;
-					currentVertex.Position = vertexPosition;
-					currentVertex.Normal = vertexNormal;
-					currentVertex.TexCoords = vertexTexCoords;
+			//ambient texture
+			std::string ambientTexturePath = material.ambient_texname;
+			if (!ambientTexturePath.empty())
+			{
+				textures.push_back(AddTexture(stream.basePath + ambientTexturePath, "ambientTexture", 0, 0));
+			}
 
-					vertices.push_back(currentVertex);
+			//diffuse texture
+			std::string diffuseTexturePath = material.diffuse_texname;
+			if (!diffuseTexturePath.empty())
+			{
+				textures.push_back(AddTexture(stream.basePath + diffuseTexturePath, "diffuseTexture", 0, 0));
+			}
 
-					indices.push_back(index_offset + v);
-				}
+			//specular texture
+			std::string specularTexturePath = material.specular_texname;
+			if (!specularTexturePath.empty())
+			{
+				textures.push_back(AddTexture(stream.basePath + specularTexturePath, "specularTexture", 0, 0));
+			}
+		}
+
+		unsigned long long meshBytes = vertices.size() * sizeof(gps::Vertex) + indices.size() * sizeof(GLuint);
+		LoadReport::Get(report).cpuBytes += meshBytes;
+	}
 
-				index_offset += fv;
+	bool Model3D::ReadGLB(std::string fileName, std::string basePath) {
+		GPS_PROFILE_SCOPE("Model3D::ReadGLB");
+
+		std::ostringstream message;
+		message << "Loading : " << fileName << "\n";
+		report = LoadReport::Begin(LOAD_MODEL, fileName, report);
+
+		// the file stays in memory (mapped, from the archive) while the meshes are read from it
+		long long start = Profiler::Now();
+		FileData file;
+		bool read = FileSystem::ReadFile(fileName, file);
+		LoadReport::Get(report).diskBytes = file.GetSize();
+		LoadReport::Get(report).ioMs = LoadReport::Elapsed(start, Profiler::Now());
+
+		start = Profiler::Now();
+		std::string err;
+		JsonValue gltf;
+		const unsigned char* bin = NULL;
+		size_t binSize = 0;
+		if (!read) {
+			err = "Could not read " + fileName;
+		}
+		else if (!GlbSplit(file.GetData(), file.GetSize(), gltf, bin, binSize, err)) {
+			err = fileName + ": " + err;
+		}
+		else if (gltf["asset"]["version"].GetString().compare(0, 2, "2.") != 0) {
+			err = fileName + ": unsupported glTF version";
+		}
+
+		// buffer 0 without a uri is the BIN chunk, others are external files
+		const JsonValue& bufferList = gltf["buffers"];
+		std::vector<FileData> externalFiles(bufferList.GetSize());
+		std::vector<GltfBuffer> buffers;
+		for (size_t i = 0; err.empty() && i < bufferList.GetSize(); i++) {
+			const std::string& uri = bufferList[i]["uri"].GetString();
+			GltfBuffer buffer;
+			buffer.data = NULL;
+			buffer.size = 0;
+			buffer.path = fileName;
+			buffer.fileOffset = 0;
+			if (uri.empty() && i == 0 && bin != NULL) {
+				buffer.data = bin;
+				buffer.size = binSize;
+				buffer.fileOffset = (size_t)(bin - file.GetData());
+			}
+			else if (!uri.empty() && uri.compare(0, 5, "data:") != 0 && FileSystem::ReadFile(basePath + uri, externalFiles[i])) {
+				buffer.data = externalFiles[i].GetData();
+				buffer.size = externalFiles[i].GetSize();
+				buffer.path = basePath + uri;
+			}
+			// the BIN chunk is padded, the buffer may be shorter
+			double declared = bufferList[i]["byteLength"].GetNumber(0.0);
+			if (declared >= 0.0 && declared < (double)buffer.size) {
+				buffer.size = (size_t)declared;
 			}
+			buffers.push_back(buffer);
+		}
+
+		// meshes of the default scene, with their node transforms; every mesh
+		// once when the file has no scene
+		std::vector<std::pair<int, glm::mat4> > instances;
+		const JsonValue& scene = gltf["scenes"][gltf["scene"].GetInt(0)];
+		for (size_t i = 0; i < scene["nodes"].GetSize(); i++) {
+			GltfCollectMeshes(gltf, scene["nodes"][i].GetInt(-1), glm::mat4(1.0f), 0, instances);
+		}
+		if (scene.IsNull()) {
+			for (size_t i = 0; i < gltf["meshes"].GetSize(); i++) {
+				instances.push_back(std::make_pair((int)i, glm::mat4(1.0f)));
+			}
+		}
 
-			// get material id
-			// Only try to read materials if the .mtl file is present
-			int a = shapes[s].mesh.material_ids.size();
-			if (a > 0 && materials.size()>0) {
-				materialId = shapes[s].mesh.material_ids[0];
-				if (materialId != -1) {
-					gps::Material currentMaterial;
-					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
-					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
-					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
+		glm::vec3 minimum(FLT_MAX);
+		glm::vec3 maximum(-FLT_MAX);
+		// areas of the textured triangles, for the texel density
+		double objectArea = 0.0;
+		double texCoordArea = 0.0;
+		int skipped = 0;
+		for (size_t n = 0; n < instances.size() && err.empty(); n++) {
+			const JsonValue& primitives = gltf["meshes"][instances[n].first]["primitives"];
+			const glm::mat4& transform = instances[n].second;
+			glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+			// a mirroring transform turns the triangles around
+			bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
 
-					//ambient texture
-					std::string ambientTexturePath = materials[materialId].ambient_texname;
-					if (!ambientTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
+			for (size_t p = 0; p < primitives.GetSize() && err.empty(); p++) {
+				const JsonValue& primitive = primitives[p];
+				if (primitive["mode"].GetInt(GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+					skipped++;
+					continue;
+				}
+				const JsonValue& attributes = primitive["attributes"];
+				bool hasNormals = attributes.Has("NORMAL");
+				bool hasTexCoords = attributes.Has("TEXCOORD_0");
+				bool indexed = primitive.Has("indices");
+				GltfAccessor positions;
+				GltfAccessor normals;
+				GltfAccessor texCoords;
+				GltfAccessor indexAccessor;
+				if (!GltfGetAccessor(gltf, buffers, attributes["POSITION"].GetInt(-1), positions) || positions.components != 3
+					|| (hasNormals && (!GltfGetAccessor(gltf, buffers, attributes["NORMAL"].GetInt(-1), normals)
+						|| normals.components != 3 || normals.count != positions.count))
+					|| (hasTexCoords && (!GltfGetAccessor(gltf, buffers, attributes["TEXCOORD_0"].GetInt(-1), texCoords)
+						|| texCoords.components != 2 || texCoords.count != positions.count))
+					|| (indexed && (!GltfGetAccessor(gltf, buffers, primitive["indices"].GetInt(-1), indexAccessor)
+						|| indexAccessor.components != 1 || indexAccessor.componentType == 5126))) {
+					err = "invalid accessors in mesh " + std::to_string(instances[n].first) + " of " + fileName;
+					break;
+				}
+
+				pendingMeshes.push_back(PendingMesh());
+				std::vector<gps::Vertex>& vertices = pendingMeshes.back().vertices;
+				std::vector<GLuint>& indices = pendingMeshes.back().indices;
+				std::vector<int>& textures = pendingMeshes.back().textures;
+
+				// straight from the buffer into the interleaved layout the meshes upload
+				vertices.resize(positions.count);
+				for (size_t v = 0; v < positions.count; v++) {
+					glm::vec3 position(GltfReadFloat(positions, v, 0), GltfReadFloat(positions, v, 1), GltfReadFloat(positions, v, 2));
+					vertices[v].Position = glm::vec3(transform * glm::vec4(position, 1.0f));
+					vertices[v].Normal = glm::vec3(0.0f);
+					if (hasNormals) {
+						glm::vec3 normal(GltfReadFloat(normals, v, 0), GltfReadFloat(normals, v, 1), GltfReadFloat(normals, v, 2));
+						vertices[v].Normal = glm::normalize(normalTransform * normal);
 					}
+					// glTF puts the texture origin at the top, the decoded images are flipped for OBJ's bottom one
+					vertices[v].TexCoords = hasTexCoords ? glm::vec2(GltfReadFloat(texCoords, v, 0), 1.0f - GltfReadFloat(texCoords, v, 1)) : glm::vec2(0.0f);
+					minimum = glm::min(minimum, vertices[v].Position);
+					maximum = glm::max(maximum, vertices[v].Position);
+				}
 
-					//diffuse texture
-					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
-					if (!diffuseTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
+				size_t indexCount = indexed ? indexAccessor.count : positions.count;
+				indexCount -= indexCount % 3;
+				indices.resize(indexCount);
+				if (indexed && indexAccessor.componentType == 5125 && indexAccessor.stride == sizeof(GLuint) && indexCount > 0) {
+					memcpy(&indices[0], indexAccessor.data, indexCount * sizeof(GLuint));
+				}
+				else {
+					for (size_t i = 0; i < indexCount; i++) {
+						indices[i] = indexed ? GltfReadIndex(indexAccessor, i) : (GLuint)i;
 					}
+				}
 
-					//specular texture
-					std::string specularTexturePath = materials[materialId].specular_texname;
-					if (!specularTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
+				for (size_t i = 0; i < indexCount; i += 3) {
+					if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size()) {
+						err = "index out of range in mesh " + std::to_string(instances[n].first) + " of " + fileName;
+						break;
+					}
+					if (mirrored) {
+						std::swap(indices[i + 1], indices[i + 2]);
+					}
+					const gps::Vertex& a = vertices[indices[i]];
+					const gps::Vertex& b = vertices[indices[i + 1]];
+					const gps::Vertex& c = vertices[indices[i + 2]];
+					glm::vec3 faceNormal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+					if (!hasNormals) {
+						// smooth normals weighted by area, in place of the ones the file leaves out
+						vertices[indices[i]].Normal += faceNormal;
+						vertices[indices[i + 1]].Normal += faceNormal;
+						vertices[indices[i + 2]].Normal += faceNormal;
+					}
+					if (hasTexCoords) {
+						objectArea += glm::length(faceNormal);
+						glm::vec2 u = b.TexCoords - a.TexCoords;
+						glm::vec2 w = c.TexCoords - a.TexCoords;
+						texCoordArea += fabs(u.x * w.y - u.y * w.x);
 					}
 				}
+				if (!hasNormals) {
+					for (size_t v = 0; v < vertices.size(); v++) {
+						float length = glm::length(vertices[v].Normal);
+						vertices[v].Normal = length > 0.0f ? vertices[v].Normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+					}
+				}
+
+				// the base color is what the shader samples as diffuseTexture
+				const JsonValue& material = gltf["materials"][primitive["material"].GetInt(-1)];
+				std::string path;
+				size_t offset;
+				size_t size;
+				if (GltfTextureImage(gltf, buffers, material["pbrMetallicRoughness"]["baseColorTexture"]["index"].GetInt(-1), basePath, path, offset, size)) {
+					textures.push_back(AddTexture(path, "diffuseTexture", offset, size));
+				}
+				if (GltfTextureImage(gltf, buffers, material["extensions"]["KHR_materials_specular"]["specularColorTexture"]["index"].GetInt(-1),
+					basePath, path, offset, size)) {
+					textures.push_back(AddTexture(path, "specularTexture", offset, size));
+				}
+
+				unsigned long long meshBytes = vertices.size() * sizeof(gps::Vertex) + indices.size() * sizeof(GLuint);
+				LoadReport::Get(report).cpuBytes += meshBytes;
 			}
+		}
+		// no textures are read above, all of it is parsing
+		LoadReport::Get(report).parseMs = LoadReport::Elapsed(start, Profiler::Now());
+
+		if (!err.empty()) {
+			std::cerr << err << std::endl;
+			std::cout << message.str();
+			pendingMeshes.clear();
+			pendingTextures.clear();
+			return false;
+		}
+		if (skipped > 0) {
+			std::cerr << fileName << ": " << skipped << " primitives are not triangle lists and were skipped" << std::endl;
+		}
+
+		message << "# of meshes    : " << pendingMeshes.size() << "\n";
+		message << "# of materials : " << gltf["materials"].GetSize() << "\n";
+		std::cout << message.str();
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+		if (!pendingMeshes.empty()) {
+			bounds = glm::vec4((minimum + maximum) * 0.5f, glm::length(maximum - minimum) * 0.5f);
 		}
+		texelDensity = objectArea > 0.0 ? (float)sqrt(texCoordArea / objectArea) : 0.0f;
+		return true;
 	}
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
+	// Finds or adds the texture of a material - by its file, range and type
+	int Model3D::AddTexture(std::string path, std::string type, size_t fileOffset, size_t fileSize) {
 
-			for (int i = 0; i < loadedTextures.size(); i++) {
-				if (loadedTextures[i].path == path)
+			for (size_t i = 0; i < pendingTextures.size(); i++) {
+				if (pendingTextures[i].path == path && pendingTextures[i].fileOffset == fileOffset)
 				{
-					//already loaded texture
-					return loadedTextures[i];
+					//already listed texture
+					return (int)i;
 				}
 			}
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
+			PendingTexture texture;
+			texture.path = path;
+			texture.type = type;
+			texture.fileOffset = fileOffset;
+			texture.fileSize = fileSize;
+			texture.width = 0;
+			texture.height = 0;
+			texture.mips.firstLevel = 0;
+			texture.mips.endLevel = 0;
+			texture.report = 0;
+			pendingTextures.push_back(texture);
+
+			return (int)pendingTextures.size() - 1;
+		}
+
+	// Reads the pixel data of a texture from its image file
+	bool Model3D::ReadTextureFromFile(const std::string& path, size_t fileOffset, size_t fileSize, int resolution, int endLevel,
+		LoadRecord* record, int& width, int& height, MipLevels& mips) {
+		// the first load of a streamed texture needs only what --pack prebuilt
+		if (endLevel < 0 && resolution > 0 && ReadMipTail(path, fileOffset, fileSize, resolution, record, width, height, mips)) {
+			return true;
+		}
+		return DecodeTextureFile(path, fileOffset, fileSize, resolution, endLevel, record, width, height, mips);
+	}
+
+	bool Model3D::ReadMipTail(const std::string& path, size_t fileOffset, size_t fileSize, int resolution,
+		LoadRecord* record, int& width, int& height, MipLevels& mips) {
+		// tails only ever exist in a cooked archive
+		if (!FileSystem::IsMounted()) {
+			return false;
+		}
+		GPS_PROFILE_SCOPE("Model3D::ReadMipTail");
+		long long start = Profiler::Now();
+		FileData file;
+		if (!FileSystem::ReadFile(MipTailName(path, fileOffset, fileSize), file) || file.GetSize() < sizeof(MipTailHeader)) {
+			return false;
+		}
+		MipTailHeader header;
+		memcpy(&header, file.GetData(), sizeof(header));
+		if (header.magic != MIP_TAIL_MAGIC || header.version != MIP_TAIL_VERSION
+			|| header.width <= 0 || header.height <= 0 || header.width > 65536 || header.height > 65536) {
+			return false;
+		}
+		int levelCount = MipLevelCount(header.width, header.height);
+		int firstLevel = MipLevelFor(header.width, header.height, resolution);
+		if (header.firstLevel < 0 || header.firstLevel >= levelCount || firstLevel < header.firstLevel) {
+			return false;
+		}
+		unsigned long long skipped = 0;
+		unsigned long long size = 0;
+		for (int level = header.firstLevel; level < levelCount; level++) {
+			if (level < firstLevel) {
+				skipped += MipBytes(header.width, header.height, level);
+			}
+			else {
+				size += MipBytes(header.width, header.height, level);
+			}
+		}
+		if (file.GetSize() != sizeof(header) + skipped + size) {
+			return false;
+		}
+
+		const unsigned char* pixels = file.GetData() + sizeof(header) + skipped;
+		mips.firstLevel = firstLevel;
+		mips.endLevel = levelCount;
+		mips.pixels.assign(pixels, pixels + size);
+		width = header.width;
+		height = header.height;
+		if (record != NULL) {
+			record->diskBytes = file.GetSize();
+			record->ioMs = LoadReport::Elapsed(start, Profiler::Now());
+			record->cpuBytes = mips.pixels.size();
+		}
+		return true;
+	}
 
-			loadedTextures.push_back(currentTexture);
+	bool Model3D::CookMipTails(int resolution, std::vector<CookedFile>& cooked) {
+		bool cookedAll = true;
+		for (size_t i = 0; i < pendingTextures.size(); i++) {
+			const PendingTexture& texture = pendingTextures[i];
+			std::string name = MipTailName(texture.path, texture.fileOffset, texture.fileSize);
+			bool known = false;
+			for (size_t c = 0; c < cooked.size() && !known; c++) {
+				known = cooked[c].name == name;
+			}
+			if (known) {
+				continue;
+			}
+			int width;
+			int height;
+			MipLevels mips;
+			if (!DecodeTextureFile(texture.path, texture.fileOffset, texture.fileSize, resolution, -1, NULL, width, height, mips)) {
+				cookedAll = false;
+				continue;
+			}
+			MipTailHeader header = { MIP_TAIL_MAGIC, MIP_TAIL_VERSION, width, height, mips.firstLevel };
+			cooked.push_back(CookedFile());
+			cooked.back().name = name;
+			std::vector<unsigned char>& bytes = cooked.back().bytes;
+			bytes.resize(sizeof(header) + mips.pixels.size());
+			memcpy(&bytes[0], &header, sizeof(header));
+			if (!mips.pixels.empty()) {
+				memcpy(&bytes[sizeof(header)], &mips.pixels[0], mips.pixels.size());
+			}
+		}
+		return cookedAll;
+	}
+
+	std::string Model3D::MipTailName(const std::string& path, size_t fileOffset, size_t fileSize) {
+		if (fileSize == 0) {
+			return path + ".mips";
+		}
+		return path + "@" + std::to_string(fileOffset) + ".mips";
+	}
 
-			return currentTexture;
+	bool Model3D::DecodeTextureFile(const std::string& path, size_t fileOffset, size_t fileSize, int resolution, int endLevel,
+		LoadRecord* record, int& width, int& height, MipLevels& mips) {
+		GPS_PROFILE_SCOPE("Model3D::DecodeTextureFile");
+		const char* file_name = path.c_str();
+		long long start = Profiler::Now();
+		FileData file;
+		if (fileSize != 0) {
+			FileSystem::ReadRange(path, fileOffset, fileSize, file);
+		}
+		else {
+			FileSystem::ReadFile(path, file);
+		}
+		if (record != NULL) {
+			record->diskBytes = file.GetSize();
+			record->ioMs = LoadReport::Elapsed(start, Profiler::Now());
 		}
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
+		start = Profiler::Now();
 		int x, y, n;
 		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
+		unsigned char* image_data = file.IsEmpty() ? NULL : stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &x, &y, &n, force_channels);
 		if (!image_data) {
 			fprintf(stderr, "ERROR: could not load %s\n", file_name);
 			return false;
 		}
-		// NPOT check
-		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
+		// NPOT check, once per texture
+		if (record != NULL && ((x & (x - 1)) != 0 || (y & (y - 1)) != 0)) {
 			fprintf(
 				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
 			);
@@ -190,33 +1210,242 @@ namespace gps {
 				bottom++;
 			}
 		}
+		if (record != NULL) {
+			record->decodeMs = LoadReport::Elapsed(start, Profiler::Now());
+		}
+
+		// the whole chain is built from level 0, only the requested levels are kept
+		start = Profiler::Now();
+		int levelCount = MipLevelCount(x, y);
+		mips.firstLevel = MipLevelFor(x, y, resolution);
+		mips.endLevel = endLevel < 0 ? levelCount : std::min(endLevel, levelCount);
+		BuildMipChain(image_data, x, y, mips.pixels, mips.firstLevel, mips.endLevel);
+		stbi_image_free(image_data);
+		if (record != NULL) {
+			record->mipMs = LoadReport::Elapsed(start, Profiler::Now());
+			record->cpuBytes = mips.pixels.size();
+		}
 
+		width = x;
+		height = y;
+		return true;
+	}
+
+	// Loads the decoded pixels into the video memory
+	GLuint Model3D::UploadTexture(PendingTexture& texture, UploadThread* uploader) {
+		TextureMips mips;
+		mips.fileOffset = texture.fileOffset;
+		mips.fileSize = texture.fileSize;
+		mips.width = texture.width;
+		mips.height = texture.height;
+		mips.levelCount = texture.width > 0 ? MipLevelCount(texture.width, texture.height) : 0;
+		mips.baseLevel = texture.mips.firstLevel;
+		mips.uploadedLevel = texture.mips.firstLevel;
+		mips.pending.firstLevel = 0;
+		mips.pending.endLevel = 0;
+		textureMips.push_back(mips);
+		if (texture.mips.pixels.empty()) {
+			// decoding failed or never ran
+			return 0;
+		}
+		GPS_PROFILE_SCOPE("Model3D::UploadTexture");
+		size_t report = texture.report;
+
+		long long start = Profiler::Now();
 		GLuint textureID;
 		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			image_data
-		);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		unsigned long long bytes = UploadMipLevels(textureID, texture.width, texture.height, texture.mips, uploader);
+		std::vector<unsigned char>().swap(texture.mips.pixels);
+		LoadReport::Get(report).uploadMs = LoadReport::Elapsed(start, Profiler::Now());
 
+		// only the uploaded levels count, the rest streams in later
+		Stats::AddMemory(MEMORY_TEXTURES, (long long)bytes);
+		LoadReport::Get(report).gpuBytes = bytes;
+		textureBytes += bytes;
+
+		glBindTexture(GL_TEXTURE_2D, textureID);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// the missing levels above the base are never sampled
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mips.baseLevel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.levelCount - 1);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, (float)mips.baseLevel);
 		glBindTexture(GL_TEXTURE_2D, 0);
 
 		return textureID;
 	}
 
-	Model3D::~Model3D() {
+	unsigned long long Model3D::UploadMipLevels(GLuint textureId, int width, int height, const MipLevels& mips, UploadThread* uploader) {
+		unsigned long long bytes = 0;
+		if (uploader == NULL) {
+			glBindTexture(GL_TEXTURE_2D, textureId);
+		}
+		for (int level = mips.firstLevel; level < mips.endLevel; level++) {
+			int levelWidth = MipSize(width, level);
+			int levelHeight = MipSize(height, level);
+			const unsigned char* pixels = &mips.pixels[(size_t)bytes];
+			if (uploader != NULL) {
+				uploader->UploadTexture(textureId, level, GL_SRGB, levelWidth, levelHeight, pixels);
+			}
+			else {
+				glTexImage2D(GL_TEXTURE_2D, level, GL_SRGB, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+			}
+			bytes += MipBytes(width, height, level);
+		}
+		return bytes;
+	}
+
+	int Model3D::GetTextureCount() {
+		return (int)loadedTextures.size();
+	}
+
+	bool Model3D::DecodeMips(int index, int resolution) {
+		TextureMips& mips = textureMips[index];
+		if (loadedTextures[index].id == 0 || MipLevelFor(mips.width, mips.height, resolution) >= mips.uploadedLevel) {
+			return true;
+		}
+		int width;
+		int height;
+		if (!ReadTextureFromFile(loadedTextures[index].path, mips.fileOffset, mips.fileSize, resolution, mips.uploadedLevel,
+			NULL, width, height, mips.pending)) {
+			return false;
+		}
+		if (width != mips.width || height != mips.height) {
+			// the file changed since it was loaded, its levels would not match
+			std::vector<unsigned char>().swap(mips.pending.pixels);
+			mips.pending.firstLevel = 0;
+			mips.pending.endLevel = 0;
+		}
+		return true;
+	}
+
+	void Model3D::UploadMips(UploadThread* uploader) {
+		GPS_PROFILE_SCOPE("Model3D::UploadMips");
+		for (size_t i = 0; i < textureMips.size(); i++) {
+			TextureMips& mips = textureMips[i];
+			if (mips.pending.pixels.empty()) {
+				continue;
+			}
+			unsigned long long bytes = UploadMipLevels(loadedTextures[i].id, mips.width, mips.height, mips.pending, uploader);
+			Stats::AddMemory(MEMORY_TEXTURES, (long long)bytes);
+			textureBytes += bytes;
+			mips.uploadedLevel = mips.pending.firstLevel;
+			std::vector<unsigned char>().swap(mips.pending.pixels);
+			mips.pending.firstLevel = 0;
+			mips.pending.endLevel = 0;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void Model3D::ApplyMipLevels() {
+		for (size_t i = 0; i < textureMips.size(); i++) {
+			TextureMips& mips = textureMips[i];
+			if (mips.baseLevel == mips.uploadedLevel) {
+				continue;
+			}
+			glBindTexture(GL_TEXTURE_2D, loadedTextures[i].id);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mips.uploadedLevel);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, (float)mips.uploadedLevel);
+			mips.baseLevel = mips.uploadedLevel;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void Model3D::TrimMips(int resolution) {
+		for (size_t i = 0; i < textureMips.size(); i++) {
+			TextureMips& mips = textureMips[i];
+			if (loadedTextures[i].id == 0) {
+				continue;
+			}
+			int level = MipLevelFor(mips.width, mips.height, resolution);
+			if (level <= mips.baseLevel) {
+				continue;
+			}
+			glBindTexture(GL_TEXTURE_2D, loadedTextures[i].id);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, (float)level);
+			// a level below the base is ignored for completeness, an empty image frees it
+			unsigned long long bytes = 0;
+			for (int dropped = mips.uploadedLevel; dropped < level; dropped++) {
+				glTexImage2D(GL_TEXTURE_2D, dropped, GL_SRGB, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+				bytes += MipBytes(mips.width, mips.height, dropped);
+			}
+			Stats::AddMemory(MEMORY_TEXTURES, -(long long)bytes);
+			textureBytes -= bytes;
+			mips.baseLevel = level;
+			mips.uploadedLevel = level;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	int Model3D::GetMaxTextureSize() {
+		int size = 0;
+		for (size_t i = 0; i < pendingTextures.size(); i++) {
+			size = std::max(size, std::max(pendingTextures[i].width, pendingTextures[i].height));
+		}
+		for (size_t i = 0; i < textureMips.size(); i++) {
+			size = std::max(size, std::max(textureMips[i].width, textureMips[i].height));
+		}
+		return size;
+	}
+
+	float Model3D::GetTexelDensity() {
+		return texelDensity;
+	}
+
+	// object-space positions of every parsed or uploaded mesh
+	void Model3D::GetPositions(std::vector<glm::vec3>& positions) {
+		for (size_t i = 0; i < pendingMeshes.size(); i++) {
+			for (size_t v = 0; v < pendingMeshes[i].vertices.size(); v++) {
+				positions.push_back(pendingMeshes[i].vertices[v].Position);
+			}
+		}
+		for (size_t i = 0; i < meshes.size(); i++) {
+			for (size_t v = 0; v < meshes[i].vertices.size(); v++) {
+				positions.push_back(meshes[i].vertices[v].Position);
+			}
+		}
+	}
+
+	glm::vec4 Model3D::GetBounds() {
+		return bounds;
+	}
+
+	int Model3D::GetMeshCount() {
+		return (int)(meshes.size() + pendingMeshes.size());
+	}
+
+	unsigned long long Model3D::GetCpuBytes() {
+		unsigned long long bytes = 0;
+		for (size_t i = 0; i < pendingMeshes.size(); i++) {
+			bytes += pendingMeshes[i].vertices.size() * sizeof(gps::Vertex) + pendingMeshes[i].indices.size() * sizeof(GLuint);
+		}
+		for (size_t i = 0; i < pendingTextures.size(); i++) {
+			bytes += pendingTextures[i].mips.pixels.size();
+		}
+		for (size_t i = 0; i < textureMips.size(); i++) {
+			bytes += textureMips[i].pending.pixels.size();
+		}
+		// the meshes keep their vertices after the upload
+		for (size_t i = 0; i < meshes.size(); i++) {
+			bytes += meshes[i].vertices.size() * sizeof(gps::Vertex) + meshes[i].indices.size() * sizeof(GLuint);
+		}
+		return bytes;
+	}
+
+	unsigned long long Model3D::GetGpuBytes() {
+		return bufferBytes + textureBytes;
+	}
+
+	void Model3D::FreePendingData() {
+		pendingTextures.clear();
+		pendingMeshes.clear();
+	}
+
+	void Model3D::Unload() {
+        FreePendingData();
         for (size_t i = 0; i < loadedTextures.size(); i++) {
             glDeleteTextures(1, &loadedTextures.at(i).id);
         }
@@ -229,5 +1458,16 @@ namespace gps {
             glDeleteBuffers(1, &EBO);
             glDeleteVertexArrays(1, &VAO);
         }
+        loadedTextures.clear();
+        textureMips.clear();
+        meshes.clear();
+        Stats::AddMemory(MEMORY_BUFFERS, -(long long)bufferBytes);
+        Stats::AddMemory(MEMORY_TEXTURES, -(long long)textureBytes);
+        bufferBytes = 0;
+        textureBytes = 0;
+	}
+
+	Model3D::~Model3D() {
+        Unload();
 	}
 }
@@ -2,6 +2,8 @@
 #define Model3D_hpp
 
 #include "Mesh.hpp"
+#include "LoadReport.hpp"
+#include "AssetArchive.hpp"
 
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
@@ -12,32 +14,189 @@
 
 namespace gps {
 
+    class UploadThread;
+
     class Model3D
     {
 
     public:
+        Model3D();
         ~Model3D();
 
+		// Parse, DecodeTexture and Upload in one go, exits when the file cannot be parsed
 		void LoadModel(std::string fileName);
 
 		void LoadModel(std::string fileName, std::string basePath);
 
-		void Draw(gps::Shader shaderProgram);
+		// CPU half of the loading: reads and parses the .obj or .glb file (by
+		// its extension) and lists the textures of its materials; touches no
+		// GL state, so any thread can run it
+		bool Parse(std::string fileName);
+		bool Parse(std::string fileName, std::string basePath);
+
+		// textures found by Parse, decoded one by one so they can run in parallel;
+		// the mip chain is built here too, and only the levels whose largest
+		// edge fits resolution are kept (0 keeps every level)
+		int GetPendingTextureCount();
+		bool DecodeTexture(int index);
+		bool DecodeTexture(int index, int resolution);
+
+		// Cooking (--pack): builds the levels up to resolution of every
+		// texture found by Parse and adds them to cooked under MipTailName,
+		// unless one of that name is there already. With the archive mounted,
+		// DecodeTexture at that resolution copies them instead of decoding
+		// the image. False when an image could not be read.
+		bool CookMipTails(int resolution, std::vector<CookedFile>& cooked);
+		// archive name of the prebuilt levels of an image (fileSize not 0:
+		// the range of a file holding it)
+		static std::string MipTailName(const std::string& path, size_t fileOffset, size_t fileSize);
+
+		// GPU half: creates the buffers and textures from the parsed data and
+		// frees the CPU copies of the pixels; must run on the GL thread
+		void Upload();
+		// the same on the upload thread: buffers and textures go through its
+		// staging buffer, the vertex arrays are left to CreateVertexArrays
+		void Upload(UploadThread& uploader);
+		// on the render thread, once the upload thread's fence has signaled
+		void CreateVertexArrays();
+
+		// Mip streaming of an uploaded model. DecodeMips reads a texture again
+		// and keeps the levels from resolution up to the ones already uploaded
+		// (any thread); UploadMips uploads them (GL thread, or the upload
+		// thread through uploader) and ApplyMipLevels lets the sampler use them
+		// on the thread that draws. TrimMips drops the levels above resolution.
+		int GetTextureCount();
+		bool DecodeMips(int index, int resolution);
+		void UploadMips(UploadThread* uploader);
+		void ApplyMipLevels();
+		void TrimMips(int resolution);
+
+		// largest edge of the full-size textures, 0 without textures
+		int GetMaxTextureSize();
+		// texture coordinate units per object-space unit over the textured
+		// triangles, turns a size on screen into the texture resolution it needs
+		float GetTexelDensity();
+
+		void Draw(const gps::Shader& shaderProgram);
+
+		// deletes the GL objects and every CPU copy so the model can be parsed
+		// again; the bounds are kept. Must run on the GL thread
+		void Unload();
+
+		// object-space positions of every parsed or uploaded mesh
+		void GetPositions(std::vector<glm::vec3>& positions);
+
+		// object-space bounding sphere (xyz center, w radius), known after Parse
+		glm::vec4 GetBounds();
+		int GetMeshCount();
+
+		// memory held right now: mesh data and decoded pixels on the CPU,
+		// buffers and textures (with their mip chains) on the GPU
+		unsigned long long GetCpuBytes();
+		unsigned long long GetGpuBytes();
 
     private:
+		// levels [firstLevel, endLevel) of a mip chain, packed largest first
+		struct MipLevels {
+			int firstLevel;
+			int endLevel;
+			std::vector<unsigned char> pixels;
+		};
+
+		// a decoded image waiting for Upload
+		struct PendingTexture {
+			std::string path;
+			std::string type;
+			// bytes of the image inside the file (an image embedded in a .glb),
+			// fileSize 0 for the whole file
+			size_t fileOffset;
+			size_t fileSize;
+			// full size, level 0
+			int width;
+			int height;
+			MipLevels mips;
+			size_t report;
+		};
+
+		// mip levels of an uploaded texture, parallel to loadedTextures
+		struct TextureMips {
+			// where DecodeMips reads the image again, as in PendingTexture
+			size_t fileOffset;
+			size_t fileSize;
+			int width;
+			int height;
+			int levelCount;
+			// lowest level the sampler may use, and the lowest one with data
+			int baseLevel;
+			int uploadedLevel;
+			// read by DecodeMips, waiting for UploadMips
+			MipLevels pending;
+		};
+
+		// an assembled mesh waiting for Upload, textures index pendingTextures
+		struct PendingMesh {
+			std::vector<gps::Vertex> vertices;
+			std::vector<GLuint> indices;
+			std::vector<int> textures;
+		};
+
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
 		// Associated textures
         std::vector<gps::Texture> loadedTextures;
+		std::vector<TextureMips> textureMips;
+
+		std::vector<PendingMesh> pendingMeshes;
+		std::vector<PendingTexture> pendingTextures;
+		// LoadReport record of the model itself, and of its textures by
+		// index; kept through Unload, a reload reuses them
+		size_t report;
+		std::vector<size_t> textureReports;
+		glm::vec4 bounds;
+		unsigned long long bufferBytes;
+		unsigned long long textureBytes;
+		int maxTextureSize;
+		float texelDensity;
+
+		// state of the streaming .obj parse, in Model3D.cpp
+		struct ObjStream;
+
+		// Streams the .obj file through the parser and fills in the pending
+		// meshes, one welded mesh per shape
+		bool ReadOBJ(std::string fileName, std::string basePath);
+		// moves the shape assembled so far into a pending mesh
+		void FlushObjShape(ObjStream& stream);
+		// the same for a binary glTF 2.0 file: triangle primitives of the
+		// default scene, placed by their nodes, with their base color textures
+		bool ReadGLB(std::string fileName, std::string basePath);
+
+		// Finds or adds the texture of a material - by its file, range and type
+		int AddTexture(std::string path, std::string type, size_t fileOffset, size_t fileSize);
+
+		// Reads the pixel data of a texture from its image file (or the range
+		// of it, when fileSize is not 0) and keeps the levels of its mip chain
+		// from the one fitting resolution up to endLevel (-1 = the last one);
+		// record is NULL when the load is not reported. Levels down to the
+		// last one are read from the cooked tail when it holds them all
+		bool ReadTextureFromFile(const std::string& path, size_t fileOffset, size_t fileSize, int resolution, int endLevel,
+			LoadRecord* record, int& width, int& height, MipLevels& mips);
+		// the same, always decoding the image
+		bool DecodeTextureFile(const std::string& path, size_t fileOffset, size_t fileSize, int resolution, int endLevel,
+			LoadRecord* record, int& width, int& height, MipLevels& mips);
+		// the levels from resolution down from the archive; false when it has
+		// no valid tail of the image or the tail starts below that level
+		bool ReadMipTail(const std::string& path, size_t fileOffset, size_t fileSize, int resolution,
+			LoadRecord* record, int& width, int& height, MipLevels& mips);
 
-		// Does the parsing of the .obj file and fills in the data structure
-		void ReadOBJ(std::string fileName, std::string basePath);
+		// both uploads, straight from client memory when uploader is NULL
+		void UploadData(UploadThread* uploader);
 
-		// Retrieves a texture associated with the object - by its name and type
-		gps::Texture LoadTexture(std::string path, std::string type);
+		// Loads the decoded pixels into the video memory
+		GLuint UploadTexture(PendingTexture& texture, UploadThread* uploader);
+		// one level per glTexImage2D; returns the bytes uploaded
+		unsigned long long UploadMipLevels(GLuint textureId, int width, int height, const MipLevels& mips, UploadThread* uploader);
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		void FreePendingData();
     };
 }
 
@@ -0,0 +1,224 @@
+#include "Options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace gps {
+
+    Options::Options()
+    {
+        headless = false;
+        width = 1024;
+        height = 768;
+        frames = 0;
+        benchmark = false;
+        warmupFrames = 10;
+        assertNoAlloc = false;
+        tickRate = 60.0;
+        vsync = true;
+        singleThread = false;
+        jobs = -1;
+        jobsBench = false;
+        cpuBudgetMB = 512;
+        gpuBudgetMB = 512;
+        loadDistance = 8.0f;
+        preload = false;
+        syncUploads = false;
+        mipStreaming = true;
+        worldGrid = 1;
+        streamRadius = 2;
+    }
+
+    void printUsage(const char* program)
+    {
+        std::cout << "Usage: " << program << " [options]\n"
+            << "  --headless          render offscreen (EGL/OSMesa-style context, no window)\n"
+            << "  --size WxH          framebuffer size (default 1024x768)\n"
+            << "  --frames N          exit after N frames\n"
+            << "  --screenshot FILE   save the last frame as a binary .ppm\n"
+            << "  --benchmark         replay a camera path at a fixed time step (600 frames unless --frames)\n"
+            << "  --path FILE         camera path for the benchmark (default: orbit)\n"
+            << "  --warmup N          frames excluded from the statistics (default 10)\n"
+            << "  --benchmark-out F   write the benchmark results as JSON\n"
+            << "  --record-path FILE  save the interactive camera movement as a path\n"
+            << "  --record-input FILE log every key and cursor event for later replay\n"
+            << "  --replay-input FILE replay a recorded input log instead of live input, exit when it ends\n"
+            << "  --trace FILE        write a Chrome trace_event profile on exit (P writes one on demand)\n"
+            << "  --load-report FILE  write per-asset load timings (.csv, otherwise JSON)\n"
+            << "  --assert-no-alloc   exit with an error when a frame after the warm-up allocates\n"
+            << "  --tick-rate N       simulation ticks per second (default 60)\n"
+            << "  --no-vsync          present without waiting for the display refresh\n"
+            << "  --single-thread     simulate and render on one thread\n"
+            << "  --jobs N            job system worker threads, 0 = main thread only (default: one per core)\n"
+            << "  --jobs-bench        time the CPU workloads on 1..N threads and exit\n"
+            << "  --cpu-budget MB     memory for streamed models before eviction (default 512)\n"
+            << "  --gpu-budget MB     video memory for streamed models before eviction (default 512)\n"
+            << "  --load-distance D   load models within D of the camera even out of view (default 8)\n"
+            << "  --preload           load every model at startup instead of streaming\n"
+            << "  --sync-uploads      upload streamed models on the render thread, no upload thread\n"
+            << "  --no-mip-streaming  load textures with every mip level instead of small ones first\n"
+            << "  --world FILE        tiled world to stream (default: the single city)\n"
+            << "  --world-grid N      without --world, an NxN grid of copies of the city\n"
+            << "  --stream-radius N   tiles kept around the camera in each direction (default 2)\n"
+            << "  --archive FILE      read the assets from this archive (default: assets.pak if present)\n"
+            << "  --pack FILE         cook models/, textures/ and shaders/ into an archive, with\n"
+            << "                      prebuilt small mip levels, and exit\n"
+            << "  --help              show this message" << std::endl;
+    }
+
+    bool parseOptions(int argc, const char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            const char* arg = argv[i];
+            // every option except the flags takes one value
+            bool hasValue = i + 1 < argc;
+
+            if (strcmp(arg, "--headless") == 0) {
+                options.headless = true;
+            }
+            else if (strcmp(arg, "--size") == 0 && hasValue) {
+                // WxH, e.g. 1920x1080
+                char* end = NULL;
+                long width = strtol(argv[++i], &end, 10);
+                long height = (*end == 'x') ? strtol(end + 1, &end, 10) : 0;
+                if (width <= 0 || height <= 0 || *end != '\0') {
+                    std::cerr << "Invalid size: " << argv[i] << std::endl;
+                    return false;
+                }
+                options.width = (int)width;
+                options.height = (int)height;
+            }
+            else if (strcmp(arg, "--frames") == 0 && hasValue) {
+                options.frames = atoi(argv[++i]);
+            }
+            else if (strcmp(arg, "--screenshot") == 0 && hasValue) {
+                options.screenshotPath = argv[++i];
+            }
+            else if (strcmp(arg, "--benchmark") == 0) {
+                options.benchmark = true;
+            }
+            else if (strcmp(arg, "--path") == 0 && hasValue) {
+                options.cameraPath = argv[++i];
+            }
+            else if (strcmp(arg, "--warmup") == 0 && hasValue) {
+                options.warmupFrames = atoi(argv[++i]);
+            }
+            else if (strcmp(arg, "--benchmark-out") == 0 && hasValue) {
+                options.benchmarkOut = argv[++i];
+            }
+            else if (strcmp(arg, "--record-path") == 0 && hasValue) {
+                options.recordPath = argv[++i];
+            }
+            else if (strcmp(arg, "--record-input") == 0 && hasValue) {
+                options.recordInputPath = argv[++i];
+            }
+            else if (strcmp(arg, "--replay-input") == 0 && hasValue) {
+                options.replayInputPath = argv[++i];
+            }
+            else if (strcmp(arg, "--trace") == 0 && hasValue) {
+                options.tracePath = argv[++i];
+            }
+            else if (strcmp(arg, "--no-vsync") == 0) {
+                options.vsync = false;
+            }
+            else if (strcmp(arg, "--single-thread") == 0) {
+                options.singleThread = true;
+            }
+            else if (strcmp(arg, "--jobs") == 0 && hasValue) {
+                options.jobs = atoi(argv[++i]);
+                if (options.jobs < 0) {
+                    std::cerr << "Invalid job count: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--jobs-bench") == 0) {
+                options.jobsBench = true;
+            }
+            else if ((strcmp(arg, "--cpu-budget") == 0 || strcmp(arg, "--gpu-budget") == 0) && hasValue) {
+                int megabytes = atoi(argv[i + 1]);
+                if (megabytes <= 0) {
+                    std::cerr << "Invalid memory budget: " << argv[i + 1] << std::endl;
+                    return false;
+                }
+                if (strcmp(arg, "--cpu-budget") == 0) {
+                    options.cpuBudgetMB = megabytes;
+                }
+                else {
+                    options.gpuBudgetMB = megabytes;
+                }
+                i++;
+            }
+            else if (strcmp(arg, "--load-distance") == 0 && hasValue) {
+                options.loadDistance = (float)strtod(argv[++i], NULL);
+                if (options.loadDistance < 0.0f) {
+                    std::cerr << "Invalid load distance: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--preload") == 0) {
+                options.preload = true;
+            }
+            else if (strcmp(arg, "--sync-uploads") == 0) {
+                options.syncUploads = true;
+            }
+            else if (strcmp(arg, "--no-mip-streaming") == 0) {
+                options.mipStreaming = false;
+            }
+            else if (strcmp(arg, "--world") == 0 && hasValue) {
+                options.worldPath = argv[++i];
+            }
+            else if (strcmp(arg, "--world-grid") == 0 && hasValue) {
+                options.worldGrid = atoi(argv[++i]);
+                if (options.worldGrid < 1) {
+                    std::cerr << "Invalid world grid: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--stream-radius") == 0 && hasValue) {
+                options.streamRadius = atoi(argv[++i]);
+                if (options.streamRadius < 0) {
+                    std::cerr << "Invalid stream radius: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--archive") == 0 && hasValue) {
+                options.archivePath = argv[++i];
+            }
+            else if (strcmp(arg, "--pack") == 0 && hasValue) {
+                options.packPath = argv[++i];
+            }
+            else if (strcmp(arg, "--tick-rate") == 0 && hasValue) {
+                options.tickRate = strtod(argv[++i], NULL);
+                if (options.tickRate <= 0.0) {
+                    std::cerr << "Invalid tick rate: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(arg, "--assert-no-alloc") == 0) {
+                options.assertNoAlloc = true;
+            }
+            else if (strcmp(arg, "--load-report") == 0 && hasValue) {
+                options.loadReportPath = argv[++i];
+            }
+            else {
+                if (strcmp(arg, "--help") != 0) {
+                    std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+                }
+                printUsage(argv[0]);
+                return false;
+            }
+        }
+
+        if (options.benchmark && options.frames == 0) {
+            options.frames = 600;
+        }
+        if (options.benchmark || options.assertNoAlloc) {
+            options.preload = true;
+        }
+        if (options.warmupFrames >= options.frames && options.frames > 0) {
+            options.warmupFrames = 0;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef Options_hpp
+#define Options_hpp
+
+#include <string>
+
+namespace gps {
+
+    // command-line switches of the application
+    struct Options {
+        // render offscreen into a framebuffer object instead of a visible window
+        bool headless;
+        int width;
+        int height;
+        // stop after this many frames (0 = run until the window is closed)
+        int frames;
+        // write the last rendered frame to this .ppm file on exit
+        std::string screenshotPath;
+
+        // replay a camera path at a fixed time step and report frame statistics
+        bool benchmark;
+        int warmupFrames;
+        // camera path to replay (built-in orbit when empty)
+        std::string cameraPath;
+        // JSON report written at the end of a benchmark run
+        std::string benchmarkOut;
+        // records the interactive camera as a path file on exit
+        std::string recordPath;
+        // binary log of every key and cursor event, written while running
+        std::string recordInputPath;
+        // feeds a recorded input log back instead of the live keyboard and mouse
+        std::string replayInputPath;
+        // Chrome trace of the CPU profiler written on exit (P dumps it on demand)
+        std::string tracePath;
+        // per-asset load timings written after startup (.csv or JSON)
+        std::string loadReportPath;
+        // fail when a frame after the warm-up allocates from the heap
+        bool assertNoAlloc;
+        // simulation ticks per second, independent of the frame rate
+        double tickRate;
+        // wait for the display refresh when presenting
+        bool vsync;
+        // simulate and render on the main thread instead of handing frame
+        // packets to a separate render thread
+        bool singleThread;
+        // job system worker threads besides the main thread (-1 = one per core)
+        int jobs;
+        // time the loading and transform workloads on 1..N threads and exit
+        bool jobsBench;
+        // memory the streamed models may use before the least recently seen are evicted
+        int cpuBudgetMB;
+        int gpuBudgetMB;
+        // models of entities closer than this to the camera load even when not in view
+        float loadDistance;
+        // load every model before the first frame instead of streaming them in
+        // (implied by --benchmark and --assert-no-alloc, which need a steady scene)
+        bool preload;
+        // upload streamed models on the render thread instead of a separate
+        // thread with its own shared context
+        bool syncUploads;
+        // load textures with their small levels only and stream the rest by
+        // screen size (off with --preload)
+        bool mipStreaming;
+        // tiled world to stream (a grid of the original city when empty)
+        std::string worldPath;
+        // columns and rows of that grid
+        int worldGrid;
+        // tiles kept around the camera in each direction
+        int streamRadius;
+        // asset archive to read from (the default one, if present, when empty)
+        std::string archivePath;
+        // cook the assets into this archive and exit
+        std::string packPath;
+
+        Options();
+    };
+
+    // parses argv into options, prints the usage and returns false on bad input
+    bool parseOptions(int argc, const char* argv[], Options& options);
+    void printUsage(const char* program);
+}
+
+#endif /* Options_hpp */
@@ -0,0 +1,365 @@
+#include "Overlay.hpp"
+#include "Stats.hpp"
+
+namespace gps {
+
+    namespace {
+        const int FIRST_GLYPH = 32;
+        const int GLYPH_COUNT = 95;
+        // the atlas is 16 x 6 cells, glyphs 32..126 followed by one solid cell
+        const int ATLAS_COLUMNS = 16;
+        const int ATLAS_ROWS = 6;
+        const int SOLID_CELL = GLYPH_COUNT;
+
+        // 8x12 monochrome glyphs rasterized from DejaVu Sans Mono, one byte per row, MSB left
+        const unsigned char fontGlyphs[GLYPH_COUNT][Overlay::GLYPH_HEIGHT] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+        { 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00 }, // '!'
+        { 0x00, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+        { 0x00, 0x14, 0x24, 0x7E, 0x28, 0x28, 0xFC, 0x48, 0x50, 0x00, 0x00, 0x00 }, // '#'
+        { 0x00, 0x10, 0x3C, 0x50, 0x50, 0x38, 0x14, 0x14, 0x78, 0x10, 0x10, 0x00 }, // '$'
+        { 0x00, 0xE0, 0xA0, 0xE4, 0x18, 0x20, 0xDC, 0x14, 0x1C, 0x00, 0x00, 0x00 }, // '%'
+        { 0x00, 0x38, 0x20, 0x20, 0x30, 0x5A, 0x4A, 0x44, 0x3E, 0x00, 0x00, 0x00 }, // '&'
+        { 0x00, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '\''
+        { 0x10, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x10, 0x00, 0x00 }, // '('
+        { 0x20, 0x20, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x20, 0x20, 0x00, 0x00 }, // ')'
+        { 0x00, 0x10, 0x54, 0x38, 0x38, 0x54, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '*'
+        { 0x00, 0x00, 0x00, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00 }, // '+'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x20, 0x00, 0x00 }, // ','
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '-'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00 }, // '.'
+        { 0x00, 0x04, 0x08, 0x08, 0x10, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00 }, // '/'
+        { 0x00, 0x3C, 0x66, 0x42, 0x4A, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00 }, // '0'
+        { 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00 }, // '1'
+        { 0x00, 0x3C, 0x42, 0x02, 0x06, 0x0C, 0x18, 0x20, 0x7E, 0x00, 0x00, 0x00 }, // '2'
+        { 0x00, 0x3C, 0x42, 0x02, 0x3C, 0x06, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00 }, // '3'
+        { 0x00, 0x0C, 0x0C, 0x14, 0x24, 0x64, 0x7E, 0x04, 0x04, 0x00, 0x00, 0x00 }, // '4'
+        { 0x00, 0x7C, 0x40, 0x40, 0x7C, 0x06, 0x02, 0x02, 0x7C, 0x00, 0x00, 0x00 }, // '5'
+        { 0x00, 0x1E, 0x20, 0x40, 0x5C, 0x62, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00 }, // '6'
+        { 0x00, 0x7E, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00, 0x00, 0x00 }, // '7'
+        { 0x00, 0x3C, 0x42, 0x42, 0x3C, 0x42, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00 }, // '8'
+        { 0x00, 0x3C, 0x42, 0x42, 0x42, 0x3E, 0x02, 0x04, 0x78, 0x00, 0x00, 0x00 }, // '9'
+        { 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00 }, // ':'
+        { 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x10, 0x20, 0x00, 0x00 }, // ';'
+        { 0x00, 0x00, 0x00, 0x02, 0x1C, 0x60, 0x38, 0x06, 0x00, 0x00, 0x00, 0x00 }, // '<'
+        { 0x00, 0x00, 0x00, 0x00, 0xFC, 0x00, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '='
+        { 0x00, 0x00, 0x00, 0x40, 0x38, 0x06, 0x1C, 0x60, 0x00, 0x00, 0x00, 0x00 }, // '>'
+        { 0x00, 0x38, 0x04, 0x0C, 0x18, 0x10, 0x10, 0x00, 0x10, 0x00, 0x00, 0x00 }, // '?'
+        { 0x00, 0x1C, 0x26, 0x42, 0x4E, 0x52, 0x52, 0x4E, 0x60, 0x20, 0x1C, 0x00 }, // '@'
+        { 0x00, 0x18, 0x18, 0x18, 0x24, 0x24, 0x3C, 0x42, 0x42, 0x00, 0x00, 0x00 }, // 'A'
+        { 0x00, 0x7C, 0x42, 0x42, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x00, 0x00, 0x00 }, // 'B'
+        { 0x00, 0x1C, 0x22, 0x40, 0x40, 0x40, 0x40, 0x22, 0x1C, 0x00, 0x00, 0x00 }, // 'C'
+        { 0x00, 0x78, 0x44, 0x42, 0x42, 0x42, 0x42, 0x44, 0x78, 0x00, 0x00, 0x00 }, // 'D'
+        { 0x00, 0x7E, 0x40, 0x40, 0x7E, 0x40, 0x40, 0x40, 0x7E, 0x00, 0x00, 0x00 }, // 'E'
+        { 0x00, 0x7E, 0x40, 0x40, 0x7E, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00 }, // 'F'
+        { 0x00, 0x1C, 0x22, 0x40, 0x40, 0x46, 0x42, 0x22, 0x1C, 0x00, 0x00, 0x00 }, // 'G'
+        { 0x00, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00 }, // 'H'
+        { 0x00, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00 }, // 'I'
+        { 0x00, 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00 }, // 'J'
+        { 0x00, 0x44, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44, 0x42, 0x00, 0x00, 0x00 }, // 'K'
+        { 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7E, 0x00, 0x00, 0x00 }, // 'L'
+        { 0x00, 0x42, 0x66, 0x66, 0x5A, 0x5A, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00 }, // 'M'
+        { 0x00, 0x42, 0x62, 0x52, 0x52, 0x4A, 0x4A, 0x46, 0x42, 0x00, 0x00, 0x00 }, // 'N'
+        { 0x00, 0x3C, 0x66, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00 }, // 'O'
+        { 0x00, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00 }, // 'P'
+        { 0x00, 0x3C, 0x66, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x06, 0x00, 0x00 }, // 'Q'
+        { 0x00, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x44, 0x42, 0x41, 0x00, 0x00, 0x00 }, // 'R'
+        { 0x00, 0x3C, 0x42, 0x40, 0x78, 0x06, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00 }, // 'S'
+        { 0x00, 0xFE, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 }, // 'T'
+        { 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00 }, // 'U'
+        { 0x00, 0x42, 0x42, 0x24, 0x24, 0x24, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00 }, // 'V'
+        { 0x00, 0x82, 0x92, 0x92, 0xAA, 0x6C, 0x6C, 0x44, 0x44, 0x00, 0x00, 0x00 }, // 'W'
+        { 0x00, 0x42, 0x24, 0x24, 0x18, 0x18, 0x24, 0x24, 0x42, 0x00, 0x00, 0x00 }, // 'X'
+        { 0x00, 0xC6, 0x44, 0x28, 0x38, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 }, // 'Y'
+        { 0x00, 0x7E, 0x04, 0x04, 0x08, 0x10, 0x30, 0x20, 0x7E, 0x00, 0x00, 0x00 }, // 'Z'
+        { 0x30, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x30, 0x00, 0x00 }, // '['
+        { 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00 }, // '\\'
+        { 0x30, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x30, 0x00, 0x00 }, // ']'
+        { 0x00, 0x30, 0x48, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '^'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFE }, // '_'
+        { 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+        { 0x00, 0x00, 0x00, 0x78, 0x04, 0x3C, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00 }, // 'a'
+        { 0x40, 0x40, 0x40, 0x78, 0x44, 0x44, 0x44, 0x44, 0x78, 0x00, 0x00, 0x00 }, // 'b'
+        { 0x00, 0x00, 0x00, 0x3C, 0x60, 0x40, 0x40, 0x60, 0x3C, 0x00, 0x00, 0x00 }, // 'c'
+        { 0x04, 0x04, 0x04, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00 }, // 'd'
+        { 0x00, 0x00, 0x00, 0x38, 0x44, 0x7C, 0x40, 0x40, 0x3C, 0x00, 0x00, 0x00 }, // 'e'
+        { 0x0C, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 }, // 'f'
+        { 0x00, 0x00, 0x00, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x04, 0x38, 0x00 }, // 'g'
+        { 0x40, 0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00 }, // 'h'
+        { 0x10, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00 }, // 'i'
+        { 0x10, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x60, 0x00 }, // 'j'
+        { 0x40, 0x40, 0x40, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44, 0x00, 0x00, 0x00 }, // 'k'
+        { 0xE0, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x18, 0x00, 0x00, 0x00 }, // 'l'
+        { 0x00, 0x00, 0x00, 0x7C, 0x54, 0x54, 0x54, 0x54, 0x54, 0x00, 0x00, 0x00 }, // 'm'
+        { 0x00, 0x00, 0x00, 0x58, 0x64, 0x44, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00 }, // 'n'
+        { 0x00, 0x00, 0x00, 0x38, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00, 0x00, 0x00 }, // 'o'
+        { 0x00, 0x00, 0x00, 0x78, 0x44, 0x44, 0x44, 0x44, 0x78, 0x40, 0x40, 0x00 }, // 'p'
+        { 0x00, 0x00, 0x00, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x04, 0x04, 0x00 }, // 'q'
+        { 0x00, 0x00, 0x00, 0x3C, 0x24, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00 }, // 'r'
+        { 0x00, 0x00, 0x00, 0x3C, 0x40, 0x70, 0x0C, 0x04, 0x78, 0x00, 0x00, 0x00 }, // 's'
+        { 0x00, 0x20, 0x20, 0xF8, 0x20, 0x20, 0x20, 0x20, 0x38, 0x00, 0x00, 0x00 }, // 't'
+        { 0x00, 0x00, 0x00, 0x44, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00 }, // 'u'
+        { 0x00, 0x00, 0x00, 0x44, 0x44, 0x28, 0x28, 0x28, 0x10, 0x00, 0x00, 0x00 }, // 'v'
+        { 0x00, 0x00, 0x00, 0x82, 0x82, 0x54, 0x54, 0x28, 0x28, 0x00, 0x00, 0x00 }, // 'w'
+        { 0x00, 0x00, 0x00, 0x6C, 0x28, 0x10, 0x10, 0x28, 0x6C, 0x00, 0x00, 0x00 }, // 'x'
+        { 0x00, 0x00, 0x00, 0x44, 0x48, 0x28, 0x28, 0x30, 0x10, 0x20, 0x60, 0x00 }, // 'y'
+        { 0x00, 0x00, 0x00, 0x7C, 0x08, 0x18, 0x30, 0x20, 0x7C, 0x00, 0x00, 0x00 }, // 'z'
+        { 0x1C, 0x10, 0x10, 0x10, 0x60, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00, 0x00 }, // '{'
+        { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00 }, // '|'
+        { 0x70, 0x10, 0x10, 0x10, 0x0C, 0x10, 0x10, 0x10, 0x10, 0x70, 0x00, 0x00 }, // '}'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+        };
+    }
+
+    Overlay::Overlay()
+    {
+        visible = false;
+        vao = 0;
+        vbo = 0;
+        fontTexture = 0;
+        screenSizeLocation = -1;
+        fontTextureLocation = -1;
+        width = 1;
+        height = 1;
+        for (int i = 0; i < GRAPH_SAMPLES; i++) {
+            frameTimes[i] = 0.0f;
+        }
+        nextFrameTime = 0;
+    }
+
+    Overlay::~Overlay()
+    {
+        Delete();
+    }
+
+    void Overlay::Create(const char* vertexShaderFileName, const char* fragmentShaderFileName)
+    {
+        Delete();
+        shader.loadShader(vertexShaderFileName, fragmentShaderFileName);
+        screenSizeLocation = glGetUniformLocation(shader.shaderProgram, "screenSize");
+        fontTextureLocation = glGetUniformLocation(shader.shaderProgram, "fontTexture");
+
+        CreateFontTexture();
+
+        // the batch never grows past MAX_QUADS, so it is allocated once
+        vertices.reserve(MAX_QUADS * 6);
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, MAX_QUADS * 6 * sizeof(OverlayVertex), NULL, GL_STREAM_DRAW);
+        Stats::AddMemory(MEMORY_BUFFERS, MAX_QUADS * 6 * sizeof(OverlayVertex));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (GLvoid*)offsetof(OverlayVertex, x));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (GLvoid*)offsetof(OverlayVertex, u));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayVertex), (GLvoid*)offsetof(OverlayVertex, color));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Overlay::Delete()
+    {
+        if (vao == 0) {
+            return;
+        }
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteTextures(1, &fontTexture);
+        glDeleteProgram(shader.shaderProgram);
+        Stats::AddMemory(MEMORY_BUFFERS, -(long long)(MAX_QUADS * 6 * sizeof(OverlayVertex)));
+        Stats::AddMemory(MEMORY_TEXTURES, -(long long)(ATLAS_COLUMNS * GLYPH_WIDTH * ATLAS_ROWS * GLYPH_HEIGHT));
+        vao = 0;
+        vbo = 0;
+        fontTexture = 0;
+    }
+
+    // expands the 1-bit glyphs into a single-channel atlas
+    void Overlay::CreateFontTexture()
+    {
+        const int atlasWidth = ATLAS_COLUMNS * GLYPH_WIDTH;
+        const int atlasHeight = ATLAS_ROWS * GLYPH_HEIGHT;
+        std::vector<unsigned char> pixels(atlasWidth * atlasHeight, 0);
+
+        for (int cell = 0; cell <= SOLID_CELL; cell++) {
+            int originX = (cell % ATLAS_COLUMNS) * GLYPH_WIDTH;
+            int originY = (cell / ATLAS_COLUMNS) * GLYPH_HEIGHT;
+            for (int row = 0; row < GLYPH_HEIGHT; row++) {
+                unsigned char bits = cell == SOLID_CELL ? 0xFF : fontGlyphs[cell][row];
+                for (int column = 0; column < GLYPH_WIDTH; column++) {
+                    if (bits & (0x80 >> column)) {
+                        pixels[(originY + row) * atlasWidth + originX + column] = 255;
+                    }
+                }
+            }
+        }
+
+        glGenTextures(1, &fontTexture);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Stats::AddMemory(MEMORY_TEXTURES, atlasWidth * atlasHeight);
+    }
+
+    void Overlay::SetVisible(bool visible)
+    {
+        this->visible = visible;
+    }
+
+    bool Overlay::IsVisible()
+    {
+        return visible;
+    }
+
+    void Overlay::AddFrameTime(float milliseconds)
+    {
+        frameTimes[nextFrameTime] = milliseconds;
+        nextFrameTime = (nextFrameTime + 1) % GRAPH_SAMPLES;
+    }
+
+    void Overlay::Begin(int width, int height)
+    {
+        this->width = width > 0 ? width : 1;
+        this->height = height > 0 ? height : 1;
+        vertices.clear();
+    }
+
+    void Overlay::AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int color)
+    {
+        if (vertices.size() + 6 > (size_t)MAX_QUADS * 6) {
+            return;
+        }
+        unsigned char r = (unsigned char)(color >> 24);
+        unsigned char g = (unsigned char)(color >> 16);
+        unsigned char b = (unsigned char)(color >> 8);
+        unsigned char a = (unsigned char)color;
+        OverlayVertex corners[4] = {
+            { x0, y0, u0, v0, { r, g, b, a } },
+            { x1, y0, u1, v0, { r, g, b, a } },
+            { x1, y1, u1, v1, { r, g, b, a } },
+            { x0, y1, u0, v1, { r, g, b, a } },
+        };
+        // two triangles, counter-clockwise once y is flipped to point up
+        vertices.push_back(corners[0]);
+        vertices.push_back(corners[3]);
+        vertices.push_back(corners[2]);
+        vertices.push_back(corners[0]);
+        vertices.push_back(corners[2]);
+        vertices.push_back(corners[1]);
+    }
+
+    void Overlay::Print(float x, float y, const char* text, unsigned int color)
+    {
+        const float cellU = 1.0f / ATLAS_COLUMNS;
+        const float cellV = 1.0f / ATLAS_ROWS;
+        float penX = x;
+        for (const char* c = text; *c != '\0'; c++) {
+            if (*c == '\n') {
+                penX = x;
+                y += GLYPH_HEIGHT;
+                continue;
+            }
+            int glyph = *c - FIRST_GLYPH;
+            if (glyph > 0 && glyph < GLYPH_COUNT) {
+                float u = (glyph % ATLAS_COLUMNS) * cellU;
+                float v = (glyph / ATLAS_COLUMNS) * cellV;
+                AddQuad(penX, y, penX + GLYPH_WIDTH, y + GLYPH_HEIGHT, u, v, u + cellU, v + cellV, color);
+            }
+            penX += GLYPH_WIDTH;
+        }
+    }
+
+    void Overlay::Rect(float x, float y, float width, float height, unsigned int color)
+    {
+        // sample the middle of the solid cell
+        float u = ((SOLID_CELL % ATLAS_COLUMNS) + 0.5f) / ATLAS_COLUMNS;
+        float v = ((SOLID_CELL / ATLAS_COLUMNS) + 0.5f) / ATLAS_ROWS;
+        AddQuad(x, y, x + width, y + height, u, v, u, v, color);
+    }
+
+    void Overlay::FrameGraph(float x, float y, float width, float height, float maxMilliseconds)
+    {
+        Rect(x, y, width, height, 0x00000080);
+        float barWidth = width / GRAPH_SAMPLES;
+        for (int i = 0; i < GRAPH_SAMPLES; i++) {
+            // oldest sample on the left
+            float value = frameTimes[(nextFrameTime + i) % GRAPH_SAMPLES];
+            float barHeight = value / maxMilliseconds * height;
+            if (barHeight > height) {
+                barHeight = height;
+            }
+            // green up to 60 fps, yellow up to 30 fps, red beyond
+            unsigned int color = value <= 16.7f ? 0x40E040FF : (value <= 33.4f ? 0xE0E040FF : 0xE04040FF);
+            Rect(x + i * barWidth, y + height - barHeight, barWidth, barHeight, color);
+        }
+        // 60 fps reference line
+        float line = 16.7f / maxMilliseconds * height;
+        if (line < height) {
+            Rect(x, y + height - line, width, 1.0f, 0xFFFFFF80);
+        }
+    }
+
+    void Overlay::End()
+    {
+        if (!visible || vertices.empty() || vao == 0) {
+            return;
+        }
+
+        // the scene may have left wireframe, blending or smoothing on
+        GLint polygonMode[2];
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        GLboolean polygonSmooth = glIsEnabled(GL_POLYGON_SMOOTH);
+        GLint blendSrc, blendDst;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrc);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDst);
+
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_POLYGON_SMOOTH);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // orphan the previous contents, then upload the whole batch
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, MAX_QUADS * 6 * sizeof(OverlayVertex), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(OverlayVertex), &vertices[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        shader.useShaderProgram();
+        glUniform2f(screenSizeLocation, (float)width, (float)height);
+        glUniform1i(fontTextureLocation, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+        if (depthTest) {
+            glEnable(GL_DEPTH_TEST);
+        }
+        if (cullFace) {
+            glEnable(GL_CULL_FACE);
+        }
+        if (polygonSmooth) {
+            glEnable(GL_POLYGON_SMOOTH);
+        }
+        if (!blend) {
+            glDisable(GL_BLEND);
+        }
+        glBlendFunc(blendSrc, blendDst);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef Overlay_hpp
+#define Overlay_hpp
+
+#include "GL/glew.h"
+
+#include "Shader.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // Screen-space text and graph overlay. Everything printed between Begin and
+    // End is batched into one vertex buffer and drawn with a single call, using
+    // an embedded 8x12 bitmap font.
+    class Overlay
+    {
+    public:
+        static const int GLYPH_WIDTH = 8;
+        static const int GLYPH_HEIGHT = 12;
+        static const int MAX_QUADS = 4096;
+        // frame times kept for the graph
+        static const int GRAPH_SAMPLES = 120;
+
+        Overlay();
+        ~Overlay();
+
+        void Create(const char* vertexShaderFileName, const char* fragmentShaderFileName);
+        void Delete();
+
+        void SetVisible(bool visible);
+        bool IsVisible();
+
+        // appends a frame time to the graph history
+        void AddFrameTime(float milliseconds);
+
+        // starts a new batch for a width x height framebuffer
+        void Begin(int width, int height);
+        // pixel coordinates from the top left corner, color is 0xRRGGBBAA
+        void Print(float x, float y, const char* text, unsigned int color);
+        void Rect(float x, float y, float width, float height, unsigned int color);
+        // bar graph of the frame time history, scaled so maxMilliseconds fills the height
+        void FrameGraph(float x, float y, float width, float height, float maxMilliseconds);
+        // uploads the batch and draws it over the current frame
+        void End();
+
+    private:
+        struct OverlayVertex {
+            float x, y;
+            float u, v;
+            unsigned char color[4];
+        };
+
+        bool visible;
+        GLuint vao;
+        GLuint vbo;
+        GLuint fontTexture;
+        gps::Shader shader;
+        GLint screenSizeLocation;
+        GLint fontTextureLocation;
+
+        std::vector<OverlayVertex> vertices;
+        int width;
+        int height;
+
+        float frameTimes[GRAPH_SAMPLES];
+        int nextFrameTime;
+
+        void CreateFontTexture();
+        void AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int color);
+    };
+}
+
+#endif /* Overlay_hpp */
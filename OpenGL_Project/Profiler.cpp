@@ -0,0 +1,204 @@
+#include "Profiler.hpp"
+#include "AllocTracker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace gps {
+
+    namespace {
+        struct ProfileEvent {
+            const char* name;
+            long long start;
+            long long end;
+        };
+
+        struct ThreadBuffer {
+            // only ever contended while a trace is being written
+            std::mutex mutex;
+            ProfileEvent* events;
+            // total number of events written, the ring index is count % capacity
+            unsigned long long count;
+            const char* name;
+            int id;
+        };
+
+        std::chrono::high_resolution_clock::time_point profilerEpoch = std::chrono::high_resolution_clock::now();
+        std::atomic<bool> profilerEnabled(true);
+
+        // every buffer ever created, they live until the process exits
+        std::mutex buffersMutex;
+        std::vector<ThreadBuffer*> buffers;
+
+        ThreadBuffer* createBuffer(const char* name)
+        {
+            ThreadBuffer* buffer = new ThreadBuffer();
+            buffer->events = new ProfileEvent[Profiler::EVENTS_PER_THREAD];
+            buffer->count = 0;
+            buffer->name = name;
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffer->id = (int)buffers.size() + 1;
+            buffers.push_back(buffer);
+            return buffer;
+        }
+
+        thread_local ThreadBuffer* threadBuffer = NULL;
+
+        ThreadBuffer* getThreadBuffer()
+        {
+            if (threadBuffer == NULL) {
+                threadBuffer = createBuffer(NULL);
+            }
+            return threadBuffer;
+        }
+
+        // tracks filled from outside the CPU timeline, looked up by name
+        ThreadBuffer* getTrackBuffer(const char* track)
+        {
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                for (size_t i = 0; i < buffers.size(); i++) {
+                    std::lock_guard<std::mutex> bufferLock(buffers[i]->mutex);
+                    if (buffers[i]->name == track) {
+                        return buffers[i];
+                    }
+                }
+            }
+            return createBuffer(track);
+        }
+
+        void push(ThreadBuffer* buffer, const char* name, long long start, long long end)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            ProfileEvent& event = buffer->events[buffer->count % Profiler::EVENTS_PER_THREAD];
+            event.name = name;
+            event.start = start;
+            event.end = end;
+            buffer->count++;
+        }
+
+        void writeEscaped(std::ofstream& file, const char* text)
+        {
+            for (const char* c = text; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') {
+                    file << '\\';
+                }
+                file << *c;
+            }
+        }
+    }
+
+    void Profiler::SetEnabled(bool enabled)
+    {
+        profilerEnabled = enabled;
+    }
+
+    bool Profiler::IsEnabled()
+    {
+        return profilerEnabled.load(std::memory_order_relaxed);
+    }
+
+    long long Profiler::Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - profilerEpoch).count();
+    }
+
+    void Profiler::Record(const char* name, long long start, long long end)
+    {
+        push(getThreadBuffer(), name, start, end);
+    }
+
+    void Profiler::RecordTrack(const char* track, const char* name, long long start, long long end)
+    {
+        if (!IsEnabled()) {
+            return;
+        }
+        push(getTrackBuffer(track), name, start, end);
+    }
+
+    void Profiler::SetThreadName(const char* name)
+    {
+        ThreadBuffer* buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->name = name;
+    }
+
+    bool Profiler::WriteTrace(const std::string& fileName)
+    {
+        std::ofstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not write trace " << fileName << std::endl;
+            return false;
+        }
+
+        std::vector<ThreadBuffer*> threads;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            threads = buffers;
+        }
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        size_t eventCount = 0;
+        // each ring is copied under its lock, its thread may still be recording
+        std::vector<ProfileEvent> events;
+        events.reserve(EVENTS_PER_THREAD);
+        for (size_t b = 0; b < threads.size(); b++) {
+            ThreadBuffer* buffer = threads[b];
+            const char* name;
+            events.clear();
+            {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                name = buffer->name;
+                // only the newest EVENTS_PER_THREAD events are still in the ring
+                unsigned long long begin = buffer->count > EVENTS_PER_THREAD ? buffer->count - EVENTS_PER_THREAD : 0;
+                for (unsigned long long i = begin; i < buffer->count; i++) {
+                    events.push_back(buffer->events[i % EVENTS_PER_THREAD]);
+                }
+            }
+
+            if (name != NULL) {
+                file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"args\":{\"name\":\"";
+                writeEscaped(file, name);
+                file << "\"}}";
+                first = false;
+            }
+
+            for (size_t i = 0; i < events.size(); i++) {
+                const ProfileEvent& event = events[i];
+                // complete events, timestamps in microseconds
+                file << (first ? "\n" : ",\n") << "{\"name\":\"";
+                writeEscaped(file, event.name);
+                file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"ts\":" << event.start / 1000 << "." << (event.start % 1000) / 100
+                    << ",\"dur\":" << (event.end - event.start) / 1000 << "." << ((event.end - event.start) % 1000) / 100 << "}";
+                first = false;
+                eventCount++;
+            }
+        }
+        file << "\n]}\n";
+
+        std::cout << "Trace: " << eventCount << " events written to " << fileName << std::endl;
+        return true;
+    }
+
+    ProfileScope::ProfileScope(const char* name)
+    {
+        this->name = name;
+        start = Profiler::IsEnabled() ? Profiler::Now() : -1;
+        previousAllocScope = AllocTracker::PushScope(name);
+    }
+
+    ProfileScope::~ProfileScope()
+    {
+        AllocTracker::PopScope(previousAllocScope);
+        if (start >= 0) {
+            Profiler::Record(name, start, Profiler::Now());
+        }
+    }
+}
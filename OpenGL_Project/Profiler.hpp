@@ -0,0 +1,61 @@
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <string>
+
+// Scoped CPU timings. Every thread records into its own preallocated ring of
+// events, so a marker costs two clock reads and a lock only WriteTrace ever
+// contends, with no allocation.
+// The ReleaseMinimal configuration (GPS_PROFILER_DISABLED, or the CMake option of
+// the same name) compiles every marker out; the others keep them for --trace.
+#ifndef GPS_PROFILER_DISABLED
+#define GPS_PROFILE_CONCAT_(a, b) a##b
+#define GPS_PROFILE_CONCAT(a, b) GPS_PROFILE_CONCAT_(a, b)
+// times the enclosing scope; name must be a string literal
+#define GPS_PROFILE_SCOPE(name) gps::ProfileScope GPS_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define GPS_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+namespace gps {
+
+    class Profiler
+    {
+    public:
+        // events kept per thread, older ones are overwritten
+        static const unsigned int EVENTS_PER_THREAD = 1 << 16;
+
+        // recording can be paused at runtime without recompiling
+        static void SetEnabled(bool enabled);
+        static bool IsEnabled();
+
+        // nanoseconds since the profiler started
+        static long long Now();
+
+        // adds a finished scope of the calling thread
+        static void Record(const char* name, long long start, long long end);
+        // adds a scope measured elsewhere (e.g. on the GPU) to a named track
+        static void RecordTrack(const char* track, const char* name, long long start, long long end);
+        // label of the calling thread in the trace
+        static void SetThreadName(const char* name);
+
+        // writes every buffered event as Chrome trace_event JSON
+        // (open with chrome://tracing or ui.perfetto.dev)
+        static bool WriteTrace(const std::string& fileName);
+    };
+
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+
+    private:
+        const char* name;
+        long long start;
+        // allocations inside the scope are attributed to it as well
+        const char* previousAllocScope;
+    };
+}
+
+#endif /* Profiler_hpp */
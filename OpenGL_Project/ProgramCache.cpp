@@ -0,0 +1,174 @@
+#include "ProgramCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace gps {
+
+    std::string ProgramCache::directory = "cache/shaders";
+    bool ProgramCache::enabled = true;
+
+    namespace {
+        const char CACHE_MAGIC[4] = { 'G', 'P', 'S', 'B' };
+        const unsigned int CACHE_FILE_VERSION = 1;
+
+        struct CacheHeader {
+            char magic[4];
+            unsigned int fileVersion;
+            unsigned int binaryFormat;
+            unsigned int binaryLength;
+        };
+
+        // 64-bit FNV-1a, chained over several strings
+        unsigned long long hashString(unsigned long long hash, const std::string& text)
+        {
+            for (size_t i = 0; i < text.size(); i++) {
+                hash ^= (unsigned char)text[i];
+                hash *= 1099511628211ULL;
+            }
+            // separator so ("ab","c") and ("a","bc") differ
+            hash ^= 0xff;
+            hash *= 1099511628211ULL;
+            return hash;
+        }
+
+        std::string glString(GLenum name)
+        {
+            const GLubyte* value = glGetString(name);
+            return value ? std::string((const char*)value) : std::string();
+        }
+    }
+
+    void ProgramCache::SetDirectory(const std::string& directory)
+    {
+        ProgramCache::directory = directory;
+    }
+
+    void ProgramCache::SetEnabled(bool enabled)
+    {
+        ProgramCache::enabled = enabled;
+    }
+
+    bool ProgramCache::IsAvailable()
+    {
+        if (!enabled) {
+            return false;
+        }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    std::string ProgramCache::MakeKey(const std::string& vertexSource, const std::string& fragmentSource,
+        const std::vector<std::string>& defines)
+    {
+        unsigned long long hash = 14695981039346656037ULL;
+        hash = hashString(hash, vertexSource);
+        hash = hashString(hash, fragmentSource);
+        for (size_t i = 0; i < defines.size(); i++) {
+            hash = hashString(hash, defines[i]);
+        }
+        hash = hashString(hash, glString(GL_RENDERER));
+        hash = hashString(hash, glString(GL_VERSION));
+
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", hash);
+        return std::string(key);
+    }
+
+    std::string ProgramCache::EntryPath(const std::string& key)
+    {
+        return directory + "/" + key + ".bin";
+    }
+
+    GLuint ProgramCache::Load(const std::string& key)
+    {
+        if (!IsAvailable()) {
+            return 0;
+        }
+
+        std::ifstream file(EntryPath(key).c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            return 0;
+        }
+
+        CacheHeader header;
+        file.read((char*)&header, sizeof(header));
+        if (!file || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.fileVersion != CACHE_FILE_VERSION) {
+            return 0;
+        }
+        // a truncated or corrupt entry must not size the allocation
+        std::streampos binaryStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - binaryStart;
+        file.seekg(binaryStart);
+        if (!file || header.binaryLength == 0 || (std::streamoff)header.binaryLength > remaining) {
+            std::cout << "Program cache: entry " << key << " is truncated, rebuilding" << std::endl;
+            file.close();
+            std::remove(EntryPath(key).c_str());
+            return 0;
+        }
+        std::vector<char> binary(header.binaryLength);
+        file.read(binary.data(), binary.size());
+        if (!file) {
+            return 0;
+        }
+        file.close();
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // the driver changed the format under us, drop the entry and rebuild from source
+            std::cout << "Program cache: binary " << key << " rejected by the driver" << std::endl;
+            glDeleteProgram(program);
+            std::remove(EntryPath(key).c_str());
+            return 0;
+        }
+        return program;
+    }
+
+    void ProgramCache::Store(const std::string& key, GLuint program)
+    {
+        if (!IsAvailable()) {
+            return;
+        }
+
+        //never cache a program that failed to link
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            return;
+        }
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, length, NULL, &binaryFormat, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        std::ofstream file(EntryPath(key).c_str(), std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Program cache: could not write " << EntryPath(key) << std::endl;
+            return;
+        }
+        CacheHeader header;
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.fileVersion = CACHE_FILE_VERSION;
+        header.binaryFormat = binaryFormat;
+        header.binaryLength = (unsigned int)length;
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), binary.size());
+    }
+}
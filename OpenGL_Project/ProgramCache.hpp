@@ -0,0 +1,40 @@
+#ifndef ProgramCache_hpp
+#define ProgramCache_hpp
+
+#include "GL/glew.h"
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+    // Entries are keyed by a hash of both stage sources, the define set and the
+    // GL_RENDERER/GL_VERSION strings, so a driver update simply misses the cache.
+    class ProgramCache
+    {
+    public:
+        // directory holding the cached binaries (created on first store)
+        static void SetDirectory(const std::string& directory);
+        static void SetEnabled(bool enabled);
+        // false when disabled or when the driver exposes no binary formats
+        static bool IsAvailable();
+
+        static std::string MakeKey(const std::string& vertexSource, const std::string& fragmentSource,
+            const std::vector<std::string>& defines);
+
+        // creates a linked program from the cached binary, 0 on a miss or when
+        // the driver rejects the binary (the stale entry is removed)
+        static GLuint Load(const std::string& key);
+        // saves the binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+        static void Store(const std::string& key, GLuint program);
+
+    private:
+        static std::string directory;
+        static bool enabled;
+
+        static std::string EntryPath(const std::string& key);
+    };
+}
+
+#endif /* ProgramCache_hpp */
@@ -0,0 +1,577 @@
+#include "ResidencyManager.hpp"
+#include "Profiler.hpp"
+#include "Stats.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace gps {
+
+    namespace {
+        // edge of the placeholder box, in world units, while the model's bounds are unknown
+        const float PLACEHOLDER_SIZE = 0.2f;
+
+        bool OverBudget(unsigned long long cpuBytes, unsigned long long gpuBytes, unsigned long long cpuBudget, unsigned long long gpuBudget)
+        {
+            return cpuBytes > cpuBudget || gpuBytes > gpuBudget;
+        }
+    }
+
+    ResidencyManager::ResidencyManager(Scene& scene)
+        : scene(scene)
+    {
+        entryCount = 0;
+        cpuBudget = 512ull * 1024 * 1024;
+        gpuBudget = 512ull * 1024 * 1024;
+        loadDistance = 8.0f;
+        placeholder = NULL;
+        uploader = NULL;
+        mipStreaming = true;
+        projectionScale = 0.0f;
+    }
+
+    void ResidencyManager::SetMipStreaming(bool enabled)
+    {
+        mipStreaming = enabled;
+    }
+
+    void ResidencyManager::SetProjectionScale(float pixelsPerUnit)
+    {
+        projectionScale = pixelsPerUnit;
+    }
+
+    void ResidencyManager::SetBudget(unsigned long long cpuBytes, unsigned long long gpuBytes, float loadDistance)
+    {
+        cpuBudget = cpuBytes;
+        gpuBudget = gpuBytes;
+        this->loadDistance = loadDistance;
+    }
+
+    void ResidencyManager::SetUploadThread(UploadThread* uploader)
+    {
+        this->uploader = uploader;
+    }
+
+    ModelHandle ResidencyManager::AddModel(const char* fileName)
+    {
+        if (entryCount == MAX_MODELS) {
+            fprintf(stderr, "ERROR: more than %d streamed models, %s is ignored\n", MAX_MODELS, fileName);
+            return PLACEHOLDER_MODEL;
+        }
+        Entry& entry = entries[entryCount++];
+        entry.owner = this;
+        entry.fileName = fileName;
+        entry.handle = scene.CreateModel();
+        entry.model = scene.GetModel(entry.handle);
+        entry.state = RESIDENCY_UNLOADED;
+        entry.loadedCpuBytes = 0;
+        entry.residentCpuBytes = 0;
+        entry.residentGpuBytes = 0;
+        entry.lastUsedFrame = 0;
+        entry.evictFrame = 0;
+        entry.used = false;
+        entry.wantedResolution = 0.0f;
+        entry.loadResolution = 0;
+        entry.maxTextureSize = 0;
+        entry.texelDensity = 0.0f;
+        entry.loadedBounds = glm::vec4(0.0f);
+        entry.meshCount = 0;
+        entry.mipState = MIP_IDLE;
+        entry.residentResolution = 0;
+        entry.mipTarget = 0;
+        entry.boundsKnown = false;
+        entry.bounds = glm::vec4(0.0f);
+        entry.knownCpuBytes = 0;
+        entry.knownGpuBytes = 0;
+        // sized here so that Update never allocates
+        modelDistances.resize(scene.GetModelCount());
+        entryIndex.resize(scene.GetModelCount(), -1);
+        entryIndex[entry.handle] = entryCount - 1;
+        return entry.handle;
+    }
+
+    ResidencyManager::Entry* ResidencyManager::FindEntry(ModelHandle model)
+    {
+        if (model < 0 || model >= (int)entryIndex.size() || entryIndex[model] < 0) {
+            return NULL;
+        }
+        return &entries[entryIndex[model]];
+    }
+
+    void ResidencyManager::StartPreload()
+    {
+        for (int i = 0; i < entryCount; i++) {
+            if (entries[i].state == RESIDENCY_UNLOADED) {
+                StartLoad(entries[i]);
+            }
+        }
+    }
+
+    bool ResidencyManager::IsLoading()
+    {
+        return !loads.IsDone();
+    }
+
+    bool ResidencyManager::FinishPreload()
+    {
+        GPS_PROFILE_SCOPE("ResidencyManager::FinishPreload");
+        JobSystem::Wait(&loads, JOB_PRIORITY_LOW);
+
+        bool loaded = true;
+        for (int i = 0; i < entryCount; i++) {
+            if (entries[i].state == RESIDENCY_FAILED) {
+                loaded = false;
+            }
+            else {
+                // the entities are created next, with the right bounds
+                PublishModel(entries[i]);
+            }
+        }
+        // the caller owns the context, so the render side's work is done right here
+        for (int i = 0; i < entryCount; i++) {
+            ProcessUploads(0);
+        }
+        return loaded;
+    }
+
+    void ResidencyManager::StartLoad(Entry& entry)
+    {
+        entry.loadResolution = mipStreaming ? MIP_TAIL_SIZE : 0;
+        entry.state.store(RESIDENCY_LOADING, std::memory_order_relaxed);
+        JobSystem::Run(LoadJob, &entry, &loads, NULL, JOB_PRIORITY_LOW);
+    }
+
+    void ResidencyManager::LoadJob(void* data)
+    {
+        GPS_PROFILE_SCOPE("ResidencyManager::LoadJob");
+        Entry* entry = (Entry*)data;
+        if (!entry->model->Parse(entry->fileName)) {
+            fprintf(stderr, "ERROR: could not load %s, drawing a placeholder\n", entry->fileName.c_str());
+            entry->state.store(RESIDENCY_FAILED, std::memory_order_release);
+            return;
+        }
+        JobSystem::ParallelFor(entry->model->GetPendingTextureCount(), 1, DecodeTextures, entry);
+        entry->loadedCpuBytes = entry->model->GetCpuBytes();
+        entry->maxTextureSize = entry->model->GetMaxTextureSize();
+        entry->texelDensity = entry->model->GetTexelDensity();
+        entry->loadedBounds = entry->model->GetBounds();
+        entry->meshCount = entry->model->GetMeshCount();
+        entry->residentResolution = entry->loadResolution > 0 ? std::min(entry->loadResolution, entry->maxTextureSize) : entry->maxTextureSize;
+        UploadThread* uploader = entry->owner->uploader;
+        if (uploader != NULL) {
+            // set first, the upload may well be done before Submit returns
+            entry->state.store(RESIDENCY_UPLOADING, std::memory_order_release);
+            if (uploader->Submit(UploadJob, UploadDone, entry)) {
+                return;
+            }
+        }
+        entry->state.store(RESIDENCY_LOADED, std::memory_order_release);
+    }
+
+    void ResidencyManager::UploadJob(UploadThread& uploader, void* data)
+    {
+        Entry* entry = (Entry*)data;
+        entry->model->Upload(uploader);
+    }
+
+    void ResidencyManager::UploadDone(void* data)
+    {
+        // the fence has signaled: the buffers and textures are complete for every context
+        Entry* entry = (Entry*)data;
+        entry->state.store(RESIDENCY_UPLOADED, std::memory_order_release);
+    }
+
+    void ResidencyManager::MipJob(void* data)
+    {
+        GPS_PROFILE_SCOPE("ResidencyManager::MipJob");
+        Entry* entry = (Entry*)data;
+        JobSystem::ParallelFor(entry->model->GetTextureCount(), 1, DecodeMips, entry);
+        UploadThread* uploader = entry->owner->uploader;
+        if (uploader != NULL) {
+            entry->mipState.store(MIP_UPLOADING, std::memory_order_release);
+            if (uploader->Submit(UploadMipsJob, MipsUploaded, entry)) {
+                return;
+            }
+        }
+        entry->mipState.store(MIP_LOADED, std::memory_order_release);
+    }
+
+    void ResidencyManager::DecodeMips(int begin, int end, void* data)
+    {
+        Entry* entry = (Entry*)data;
+        for (int i = begin; i < end; i++) {
+            entry->model->DecodeMips(i, entry->mipTarget);
+        }
+    }
+
+    void ResidencyManager::UploadMipsJob(UploadThread& uploader, void* data)
+    {
+        Entry* entry = (Entry*)data;
+        entry->model->UploadMips(&uploader);
+    }
+
+    void ResidencyManager::MipsUploaded(void* data)
+    {
+        Entry* entry = (Entry*)data;
+        entry->mipState.store(MIP_UPLOADED, std::memory_order_release);
+    }
+
+    void ResidencyManager::DecodeTextures(int begin, int end, void* data)
+    {
+        Entry* entry = (Entry*)data;
+        for (int i = begin; i < end; i++) {
+            entry->model->DecodeTexture(i, entry->loadResolution);
+        }
+    }
+
+    void ResidencyManager::Update(std::vector<DrawItem>& items, const glm::vec3& cameraPosition, unsigned int frameIndex)
+    {
+        GPS_PROFILE_SCOPE("ResidencyManager::Update");
+        // without workers (--jobs 0, or a single core) the loads run here,
+        // one per frame, instead of waiting for a Wait that never comes
+        if (JobSystem::GetThreadCount() == 1) {
+            JobSystem::RunPending(LOADS_PER_FRAME);
+        }
+        // requested: near the camera or in this frame's draw list
+        scene.GetModelDistances(cameraPosition, modelDistances);
+        for (int i = 0; i < entryCount; i++) {
+            entries[i].used = modelDistances[entries[i].handle] <= loadDistance;
+            entries[i].wantedResolution = 0.0f;
+        }
+        for (size_t i = 0; i < items.size(); i++) {
+            Entry* entry = FindEntry(items[i].model);
+            if (entry == NULL) {
+                continue;
+            }
+            entry->used = true;
+            // the texture sizes are known once the model is resident
+            if (entry->boundsKnown && entry->state.load(std::memory_order_acquire) == RESIDENCY_RESIDENT
+                && entry->texelDensity > 0.0f) {
+                // pixels per object unit at the item's nearest point, over texture coordinates per unit
+                const glm::mat4& world = items[i].world;
+                float scale = glm::length(glm::vec3(world[0]));
+                glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(entry->bounds), 1.0f));
+                float distance = std::max(glm::length(center - cameraPosition) - entry->bounds.w * scale, 0.1f);
+                float resolution = scale * projectionScale / (distance * entry->texelDensity);
+                entry->wantedResolution = std::max(entry->wantedResolution, resolution);
+            }
+        }
+
+        for (int i = 0; i < entryCount; i++) {
+            Entry& entry = entries[i];
+            int state = entry.state.load(std::memory_order_acquire);
+            if (entry.used) {
+                entry.lastUsedFrame = frameIndex;
+            }
+            bool parsed = state == RESIDENCY_LOADED || state == RESIDENCY_UPLOADING
+                || state == RESIDENCY_UPLOADED || state == RESIDENCY_RESIDENT;
+            if (parsed) {
+                PublishModel(entry);
+            }
+            if (state == RESIDENCY_RESIDENT) {
+                entry.knownCpuBytes = entry.residentCpuBytes;
+                entry.knownGpuBytes = entry.residentGpuBytes;
+            }
+        }
+
+        // make room first, then start as many requested loads as the budget allows
+        EnforceBudget(frameIndex);
+        unsigned long long cpuBytes;
+        unsigned long long gpuBytes;
+        GetTotals(cpuBytes, gpuBytes);
+        for (int i = 0; i < entryCount; i++) {
+            Entry& entry = entries[i];
+            if (!entry.used || entry.state.load(std::memory_order_acquire) != RESIDENCY_UNLOADED) {
+                continue;
+            }
+            if (OverBudget(cpuBytes + entry.knownCpuBytes, gpuBytes + entry.knownGpuBytes, cpuBudget, gpuBudget)) {
+                continue;
+            }
+            cpuBytes += entry.knownCpuBytes;
+            gpuBytes += entry.knownGpuBytes;
+            StartLoad(entry);
+        }
+        if (mipStreaming) {
+            UpdateMips(OverBudget(cpuBytes, gpuBytes, cpuBudget, gpuBudget));
+        }
+
+        // whatever is not uploaded yet is drawn as a box around its bounds
+        for (size_t i = 0; i < items.size(); i++) {
+            DrawItem& item = items[i];
+            const Entry* entry = FindEntry(item.model);
+            if (entry == NULL || entry->state.load(std::memory_order_acquire) == RESIDENCY_RESIDENT) {
+                continue;
+            }
+            item.model = PLACEHOLDER_MODEL;
+            if (entry->boundsKnown && entry->bounds.w > 0.0f) {
+                glm::vec3 center = glm::vec3(entry->bounds);
+                item.world = glm::scale(glm::translate(item.world, center), glm::vec3(entry->bounds.w));
+            }
+            else {
+                glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3(item.world[3]));
+                item.world = glm::scale(world, glm::vec3(PLACEHOLDER_SIZE * 0.5f));
+                item.normalMatrix = glm::mat3x4(1.0f);
+            }
+        }
+    }
+
+    void ResidencyManager::PublishModel(Entry& entry)
+    {
+        // the loading job wrote these before the state that was acquired; a
+        // reload writes them again, but only while boundsKnown keeps them unread
+        if (entry.boundsKnown) {
+            return;
+        }
+        entry.bounds = entry.loadedBounds;
+        entry.boundsKnown = true;
+        scene.SetModelInfo(entry.handle, entry.bounds, entry.meshCount);
+    }
+
+    int ResidencyManager::GetWantedResolution(const Entry& entry)
+    {
+        int resolution = MIP_TAIL_SIZE;
+        while (resolution < entry.wantedResolution && resolution < entry.maxTextureSize) {
+            resolution *= 2;
+        }
+        return std::min(resolution, entry.maxTextureSize);
+    }
+
+    void ResidencyManager::UpdateMips(bool overBudget)
+    {
+        Entry* best = NULL;
+        int bestWanted = 0;
+        float bestRatio = 1.0f;
+        for (int i = 0; i < entryCount; i++) {
+            Entry& entry = entries[i];
+            if (entry.state.load(std::memory_order_acquire) != RESIDENCY_RESIDENT
+                || entry.mipState.load(std::memory_order_acquire) != MIP_IDLE || entry.maxTextureSize == 0) {
+                continue;
+            }
+            int resident = entry.residentResolution;
+            int wanted = GetWantedResolution(entry);
+            if (wanted > resident) {
+                // the model missing the most levels goes first
+                float ratio = (float)wanted / resident;
+                if (ratio > bestRatio) {
+                    best = &entry;
+                    bestWanted = wanted;
+                    bestRatio = ratio;
+                }
+                continue;
+            }
+            // unseen models keep only the tail, seen ones one level of slack
+            int trimTo = entry.used ? wanted * 2 : std::min((int)MIP_TAIL_SIZE, entry.maxTextureSize);
+            if (resident > trimTo && (!entry.used || wanted * 4 <= resident)) {
+                entry.mipTarget = trimTo;
+                entry.mipState.store(MIP_TRIMMING, std::memory_order_release);
+            }
+        }
+        // more levels would only be evicted again
+        if (best != NULL && !overBudget) {
+            best->mipTarget = bestWanted;
+            best->mipState.store(MIP_LOADING, std::memory_order_relaxed);
+            JobSystem::Run(MipJob, best, &loads, NULL, JOB_PRIORITY_LOW);
+        }
+    }
+
+    void ResidencyManager::GetTotals(unsigned long long& cpuBytes, unsigned long long& gpuBytes)
+    {
+        cpuBytes = 0;
+        gpuBytes = 0;
+        for (int i = 0; i < entryCount; i++) {
+            const Entry& entry = entries[i];
+            switch (entry.state.load(std::memory_order_acquire)) {
+            case RESIDENCY_LOADING:
+                // reserved up front from the last load, unknown the first time
+                cpuBytes += entry.knownCpuBytes;
+                gpuBytes += entry.knownGpuBytes;
+                break;
+            case RESIDENCY_LOADED:
+            case RESIDENCY_UPLOADING:
+            case RESIDENCY_UPLOADED:
+                cpuBytes += entry.loadedCpuBytes;
+                gpuBytes += entry.knownGpuBytes;
+                break;
+            case RESIDENCY_RESIDENT:
+            case RESIDENCY_EVICTING:
+                cpuBytes += entry.residentCpuBytes;
+                gpuBytes += entry.residentGpuBytes;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void ResidencyManager::EnforceBudget(unsigned int frameIndex)
+    {
+        unsigned long long cpuBytes;
+        unsigned long long gpuBytes;
+        GetTotals(cpuBytes, gpuBytes);
+        while (OverBudget(cpuBytes, gpuBytes, cpuBudget, gpuBudget)) {
+            // least recently used resident model that is not needed this frame
+            Entry* victim = NULL;
+            for (int i = 0; i < entryCount; i++) {
+                Entry& entry = entries[i];
+                if (entry.used || entry.state.load(std::memory_order_acquire) != RESIDENCY_RESIDENT
+                    || entry.mipState.load(std::memory_order_acquire) != MIP_IDLE) {
+                    continue;
+                }
+                if (victim == NULL || entry.lastUsedFrame < victim->lastUsedFrame) {
+                    victim = &entry;
+                }
+            }
+            if (victim == NULL) {
+                return;
+            }
+            Evict(*victim, frameIndex);
+            cpuBytes -= victim->residentCpuBytes;
+            gpuBytes -= victim->residentGpuBytes;
+        }
+    }
+
+    void ResidencyManager::Evict(Entry& entry, unsigned int frameIndex)
+    {
+        // packets up to frameIndex - 1 may still draw it
+        entry.evictFrame = frameIndex;
+        entry.state.store(RESIDENCY_EVICTING, std::memory_order_release);
+    }
+
+    ResidencyStats ResidencyManager::GetStats()
+    {
+        ResidencyStats stats;
+        stats.residentModels = 0;
+        stats.loadingModels = 0;
+        stats.mipModels = 0;
+        for (int i = 0; i < entryCount; i++) {
+            int state = entries[i].state.load(std::memory_order_acquire);
+            if (state == RESIDENCY_RESIDENT) {
+                stats.residentModels++;
+            }
+            else if (state != RESIDENCY_UNLOADED && state != RESIDENCY_EVICTING && state != RESIDENCY_FAILED) {
+                stats.loadingModels++;
+            }
+            if (entries[i].mipState.load(std::memory_order_acquire) != MIP_IDLE) {
+                stats.mipModels++;
+            }
+        }
+        GetTotals(stats.cpuBytes, stats.gpuBytes);
+        return stats;
+    }
+
+    void ResidencyManager::ProcessUploads(unsigned int frameIndex)
+    {
+        GPS_PROFILE_SCOPE("ResidencyManager::ProcessUploads");
+        if (placeholder == NULL) {
+            CreatePlaceholder();
+        }
+        int uploads = 0;
+        for (int i = 0; i < entryCount; i++) {
+            Entry& entry = entries[i];
+            int state = entry.state.load(std::memory_order_acquire);
+            if (state == RESIDENCY_LOADED && uploads < UPLOADS_PER_FRAME) {
+                entry.model->Upload();
+                entry.residentCpuBytes = entry.model->GetCpuBytes();
+                entry.residentGpuBytes = entry.model->GetGpuBytes();
+                entry.state.store(RESIDENCY_RESIDENT, std::memory_order_release);
+                uploads++;
+            }
+            else if (state == RESIDENCY_UPLOADED) {
+                // the upload thread did the copies, only the vertex arrays are left
+                entry.model->CreateVertexArrays();
+                entry.residentCpuBytes = entry.model->GetCpuBytes();
+                entry.residentGpuBytes = entry.model->GetGpuBytes();
+                entry.state.store(RESIDENCY_RESIDENT, std::memory_order_release);
+            }
+            else if (state == RESIDENCY_RESIDENT) {
+                int mipState = entry.mipState.load(std::memory_order_acquire);
+                if (mipState == MIP_LOADED && uploads < UPLOADS_PER_FRAME) {
+                    entry.model->UploadMips(NULL);
+                    FinishMips(entry);
+                    uploads++;
+                }
+                else if (mipState == MIP_UPLOADED) {
+                    FinishMips(entry);
+                }
+                else if (mipState == MIP_TRIMMING) {
+                    entry.model->TrimMips(entry.mipTarget);
+                    FinishMips(entry);
+                }
+            }
+            else if (state == RESIDENCY_EVICTING && frameIndex >= entry.evictFrame) {
+                // every packet that could reference it has been drawn
+                entry.model->Unload();
+                entry.state.store(RESIDENCY_UNLOADED, std::memory_order_release);
+            }
+        }
+    }
+
+    void ResidencyManager::FinishMips(Entry& entry)
+    {
+        // the levels are complete: let the samplers reach them
+        entry.model->ApplyMipLevels();
+        entry.residentResolution = entry.mipTarget;
+        entry.residentCpuBytes = entry.model->GetCpuBytes();
+        entry.residentGpuBytes = entry.model->GetGpuBytes();
+        entry.mipState.store(MIP_IDLE, std::memory_order_release);
+    }
+
+    void ResidencyManager::CreatePlaceholder()
+    {
+        // unit cube around the origin, flat normals per face
+        static const float faces[6][3] = {
+            { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+            { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+        };
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        for (int f = 0; f < 6; f++) {
+            glm::vec3 normal(faces[f][0], faces[f][1], faces[f][2]);
+            glm::vec3 u = glm::vec3(normal.y != 0.0f ? 1.0f : 0.0f, normal.y != 0.0f ? 0.0f : 1.0f, 0.0f);
+            glm::vec3 v = glm::cross(normal, u);
+            GLuint first = (GLuint)vertices.size();
+            for (int corner = 0; corner < 4; corner++) {
+                float a = (corner == 1 || corner == 2) ? 1.0f : -1.0f;
+                float b = corner >= 2 ? 1.0f : -1.0f;
+                Vertex vertex;
+                vertex.Position = normal + u * a + v * b;
+                vertex.Normal = normal;
+                vertex.TexCoords = glm::vec2(a * 0.5f + 0.5f, b * 0.5f + 0.5f);
+                vertices.push_back(vertex);
+            }
+            GLuint quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int q = 0; q < 6; q++) {
+                indices.push_back(first + quad[q]);
+            }
+        }
+        placeholder = new Mesh(vertices, indices, std::vector<Texture>());
+    }
+
+    void ResidencyManager::DrawPlaceholder(const Shader& shader)
+    {
+        if (placeholder != NULL) {
+            placeholder->Draw(shader);
+        }
+    }
+
+    void ResidencyManager::Shutdown()
+    {
+        JobSystem::Wait(&loads, JOB_PRIORITY_LOW);
+    }
+
+    void ResidencyManager::Delete()
+    {
+        if (placeholder == NULL) {
+            return;
+        }
+        Buffers buffers = placeholder->getBuffers();
+        glDeleteBuffers(1, &buffers.VBO);
+        glDeleteBuffers(1, &buffers.EBO);
+        glDeleteVertexArrays(1, &buffers.VAO);
+        Stats::AddMemory(MEMORY_BUFFERS, -(long long)(placeholder->vertices.size() * sizeof(Vertex) + placeholder->indices.size() * sizeof(GLuint)));
+        delete placeholder;
+        placeholder = NULL;
+    }
+}
@@ -0,0 +1,221 @@
+#ifndef ResidencyManager_hpp
+#define ResidencyManager_hpp
+
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+#include "Shader.hpp"
+#include "UploadThread.hpp"
+
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // draw items of models that are not resident use this instead of a ModelHandle
+    const ModelHandle PLACEHOLDER_MODEL = -1;
+
+    enum RESIDENCY_STATE {
+        // nothing in memory
+        RESIDENCY_UNLOADED,
+        // parsing and decoding on the job system
+        RESIDENCY_LOADING,
+        // decoded on the CPU, waiting for the render thread to upload it
+        RESIDENCY_LOADED,
+        // queued on or being copied by the upload thread
+        RESIDENCY_UPLOADING,
+        // on the GPU and fenced, waiting for the render thread's vertex arrays
+        RESIDENCY_UPLOADED,
+        RESIDENCY_RESIDENT,
+        // no longer drawn, the render thread frees it once older packets are done
+        RESIDENCY_EVICTING,
+        // the file could not be read, the placeholder stays
+        RESIDENCY_FAILED
+    };
+
+    // mip streaming of a resident model's textures
+    enum MIP_STATE {
+        MIP_IDLE,
+        // reading the higher levels on the job system
+        MIP_LOADING,
+        // read, waiting for the render thread to upload them
+        MIP_LOADED,
+        // queued on or being copied by the upload thread
+        MIP_UPLOADING,
+        // uploaded, waiting for the render thread to lower the base level
+        MIP_UPLOADED,
+        // the render thread drops the levels above the target
+        MIP_TRIMMING
+    };
+
+    // snapshot for the overlay
+    struct ResidencyStats {
+        int residentModels;
+        int loadingModels;
+        // models whose texture levels are being streamed in or trimmed
+        int mipModels;
+        unsigned long long cpuBytes;
+        unsigned long long gpuBytes;
+    };
+
+    // Decides which models are in memory. Models are requested when one of
+    // their entities is in the draw list or within the load distance of the
+    // camera and load on the job system. With an upload thread the loading
+    // job hands them over to it and the render thread only creates their
+    // vertex arrays; otherwise the render thread uploads them a few per
+    // frame. Until then their entities are drawn as a placeholder box.
+    // When the CPU or GPU total goes over its budget, the models that have
+    // gone unseen the longest are evicted first.
+    //
+    // Textures load with only their levels up to MIP_TAIL_SIZE, so a model is
+    // drawn as soon as possible; an archive made with --pack holds those
+    // levels prebuilt, so the first load decodes no image at all. Each frame the resolution its textures need
+    // is estimated from the texel density of the model and the size of its
+    // nearest draw item on screen; the model missing the most levels reads
+    // the higher ones again, and models that need far less than they hold
+    // (or are not seen) drop them. The samplers are clamped to the levels
+    // present with GL_TEXTURE_BASE_LEVEL / GL_TEXTURE_MIN_LOD.
+    //
+    // Update, the preload and the stats run on the simulation thread;
+    // ProcessUploads, DrawPlaceholder and Delete on the thread owning the GL
+    // context; the upload thread only runs what the loading jobs hand it.
+    // Each model's state is the only value the threads share.
+    class ResidencyManager
+    {
+    public:
+        // every model is registered before the render thread starts
+        static const int MAX_MODELS = 256;
+        // models uploaded per rendered frame, spreads the upload hitches
+        static const int UPLOADS_PER_FRAME = 1;
+        // jobs the simulation thread runs per frame when there are no workers
+        static const int LOADS_PER_FRAME = 1;
+        // largest texture edge loaded with a model while mips are streamed
+        static const int MIP_TAIL_SIZE = 64;
+
+        ResidencyManager(Scene& scene);
+
+        void SetBudget(unsigned long long cpuBytes, unsigned long long gpuBytes, float loadDistance);
+        // uploads go to this thread from now on; set after FinishPreload, before
+        // the first Update, and stopped after Shutdown
+        void SetUploadThread(UploadThread* uploader);
+        // off: textures load with every level (set before StartPreload)
+        void SetMipStreaming(bool enabled);
+        // pixels covered by one world unit at distance one: the framebuffer
+        // height over 2 tan(fov / 2)
+        void SetProjectionScale(float pixelsPerUnit);
+        // registers a model file and creates its (empty) scene model
+        ModelHandle AddModel(const char* fileName);
+
+        // queues a load for every model; the caller can keep working, then
+        // calls FinishPreload
+        void StartPreload();
+        // true while a queued load is still running
+        bool IsLoading();
+        // waits for the loads and uploads every model on the calling thread,
+        // which must own the GL context; false when a file could not be read
+        bool FinishPreload();
+
+        // requests the models in items and near the camera, starts loads,
+        // evicts over budget, and swaps the items of models that are not
+        // resident for placeholders
+        void Update(std::vector<DrawItem>& items, const glm::vec3& cameraPosition, unsigned int frameIndex);
+        ResidencyStats GetStats();
+
+        // uploads finished loads and frees models evicted before frameIndex
+        void ProcessUploads(unsigned int frameIndex);
+        void DrawPlaceholder(const Shader& shader);
+
+        // waits for the loads still running
+        void Shutdown();
+        // deletes the placeholder mesh, needs the GL context
+        void Delete();
+
+    private:
+        struct Entry {
+            ResidencyManager* owner;
+            std::string fileName;
+            ModelHandle handle;
+            Model3D* model;
+            std::atomic<int> state;
+            // written by the loading job before it publishes RESIDENCY_LOADED
+            unsigned long long loadedCpuBytes;
+            // written by the render thread when the model becomes resident and
+            // when its mips change, read by the simulation thread at any time
+            std::atomic<unsigned long long> residentCpuBytes;
+            std::atomic<unsigned long long> residentGpuBytes;
+
+            // largest texture edge to load, 0 for every level; set before StartLoad
+            int loadResolution;
+            // written by the loading job before it publishes RESIDENCY_LOADED
+            int maxTextureSize;
+            float texelDensity;
+            glm::vec4 loadedBounds;
+            int meshCount;
+            // largest texture edge resident, and the one being streamed or
+            // trimmed to; the thread finishing a mip operation publishes it
+            // with MIP_IDLE
+            std::atomic<int> mipState;
+            int residentResolution;
+            int mipTarget;
+
+            // simulation thread only
+            unsigned int lastUsedFrame;
+            unsigned int evictFrame;
+            bool used;
+            // texels across the texture coordinate range the nearest item needs
+            float wantedResolution;
+            bool boundsKnown;
+            glm::vec4 bounds;
+            // sizes of the last load, the estimate for the next one
+            unsigned long long knownCpuBytes;
+            unsigned long long knownGpuBytes;
+        };
+
+        Scene& scene;
+        Entry entries[MAX_MODELS];
+        int entryCount;
+        unsigned long long cpuBudget;
+        unsigned long long gpuBudget;
+        float loadDistance;
+        bool mipStreaming;
+        float projectionScale;
+        JobCounter loads;
+        UploadThread* uploader;
+        std::vector<float> modelDistances;
+        // scene model handle -> index into entries, -1 for models not streamed
+        std::vector<int> entryIndex;
+
+        Mesh* placeholder;
+
+        // the entry streaming a scene model, NULL for placeholders and unknown handles
+        Entry* FindEntry(ModelHandle model);
+        void StartLoad(Entry& entry);
+        // hands the bounds and mesh count of a parsed model to the scene, once
+        void PublishModel(Entry& entry);
+        void Evict(Entry& entry, unsigned int frameIndex);
+        // evicts unused models, oldest first, until both totals fit or nothing is left
+        void EnforceBudget(unsigned int frameIndex);
+        void GetTotals(unsigned long long& cpuBytes, unsigned long long& gpuBytes);
+        void CreatePlaceholder();
+        // starts at most one mip load and any trims, simulation thread
+        void UpdateMips(bool overBudget);
+        // power of two the entry's textures should hold, within the tail and the full size
+        int GetWantedResolution(const Entry& entry);
+        // the render thread's end of a mip operation
+        void FinishMips(Entry& entry);
+
+        static void LoadJob(void* data);
+        static void DecodeTextures(int begin, int end, void* data);
+        static void UploadJob(UploadThread& uploader, void* data);
+        static void UploadDone(void* data);
+        static void MipJob(void* data);
+        static void DecodeMips(int begin, int end, void* data);
+        static void UploadMipsJob(UploadThread& uploader, void* data);
+        static void MipsUploaded(void* data);
+    };
+}
+
+#endif /* ResidencyManager_hpp */
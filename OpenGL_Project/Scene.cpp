@@ -0,0 +1,408 @@
+#include "Scene.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include "SimdMath.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    namespace {
+        // entities per job; below this the systems run on the calling thread
+        const int ENTITIES_PER_BATCH = 256;
+        // moves longer than this in one tick are jumps and are not blended
+        const float TELEPORT_DISTANCE = 1.0f;
+        // transforms blended on the stack before one batched compose
+        const int COMPOSE_BATCH = 64;
+        // previous position of a new entity, far enough away that its first transform is not blended
+        const glm::vec3 NO_PREVIOUS_POSITION(1e30f);
+
+        bool drawOrder(const DrawItem& a, const DrawItem& b)
+        {
+            if (a.pass != b.pass) {
+                return a.pass < b.pass;
+            }
+            return a.model < b.model;
+        }
+    }
+
+    Scene::Scene()
+    {
+        tick = 1;
+        blendAlpha = 1.0f;
+        for (int i = 0; i < 6; i++) {
+            frustumPlanes[i] = glm::vec4(0.0f);
+        }
+    }
+
+    Scene::~Scene()
+    {
+        Delete();
+    }
+
+    ModelHandle Scene::CreateModel()
+    {
+        modelTable.push_back(new Model3D());
+        modelBounds.push_back(glm::vec4(0.0f));
+        modelMeshCounts.push_back(0);
+        return (ModelHandle)modelTable.size() - 1;
+    }
+
+    Model3D* Scene::GetModel(ModelHandle model)
+    {
+        return modelTable[model];
+    }
+
+    int Scene::GetModelCount()
+    {
+        return (int)modelTable.size();
+    }
+
+    void Scene::SetModelInfo(ModelHandle model, const glm::vec4& bounds, int meshCount)
+    {
+        modelBounds[model] = bounds;
+        modelMeshCounts[model] = meshCount;
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (models[i] == model) {
+                localBounds[i] = bounds;
+            }
+        }
+    }
+
+    void Scene::GetModelDistances(const glm::vec3& point, std::vector<float>& distances)
+    {
+        for (size_t m = 0; m < distances.size(); m++) {
+            distances[m] = 1e30f;
+        }
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (!visible[i] || (size_t)models[i] >= distances.size()) {
+                continue;
+            }
+            const glm::mat4& world = worldMatrices[i];
+            glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(localBounds[i]), 1.0f));
+            float distance = glm::distance(point, center) - localBounds[i].w * scales[i];
+            if (distance < 0.0f) {
+                distance = 0.0f;
+            }
+            if (distance < distances[models[i]]) {
+                distances[models[i]] = distance;
+            }
+        }
+    }
+
+    Entity Scene::CreateEntity(ModelHandle model, int pass)
+    {
+        Entity entity;
+        if (!freeIds.empty()) {
+            entity = freeIds.back();
+            freeIds.pop_back();
+        }
+        else {
+            entity = (Entity)slots.size();
+            slots.push_back(INVALID_ENTITY);
+        }
+        slots[entity] = (unsigned int)entities.size();
+        entities.push_back(entity);
+
+        models.push_back(model);
+        passes.push_back(pass);
+        visible.push_back(1);
+        positions.push_back(glm::vec3(0.0f));
+        rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        scales.push_back(1.0f);
+        previousPositions.push_back(NO_PREVIOUS_POSITION);
+        previousRotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        worldMatrices.push_back(glm::mat4(1.0f));
+        normalMatrices.push_back(glm::mat3x4(1.0f));
+        changedTicks.push_back(tick);
+        localBounds.push_back(modelBounds[model]);
+        inFrustum.push_back(0);
+        return entity;
+    }
+
+    void Scene::DestroyEntity(Entity entity)
+    {
+        unsigned int slot = Slot(entity);
+        if (slot == INVALID_ENTITY) {
+            return;
+        }
+        // the last slot fills the hole
+        unsigned int last = (unsigned int)entities.size() - 1;
+        Entity moved = entities[last];
+        entities[slot] = moved;
+        models[slot] = models[last];
+        passes[slot] = passes[last];
+        visible[slot] = visible[last];
+        positions[slot] = positions[last];
+        rotations[slot] = rotations[last];
+        scales[slot] = scales[last];
+        previousPositions[slot] = previousPositions[last];
+        previousRotations[slot] = previousRotations[last];
+        worldMatrices[slot] = worldMatrices[last];
+        normalMatrices[slot] = normalMatrices[last];
+        changedTicks[slot] = changedTicks[last];
+        localBounds[slot] = localBounds[last];
+        inFrustum[slot] = inFrustum[last];
+        slots[moved] = slot;
+
+        entities.pop_back();
+        models.pop_back();
+        passes.pop_back();
+        visible.pop_back();
+        positions.pop_back();
+        rotations.pop_back();
+        scales.pop_back();
+        previousPositions.pop_back();
+        previousRotations.pop_back();
+        worldMatrices.pop_back();
+        normalMatrices.pop_back();
+        changedTicks.pop_back();
+        localBounds.pop_back();
+        inFrustum.pop_back();
+        slots[entity] = INVALID_ENTITY;
+        freeIds.push_back(entity);
+
+        for (size_t i = 0; i < orbitEntities.size(); i++) {
+            if (orbitEntities[i] == entity) {
+                orbitEntities[i] = orbitEntities.back();
+                orbitCenters[i] = orbitCenters.back();
+                orbitOffsets[i] = orbitOffsets.back();
+                orbitAngles[i] = orbitAngles.back();
+                orbitSpeeds[i] = orbitSpeeds.back();
+                orbitEntities.pop_back();
+                orbitCenters.pop_back();
+                orbitOffsets.pop_back();
+                orbitAngles.pop_back();
+                orbitSpeeds.pop_back();
+                break;
+            }
+        }
+    }
+
+    bool Scene::IsAlive(Entity entity)
+    {
+        return Slot(entity) != INVALID_ENTITY;
+    }
+
+    int Scene::GetEntityCount()
+    {
+        return (int)entities.size();
+    }
+
+    unsigned int Scene::Slot(Entity entity)
+    {
+        if (entity >= slots.size()) {
+            return INVALID_ENTITY;
+        }
+        return slots[entity];
+    }
+
+    void Scene::MarkChanged(unsigned int slot)
+    {
+        changedTicks[slot] = tick;
+    }
+
+    void Scene::SetPosition(Entity entity, const glm::vec3& position)
+    {
+        unsigned int slot = Slot(entity);
+        if (positions[slot] != position) {
+            positions[slot] = position;
+            MarkChanged(slot);
+        }
+    }
+
+    glm::vec3 Scene::GetPosition(Entity entity)
+    {
+        return positions[Slot(entity)];
+    }
+
+    void Scene::SetRotation(Entity entity, const glm::quat& rotation)
+    {
+        unsigned int slot = Slot(entity);
+        rotations[slot] = rotation;
+        MarkChanged(slot);
+    }
+
+    void Scene::SetScale(Entity entity, float scale)
+    {
+        unsigned int slot = Slot(entity);
+        scales[slot] = scale;
+        MarkChanged(slot);
+    }
+
+    void Scene::SetVisible(Entity entity, bool visible)
+    {
+        this->visible[Slot(entity)] = visible ? 1 : 0;
+    }
+
+    bool Scene::IsVisible(Entity entity)
+    {
+        return visible[Slot(entity)] != 0;
+    }
+
+    void Scene::AddOrbit(Entity entity, const glm::vec3& offset, float angle, float speed)
+    {
+        orbitEntities.push_back(entity);
+        orbitCenters.push_back(glm::vec3(0.0f));
+        orbitOffsets.push_back(offset);
+        orbitAngles.push_back(angle);
+        orbitSpeeds.push_back(speed);
+    }
+
+    void Scene::BeginTick()
+    {
+        // only transforms that changed last tick differ from their previous copy
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (changedTicks[i] == tick) {
+                previousPositions[i] = positions[i];
+                previousRotations[i] = rotations[i];
+            }
+        }
+        tick++;
+    }
+
+    void Scene::UpdateOrbits(float deltaTime)
+    {
+        GPS_PROFILE_SCOPE("Scene::UpdateOrbits");
+        for (size_t i = 0; i < orbitEntities.size(); i++) {
+            orbitAngles[i] += orbitSpeeds[i] * deltaTime;
+            // rotate(angle) * translate(offset) == translate(R * offset) * rotate(angle)
+            glm::quat rotation = glm::angleAxis(glm::radians(orbitAngles[i]), glm::vec3(0.0f, 1.0f, 0.0f));
+            unsigned int slot = Slot(orbitEntities[i]);
+            positions[slot] = orbitCenters[i] + rotation * orbitOffsets[i];
+            rotations[slot] = rotation;
+            MarkChanged(slot);
+        }
+    }
+
+    void Scene::ShiftOrigin(const glm::vec3& offset)
+    {
+        GPS_PROFILE_SCOPE("Scene::ShiftOrigin");
+        for (size_t i = 0; i < entities.size(); i++) {
+            positions[i] += offset;
+            previousPositions[i] += offset;
+            MarkChanged((unsigned int)i);
+        }
+        for (size_t i = 0; i < orbitCenters.size(); i++) {
+            orbitCenters[i] += offset;
+        }
+    }
+
+    void Scene::UpdateWorldMatrixRange(int begin, int end, void* data)
+    {
+        Scene* scene = (Scene*)data;
+        float alpha = scene->blendAlpha;
+        glm::vec3 positions[COMPOSE_BATCH];
+        glm::quat rotations[COMPOSE_BATCH];
+        float scales[COMPOSE_BATCH];
+        glm::mat4 worlds[COMPOSE_BATCH];
+        glm::mat3x4 normals[COMPOSE_BATCH];
+        for (int first = begin; first < end; first += COMPOSE_BATCH) {
+            int count = std::min(COMPOSE_BATCH, end - first);
+            for (int b = 0; b < count; b++) {
+                unsigned int i = scene->dirtySlots[first + b];
+                positions[b] = scene->positions[i];
+                rotations[b] = scene->rotations[i];
+                scales[b] = scene->scales[i];
+                if (glm::distance(scene->previousPositions[i], positions[b]) <= TELEPORT_DISTANCE) {
+                    positions[b] = glm::mix(scene->previousPositions[i], positions[b], alpha);
+                    rotations[b] = glm::slerp(scene->previousRotations[i], rotations[b], alpha);
+                }
+            }
+            SimdMath::ComposeTransforms(positions, rotations, scales, count, worlds, normals);
+            for (int b = 0; b < count; b++) {
+                unsigned int i = scene->dirtySlots[first + b];
+                scene->worldMatrices[i] = worlds[b];
+                scene->normalMatrices[i] = normals[b];
+            }
+        }
+    }
+
+    int Scene::UpdateWorldMatrices(float alpha)
+    {
+        GPS_PROFILE_SCOPE("Scene::UpdateWorldMatrices");
+        // an entity that changed last tick still has to land on its current transform
+        dirtySlots.clear();
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (changedTicks[i] + 1 >= tick) {
+                dirtySlots.push_back((unsigned int)i);
+            }
+        }
+        blendAlpha = alpha;
+        JobSystem::ParallelFor((int)dirtySlots.size(), ENTITIES_PER_BATCH, UpdateWorldMatrixRange, this);
+        return (int)dirtySlots.size();
+    }
+
+    void Scene::CullRange(int begin, int end, void* data)
+    {
+        Scene* scene = (Scene*)data;
+        for (int i = begin; i < end; i++) {
+            if (!scene->visible[i]) {
+                scene->inFrustum[i] = 0;
+                continue;
+            }
+            const glm::mat4& world = scene->worldMatrices[i];
+            glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(scene->localBounds[i]), 1.0f));
+            float radius = scene->localBounds[i].w * scene->scales[i];
+            unsigned char inside = 1;
+            for (int p = 0; p < 6 && inside; p++) {
+                const glm::vec4& plane = scene->frustumPlanes[p];
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    inside = 0;
+                }
+            }
+            scene->inFrustum[i] = inside;
+        }
+    }
+
+    void Scene::BuildDrawList(const glm::mat4& viewProjection, std::vector<DrawItem>& items, unsigned int* culledMeshes)
+    {
+        GPS_PROFILE_SCOPE("Scene::BuildDrawList");
+        // planes straight from the rows of the clip matrix (Gribb/Hartmann)
+        glm::mat4 m = glm::transpose(viewProjection);
+        frustumPlanes[0] = m[3] + m[0];
+        frustumPlanes[1] = m[3] - m[0];
+        frustumPlanes[2] = m[3] + m[1];
+        frustumPlanes[3] = m[3] - m[1];
+        frustumPlanes[4] = m[3] + m[2];
+        frustumPlanes[5] = m[3] - m[2];
+        for (int p = 0; p < 6; p++) {
+            frustumPlanes[p] /= glm::length(glm::vec3(frustumPlanes[p]));
+        }
+        JobSystem::ParallelFor((int)entities.size(), ENTITIES_PER_BATCH, CullRange, this);
+
+        // compacting is cheap next to the tests, it stays serial to keep the order stable
+        items.clear();
+        unsigned int culled = 0;
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (inFrustum[i]) {
+                DrawItem item;
+                item.model = models[i];
+                item.pass = passes[i];
+                item.world = worldMatrices[i];
+                item.normalMatrix = normalMatrices[i];
+                items.push_back(item);
+            }
+            else if (visible[i]) {
+                culled += modelMeshCounts[models[i]];
+            }
+        }
+        // grouped by model, consecutive draws share their textures and buffers
+        std::sort(items.begin(), items.end(), drawOrder);
+        if (culledMeshes != NULL) {
+            *culledMeshes = culled;
+        }
+    }
+
+    void Scene::Delete()
+    {
+        for (size_t i = 0; i < modelTable.size(); i++) {
+            delete modelTable[i];
+        }
+        modelTable.clear();
+        modelBounds.clear();
+        modelMeshCounts.clear();
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef Scene_hpp
+#define Scene_hpp
+
+#include "Model3D.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <vector>
+
+namespace gps {
+
+    // stable id of an entity, stays valid until DestroyEntity
+    typedef unsigned int Entity;
+    const Entity INVALID_ENTITY = 0xFFFFFFFF;
+    // index of a model owned by the scene
+    typedef int ModelHandle;
+
+    // one visible entity, as handed to the render thread
+    struct DrawItem {
+        ModelHandle model;
+        // GPU_PASS the entity is drawn in
+        int pass;
+        glm::mat4 world;
+        // inverse transpose of the world matrix, std140 mat3 layout
+        glm::mat3x4 normalMatrix;
+    };
+
+    // Entity store in structure-of-arrays form: every component lives in its own
+    // contiguous array indexed by a dense slot, and entity ids map to slots
+    // through a sparse table. Destroying an entity moves the last slot into its
+    // place, so the arrays never have holes and the systems below are plain
+    // loops over them (split across the job system once they get long).
+    class Scene
+    {
+    public:
+        Scene();
+        ~Scene();
+
+        // models are owned by the scene and shared by any number of entities
+        ModelHandle CreateModel();
+        Model3D* GetModel(ModelHandle model);
+        int GetModelCount();
+        // what is known of a model once its file has been parsed, set by the
+        // simulation thread: existing entities get the bounds, and so do the
+        // ones created later. Until then a model has no bounds and no meshes.
+        void SetModelInfo(ModelHandle model, const glm::vec4& bounds, int meshCount);
+        // distance from point to the nearest visible entity of each model
+        // (to its bounding sphere, 0 inside); distances needs GetModelCount() entries
+        void GetModelDistances(const glm::vec3& point, std::vector<float>& distances);
+
+        Entity CreateEntity(ModelHandle model, int pass);
+        void DestroyEntity(Entity entity);
+        bool IsAlive(Entity entity);
+        int GetEntityCount();
+
+        // transform and visibility components
+        void SetPosition(Entity entity, const glm::vec3& position);
+        glm::vec3 GetPosition(Entity entity);
+        void SetRotation(Entity entity, const glm::quat& rotation);
+        void SetScale(Entity entity, float scale);
+        void SetVisible(Entity entity, bool visible);
+        bool IsVisible(Entity entity);
+        // circles the Y axis through the current origin at speed degrees per
+        // second, offset is the position at angle 0
+        void AddOrbit(Entity entity, const glm::vec3& offset, float angle, float speed);
+
+        // systems, run by the simulation thread
+        // keeps the transforms of the last tick for UpdateWorldMatrices
+        void BeginTick();
+        void UpdateOrbits(float deltaTime);
+        // moves everything by offset (floating origin), including the
+        // previous-tick transforms so nothing is blended across the jump
+        void ShiftOrigin(const glm::vec3& offset);
+        // world and normal matrices placed alpha of the way from the last tick to
+        // the current one; only entities that moved during the last two ticks are
+        // recomputed, returns how many were
+        int UpdateWorldMatrices(float alpha);
+        // fills items with the visible entities whose bounds touch the frustum,
+        // sorted by pass and model; culledMeshes counts the meshes left out
+        void BuildDrawList(const glm::mat4& viewProjection, std::vector<DrawItem>& items, unsigned int* culledMeshes);
+
+        // deletes the models, needs the GL context
+        void Delete();
+
+    private:
+        // entity id -> dense slot (or INVALID_ENTITY), and slot -> entity id
+        std::vector<unsigned int> slots;
+        std::vector<Entity> entities;
+        std::vector<Entity> freeIds;
+
+        // dense components
+        std::vector<ModelHandle> models;
+        std::vector<int> passes;
+        std::vector<unsigned char> visible;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::quat> rotations;
+        std::vector<float> scales;
+        std::vector<glm::vec3> previousPositions;
+        std::vector<glm::quat> previousRotations;
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<glm::mat3x4> normalMatrices;
+        // tick in which the transform last changed, the world matrix is stale
+        // while it is the current or the previous tick
+        std::vector<unsigned int> changedTicks;
+        // object-space bounding sphere of the entity's model
+        std::vector<glm::vec4> localBounds;
+        // written by the culling pass, 1 when the entity is drawn
+        std::vector<unsigned char> inFrustum;
+
+        // orbit components, dense on their own
+        std::vector<Entity> orbitEntities;
+        std::vector<glm::vec3> orbitCenters;
+        std::vector<glm::vec3> orbitOffsets;
+        std::vector<float> orbitAngles;
+        std::vector<float> orbitSpeeds;
+
+        std::vector<Model3D*> modelTable;
+        // published by SetModelInfo, never read from the models themselves,
+        // which may be loading or unloading on another thread
+        std::vector<glm::vec4> modelBounds;
+        std::vector<int> modelMeshCounts;
+        unsigned int tick;
+        // slots UpdateWorldMatrices recomputes this frame, kept to reuse its capacity
+        std::vector<unsigned int> dirtySlots;
+        // parameters of the system currently spread over the job system
+        float blendAlpha;
+        // planes of the frustum being culled against, normals point inwards
+        glm::vec4 frustumPlanes[6];
+
+        unsigned int Slot(Entity entity);
+        void MarkChanged(unsigned int slot);
+
+        static void UpdateWorldMatrixRange(int begin, int end, void* data);
+        static void CullRange(int begin, int end, void* data);
+    };
+}
+
+#endif /* Scene_hpp */
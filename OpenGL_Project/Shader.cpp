@@ -1,25 +1,23 @@
 #include "Shader.hpp"
+#include "FileSystem.hpp"
+#include "ShaderCompiler.hpp"
+#include "Stats.hpp"
 
 namespace gps {
-    std::string Shader::readShaderFile(std::string fileName)
-    {
-        std::ifstream shaderFile;
-        std::string shaderString;
-
-        //open shader file
-        shaderFile.open(fileName.c_str());
-
-        std::stringstream shaderStringStream;
 
-        //read shader content into stream
-        shaderStringStream << shaderFile.rdbuf();
-
-        //close shader file
-        shaderFile.close();
+    namespace {
+        // last program made current through useShaderProgram
+        GLuint currentProgram = 0;
+    }
 
-        //convert stream into GLchar array
-        shaderString = shaderStringStream.str();
-        return shaderString;
+    std::string Shader::readShaderFile(std::string fileName)
+    {
+        // from the asset archive when it holds the file
+        FileData shaderFile;
+        if (!FileSystem::ReadFile(fileName, shaderFile) || shaderFile.IsEmpty()) {
+            return std::string();
+        }
+        return std::string((const char*)shaderFile.GetData(), shaderFile.GetSize());
     }
 
     void Shader::shaderCompileLog(GLuint shaderId)
@@ -44,47 +42,64 @@ namespace gps {
         //check linking info
         glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &success);
         if(!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            glGetProgramInfoLog(shaderProgramId, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
     }
 
+    std::string Shader::injectDefines(const std::string& source, const std::vector<std::string>& defines)
+    {
+        if (defines.empty()) {
+            return source;
+        }
+
+        std::string defineBlock;
+        for (size_t i = 0; i < defines.size(); i++) {
+            defineBlock += "#define " + defines[i] + "\n";
+        }
+
+        //#version has to stay the first statement, so the defines go right after it
+        size_t versionPos = source.find("#version");
+        if (versionPos == std::string::npos) {
+            return defineBlock + source;
+        }
+        size_t lineEnd = source.find('\n', versionPos);
+        if (lineEnd == std::string::npos) {
+            return source + "\n" + defineBlock;
+        }
+
+        //restore the original numbering so compile errors point at the right line
+        return source.substr(0, lineEnd + 1) + defineBlock + "#line 2\n" + source.substr(lineEnd + 1);
+    }
+
     void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName)
     {
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
-        const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
-
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
-        const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
-        //check compilation status
-        shaderCompileLog(fragmentShader);
-
-        //attach and link the shader programs
-        this->shaderProgram = glCreateProgram();
-        glAttachShader(this->shaderProgram, vertexShader);
-        glAttachShader(this->shaderProgram, fragmentShader);
-        glLinkProgram(this->shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        //check linking info
-        shaderLinkLog(this->shaderProgram);
+        loadShader(vertexShaderFileName, fragmentShaderFileName, std::vector<std::string>());
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const std::vector<std::string>& defines)
+    {
+        //synchronous load: submit and wait right away
+        ShaderCompiler compiler;
+        compiler.Submit(this, vertexShaderFileName, fragmentShaderFileName, defines);
+        compiler.WaitAll();
     }
 
-    void Shader::useShaderProgram()
+    void Shader::useShaderProgram() const
     {
+        if (this->shaderProgram != currentProgram) {
+            Stats::Add(STAT_PROGRAM_SWITCHES, 1);
+            currentProgram = this->shaderProgram;
+        }
         glUseProgram(this->shaderProgram);
     }
 
+    void Shader::bindUniformBlock(const char* blockName, GLuint bindingPoint)
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(this->shaderProgram, blockName);
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(this->shaderProgram, blockIndex, bindingPoint);
+        }
+    }
+
 }
@@ -8,18 +8,29 @@
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace gps {
 
+class ShaderCompiler;
+
 class Shader
 {
 public:
     GLuint shaderProgram;
     void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
-    void useShaderProgram();
+    // compiles with each entry of defines ("NAME" or "NAME VALUE") injected as a #define after #version
+    void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const std::vector<std::string>& defines);
+    void useShaderProgram() const;
+    // attaches a named uniform block to a binding point (ignored if the block is unused)
+    void bindUniformBlock(const char* blockName, GLuint bindingPoint);
 
 private:
+    // the compiler drives loading, asynchronously or not
+    friend class ShaderCompiler;
+
     std::string readShaderFile(std::string fileName);
+    std::string injectDefines(const std::string& source, const std::vector<std::string>& defines);
     void shaderCompileLog(GLuint shaderId);
     void shaderLinkLog(GLuint shaderProgramId);
 };
@@ -0,0 +1,151 @@
+#include "ShaderCompiler.hpp"
+#include "ProgramCache.hpp"
+#include "LoadReport.hpp"
+
+namespace gps {
+
+    bool ShaderCompiler::parallelCompile = false;
+
+    ShaderCompiler::~ShaderCompiler()
+    {
+        WaitAll();
+    }
+
+    void ShaderCompiler::EnableParallelCompile()
+    {
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+        else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+        std::cout << "Parallel shader compile: " << (parallelCompile ? "enabled" : "not supported") << std::endl;
+    }
+
+    bool ShaderCompiler::IsParallelCompileAvailable()
+    {
+        return parallelCompile;
+    }
+
+    void ShaderCompiler::Submit(gps::Shader* target, std::string vertexShaderFileName, std::string fragmentShaderFileName,
+        const std::vector<std::string>& defines)
+    {
+        PendingProgram program;
+        program.target = target;
+        program.name = fragmentShaderFileName;
+        program.start = std::chrono::high_resolution_clock::now();
+
+        std::string reportName = fragmentShaderFileName;
+        for (size_t i = 0; i < defines.size(); i++) {
+            reportName += (i == 0 ? " " : ";") + defines[i];
+        }
+        program.report = LoadReport::Begin(LOAD_SHADER, reportName);
+
+        //read the sources and inject the variant defines
+        std::string v = target->injectDefines(target->readShaderFile(vertexShaderFileName), defines);
+        std::string f = target->injectDefines(target->readShaderFile(fragmentShaderFileName), defines);
+        std::chrono::duration<double, std::milli> io = std::chrono::high_resolution_clock::now() - program.start;
+        LoadReport::Get(program.report).ioMs = io.count();
+        LoadReport::Get(program.report).diskBytes = v.size() + f.size();
+
+        //reuse the program binary from a previous run when the driver accepts it
+        program.cacheKey = ProgramCache::MakeKey(v, f, defines);
+        target->shaderProgram = ProgramCache::Load(program.cacheKey);
+        if (target->shaderProgram != 0) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - program.start;
+            LoadReport::Get(program.report).compileMs = elapsed.count() - io.count();
+            std::cout << "Program cache hit  " << program.name << " [" << program.cacheKey << "] "
+                << elapsed.count() << " ms" << std::endl;
+            return;
+        }
+
+        //queue both stages; none of these calls waits for the compiler
+        std::chrono::high_resolution_clock::time_point compileStart = std::chrono::high_resolution_clock::now();
+        const GLchar* vertexShaderString = v.c_str();
+        program.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(program.vertexShader, 1, &vertexShaderString, NULL);
+        glCompileShader(program.vertexShader);
+
+        const GLchar* fragmentShaderString = f.c_str();
+        program.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(program.fragmentShader, 1, &fragmentShaderString, NULL);
+        glCompileShader(program.fragmentShader);
+
+        program.program = glCreateProgram();
+        //ask the driver to keep the binary around for the program cache
+        glProgramParameteri(program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program.program, program.vertexShader);
+        glAttachShader(program.program, program.fragmentShader);
+        glLinkProgram(program.program);
+        //drivers without parallel compile may do the work right here
+        std::chrono::duration<double, std::milli> compile = std::chrono::high_resolution_clock::now() - compileStart;
+        program.compileMs = compile.count();
+
+        target->shaderProgram = program.program;
+        pending.push_back(program);
+    }
+
+    bool ShaderCompiler::IsComplete(const PendingProgram& program)
+    {
+        if (!parallelCompile) {
+            // any status query would block, so only WaitAll finishes programs
+            return false;
+        }
+        GLint complete = GL_FALSE;
+        glGetProgramiv(program.program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    void ShaderCompiler::Finish(PendingProgram& program)
+    {
+        //these status queries wait for the driver if it is not done yet
+        std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+        program.target->shaderCompileLog(program.vertexShader);
+        program.target->shaderCompileLog(program.fragmentShader);
+        program.target->shaderLinkLog(program.program);
+        std::chrono::duration<double, std::milli> wait = std::chrono::high_resolution_clock::now() - waitStart;
+
+        glDetachShader(program.program, program.vertexShader);
+        glDetachShader(program.program, program.fragmentShader);
+        glDeleteShader(program.vertexShader);
+        glDeleteShader(program.fragmentShader);
+
+        ProgramCache::Store(program.cacheKey, program.program);
+
+        //only the time spent in the compiler counts, not the loading done
+        //between Submit and the point the program was finished
+        LoadReport::Get(program.report).compileMs = program.compileMs + wait.count();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - program.start;
+        std::cout << "Program cache miss " << program.name << " [" << program.cacheKey << "] ready after "
+            << elapsed.count() << " ms (" << program.compileMs + wait.count() << " ms compiling)" << std::endl;
+    }
+
+    size_t ShaderCompiler::Poll()
+    {
+        for (size_t i = 0; i < pending.size(); ) {
+            if (IsComplete(pending[i])) {
+                Finish(pending[i]);
+                pending.erase(pending.begin() + i);
+            }
+            else {
+                i++;
+            }
+        }
+        return pending.size();
+    }
+
+    void ShaderCompiler::WaitAll()
+    {
+        for (size_t i = 0; i < pending.size(); i++) {
+            Finish(pending[i]);
+        }
+        pending.clear();
+    }
+
+    size_t ShaderCompiler::GetPendingCount()
+    {
+        return pending.size();
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ShaderCompiler_hpp
+#define ShaderCompiler_hpp
+
+#include "Shader.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Starts program compilation without waiting for the driver. With
+    // KHR_parallel_shader_compile the driver compiles on its own threads and
+    // Poll() checks GL_COMPLETION_STATUS, so the application can keep loading
+    // models and textures meanwhile. Program binary cache hits finish at Submit.
+    class ShaderCompiler
+    {
+    public:
+        ~ShaderCompiler();
+
+        // lets the driver use all its compiler threads, when supported
+        static void EnableParallelCompile();
+        static bool IsParallelCompileAvailable();
+
+        // starts building target, whose shaderProgram is valid once finished
+        void Submit(gps::Shader* target, std::string vertexShaderFileName, std::string fragmentShaderFileName,
+            const std::vector<std::string>& defines);
+
+        // finishes every program the driver is done with, never blocks;
+        // returns the number of programs still compiling
+        size_t Poll();
+        // blocks until every submitted program is finished
+        void WaitAll();
+
+        size_t GetPendingCount();
+
+    private:
+        struct PendingProgram {
+            gps::Shader* target;
+            GLuint program;
+            GLuint vertexShader;
+            GLuint fragmentShader;
+            std::string name;
+            std::string cacheKey;
+            std::chrono::high_resolution_clock::time_point start;
+            // spent in the compile and link calls of Submit
+            double compileMs;
+            // LoadReport entry
+            size_t report;
+        };
+        std::vector<PendingProgram> pending;
+
+        static bool parallelCompile;
+
+        bool IsComplete(const PendingProgram& program);
+        void Finish(PendingProgram& program);
+    };
+}
+
+#endif /* ShaderCompiler_hpp */
@@ -0,0 +1,83 @@
+#include "ShaderPermutations.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    ShaderPermutations::~ShaderPermutations()
+    {
+        Delete();
+    }
+
+    void ShaderPermutations::Init(std::string vertexShaderFileName, std::string fragmentShaderFileName)
+    {
+        this->vertexShaderFileName = vertexShaderFileName;
+        this->fragmentShaderFileName = fragmentShaderFileName;
+    }
+
+    void ShaderPermutations::BindUniformBlock(const char* blockName, GLuint bindingPoint)
+    {
+        uniformBlocks.push_back(std::make_pair(std::string(blockName), bindingPoint));
+
+        for (std::map<std::string, gps::Shader>::iterator it = variants.begin(); it != variants.end(); ++it) {
+            it->second.bindUniformBlock(blockName, bindingPoint);
+        }
+    }
+
+    void ShaderPermutations::Submit(gps::ShaderCompiler& compiler, const std::vector<std::string>& defines)
+    {
+        std::string key = MakeKey(defines);
+        if (variants.find(key) != variants.end()) {
+            return;
+        }
+
+        // map nodes never move, so the compiler can fill the entry in place
+        gps::Shader& variant = variants[key];
+        variant.shaderProgram = 0;
+        compiler.Submit(&variant, vertexShaderFileName, fragmentShaderFileName, defines);
+    }
+
+    gps::Shader ShaderPermutations::Get(const std::vector<std::string>& defines)
+    {
+        std::string key = MakeKey(defines);
+
+        std::map<std::string, gps::Shader>::iterator it = variants.find(key);
+        if (it != variants.end()) {
+            return it->second;
+        }
+
+        std::cout << "Compiling variant [" << key << "] of " << fragmentShaderFileName << std::endl;
+        gps::Shader variant;
+        variant.loadShader(vertexShaderFileName, fragmentShaderFileName, defines);
+        for (size_t i = 0; i < uniformBlocks.size(); i++) {
+            variant.bindUniformBlock(uniformBlocks[i].first.c_str(), uniformBlocks[i].second);
+        }
+
+        variants[key] = variant;
+        return variant;
+    }
+
+    void ShaderPermutations::Delete()
+    {
+        for (std::map<std::string, gps::Shader>::iterator it = variants.begin(); it != variants.end(); ++it) {
+            glDeleteProgram(it->second.shaderProgram);
+        }
+        variants.clear();
+    }
+
+    // canonical key: sorted, duplicate-free defines joined with ';'
+    std::string ShaderPermutations::MakeKey(std::vector<std::string> defines)
+    {
+        std::sort(defines.begin(), defines.end());
+        defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+
+        std::string key;
+        for (size_t i = 0; i < defines.size(); i++) {
+            if (i > 0) {
+                key += ";";
+            }
+            key += defines[i];
+        }
+        return key;
+    }
+}
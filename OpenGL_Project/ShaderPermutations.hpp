@@ -0,0 +1,46 @@
+#ifndef ShaderPermutations_hpp
+#define ShaderPermutations_hpp
+
+#include "Shader.hpp"
+#include "ShaderCompiler.hpp"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    // Compiled variants of one vertex/fragment pair, keyed by their set of #defines.
+    // Feature switches pick a variant instead of branching on a uniform per fragment.
+    class ShaderPermutations
+    {
+    public:
+        ~ShaderPermutations();
+
+        void Init(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+
+        // uniform block binding applied to every variant, present and future
+        void BindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+        // queues a variant on an asynchronous compiler; the variant is usable once the
+        // compiler finished it, and BindUniformBlock must be called after that
+        void Submit(gps::ShaderCompiler& compiler, const std::vector<std::string>& defines);
+
+        // returns the variant for the given defines (order does not matter),
+        // compiling it on first use
+        gps::Shader Get(const std::vector<std::string>& defines);
+
+        void Delete();
+
+    private:
+        std::string vertexShaderFileName;
+        std::string fragmentShaderFileName;
+        std::vector<std::pair<std::string, GLuint> > uniformBlocks;
+        std::map<std::string, gps::Shader> variants;
+
+        static std::string MakeKey(std::vector<std::string> defines);
+    };
+}
+
+#endif /* ShaderPermutations_hpp */
@@ -0,0 +1,128 @@
+#include "SimdMath.hpp"
+
+#ifdef GPS_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+        // the scale is uniform, so the inverse transpose of R * s is simply R / s
+        float InverseScale(float scale)
+        {
+            return scale != 0.0f ? 1.0f / scale : 1.0f;
+        }
+
+        void ComposeTransform(const glm::vec3& position, const glm::quat& rotation, float scale,
+            glm::mat4& world, glm::mat3x4& normal)
+        {
+            glm::mat3 r = glm::mat3_cast(rotation);
+            float inverseScale = InverseScale(scale);
+            for (int c = 0; c < 3; c++) {
+                world[c] = glm::vec4(r[c] * scale, 0.0f);
+                normal[c] = glm::vec4(r[c] * inverseScale, 0.0f);
+            }
+            world[3] = glm::vec4(position, 1.0f);
+        }
+
+#ifdef GPS_SIMD_SSE
+        // writes column c of four matrices, one lane each; the fourth row is w
+        void StoreColumns(__m128 x, __m128 y, __m128 z, __m128 w, glm::vec4* c0, glm::vec4* c1, glm::vec4* c2, glm::vec4* c3)
+        {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(&c0->x, x);
+            _mm_storeu_ps(&c1->x, y);
+            _mm_storeu_ps(&c2->x, z);
+            _mm_storeu_ps(&c3->x, w);
+        }
+
+        // four transforms starting at first
+        void ComposeTransforms4(const glm::vec3* positions, const glm::quat* rotations, const float* scales,
+            glm::mat4* worlds, glm::mat3x4* normals)
+        {
+            // one quaternion per lane
+            __m128 qx = _mm_set_ps(rotations[3].x, rotations[2].x, rotations[1].x, rotations[0].x);
+            __m128 qy = _mm_set_ps(rotations[3].y, rotations[2].y, rotations[1].y, rotations[0].y);
+            __m128 qz = _mm_set_ps(rotations[3].z, rotations[2].z, rotations[1].z, rotations[0].z);
+            __m128 qw = _mm_set_ps(rotations[3].w, rotations[2].w, rotations[1].w, rotations[0].w);
+            __m128 s = _mm_loadu_ps(scales);
+            __m128 inverseS = _mm_set_ps(InverseScale(scales[3]), InverseScale(scales[2]), InverseScale(scales[1]), InverseScale(scales[0]));
+
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 two = _mm_set1_ps(2.0f);
+            __m128 xx = _mm_mul_ps(qx, qx);
+            __m128 yy = _mm_mul_ps(qy, qy);
+            __m128 zz = _mm_mul_ps(qz, qz);
+            __m128 xy = _mm_mul_ps(qx, qy);
+            __m128 xz = _mm_mul_ps(qx, qz);
+            __m128 yz = _mm_mul_ps(qy, qz);
+            __m128 wx = _mm_mul_ps(qw, qx);
+            __m128 wy = _mm_mul_ps(qw, qy);
+            __m128 wz = _mm_mul_ps(qw, qz);
+
+            // rotation matrix, same layout as glm::mat3_cast (m[column][row])
+            __m128 m00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+            __m128 m01 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+            __m128 m02 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+            __m128 m10 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+            __m128 m11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+            __m128 m12 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+            __m128 m20 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+            __m128 m21 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+            __m128 m22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+            __m128 zero = _mm_setzero_ps();
+            StoreColumns(_mm_mul_ps(m00, s), _mm_mul_ps(m01, s), _mm_mul_ps(m02, s), zero,
+                &worlds[0][0], &worlds[1][0], &worlds[2][0], &worlds[3][0]);
+            StoreColumns(_mm_mul_ps(m10, s), _mm_mul_ps(m11, s), _mm_mul_ps(m12, s), zero,
+                &worlds[0][1], &worlds[1][1], &worlds[2][1], &worlds[3][1]);
+            StoreColumns(_mm_mul_ps(m20, s), _mm_mul_ps(m21, s), _mm_mul_ps(m22, s), zero,
+                &worlds[0][2], &worlds[1][2], &worlds[2][2], &worlds[3][2]);
+            for (int i = 0; i < 4; i++) {
+                worlds[i][3] = glm::vec4(positions[i], 1.0f);
+            }
+
+            StoreColumns(_mm_mul_ps(m00, inverseS), _mm_mul_ps(m01, inverseS), _mm_mul_ps(m02, inverseS), zero,
+                &normals[0][0], &normals[1][0], &normals[2][0], &normals[3][0]);
+            StoreColumns(_mm_mul_ps(m10, inverseS), _mm_mul_ps(m11, inverseS), _mm_mul_ps(m12, inverseS), zero,
+                &normals[0][1], &normals[1][1], &normals[2][1], &normals[3][1]);
+            StoreColumns(_mm_mul_ps(m20, inverseS), _mm_mul_ps(m21, inverseS), _mm_mul_ps(m22, inverseS), zero,
+                &normals[0][2], &normals[1][2], &normals[2][2], &normals[3][2]);
+        }
+#endif
+    }
+
+    void SimdMath::ComposeTransforms(const glm::vec3* positions, const glm::quat* rotations, const float* scales,
+        int count, glm::mat4* worlds, glm::mat3x4* normals)
+    {
+        int i = 0;
+#ifdef GPS_SIMD_SSE
+        for (; i + 4 <= count; i += 4) {
+            ComposeTransforms4(positions + i, rotations + i, scales + i, worlds + i, normals + i);
+        }
+#endif
+        for (; i < count; i++) {
+            ComposeTransform(positions[i], rotations[i], scales[i], worlds[i], normals[i]);
+        }
+    }
+
+    void SimdMath::Multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+    {
+#ifdef GPS_SIMD_SSE
+        // every column of the result is a combination of the columns of a
+        __m128 a0 = _mm_loadu_ps(&a[0].x);
+        __m128 a1 = _mm_loadu_ps(&a[1].x);
+        __m128 a2 = _mm_loadu_ps(&a[2].x);
+        __m128 a3 = _mm_loadu_ps(&a[3].x);
+        for (int c = 0; c < 4; c++) {
+            __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[c].x));
+            column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[c].y)));
+            column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[c].z)));
+            column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[c].w)));
+            _mm_storeu_ps(&out[c].x, column);
+        }
+#else
+        out = a * b;
+#endif
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SimdMath_hpp
+#define SimdMath_hpp
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// SSE is part of every x86-64 target and of the x86 builds we ship; other
+// targets take the scalar path
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define GPS_SIMD_SSE 1
+#endif
+
+namespace gps {
+
+    // Matrix kernels for the transform system. Inputs and outputs are plain
+    // glm arrays (no alignment required); the SSE path works on four
+    // transforms per iteration with one entity in each lane.
+    class SimdMath
+    {
+    public:
+        // worlds[i] = translate(positions[i]) * rotate(rotations[i]) * scale(scales[i])
+        // normals[i] = inverse transpose of its upper 3x3, std140 mat3 layout
+        static void ComposeTransforms(const glm::vec3* positions, const glm::quat* rotations, const float* scales,
+            int count, glm::mat4* worlds, glm::mat3x4* normals);
+
+        // out = a * b
+        static void Multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out);
+    };
+}
+
+#endif /* SimdMath_hpp */
@@ -0,0 +1,76 @@
+#include "SimulationClock.hpp"
+
+namespace gps {
+
+    namespace {
+        // longer frames are cut short instead of running a burst of catch-up ticks
+        const double MAX_FRAME_SECONDS = 0.25;
+    }
+
+    SimulationClock::SimulationClock()
+    {
+        tickSeconds = 1.0 / 60.0;
+        accumulator = 0.0;
+        tickIndex = 0;
+        started = false;
+    }
+
+    void SimulationClock::Start(double ticksPerSecond)
+    {
+        tickSeconds = 1.0 / ticksPerSecond;
+        accumulator = 0.0;
+        tickIndex = 0;
+        lastTime = std::chrono::high_resolution_clock::now();
+        started = true;
+    }
+
+    void SimulationClock::Advance()
+    {
+        std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+        if (!started) {
+            lastTime = now;
+            started = true;
+        }
+        std::chrono::duration<double> elapsed = now - lastTime;
+        lastTime = now;
+        AdvanceBy(elapsed.count());
+    }
+
+    void SimulationClock::AdvanceBy(double seconds)
+    {
+        if (seconds > MAX_FRAME_SECONDS) {
+            seconds = MAX_FRAME_SECONDS;
+        }
+        accumulator += seconds;
+    }
+
+    bool SimulationClock::Tick()
+    {
+        if (accumulator < tickSeconds) {
+            return false;
+        }
+        accumulator -= tickSeconds;
+        tickIndex++;
+        return true;
+    }
+
+    double SimulationClock::GetTickSeconds()
+    {
+        return tickSeconds;
+    }
+
+    double SimulationClock::GetAlpha()
+    {
+        return accumulator / tickSeconds;
+    }
+
+    unsigned long long SimulationClock::GetTickIndex()
+    {
+        return tickIndex;
+    }
+
+    double SimulationClock::GetSimulationTime()
+    {
+        return tickIndex * tickSeconds;
+    }
+}
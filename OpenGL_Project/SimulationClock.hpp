@@ -0,0 +1,42 @@
+#ifndef SimulationClock_hpp
+#define SimulationClock_hpp
+
+#include <chrono>
+
+namespace gps {
+
+    // Fixed-timestep clock. Real frame time is accumulated and consumed in
+    // ticks of exactly GetTickSeconds(), so the simulation advances the same
+    // way at any frame rate; GetAlpha() tells how far the frame is between the
+    // last two ticks, for interpolating what is drawn.
+    class SimulationClock
+    {
+    public:
+        SimulationClock();
+
+        void Start(double ticksPerSecond);
+
+        // accumulates the real time since the last call
+        void Advance();
+        // accumulates a given amount instead (benchmarks, replays)
+        void AdvanceBy(double seconds);
+        // true while a full tick is accumulated, consuming it
+        bool Tick();
+
+        double GetTickSeconds();
+        // 0 = last tick, 1 = next tick
+        double GetAlpha();
+        // number of ticks run so far
+        unsigned long long GetTickIndex();
+        double GetSimulationTime();
+
+    private:
+        double tickSeconds;
+        double accumulator;
+        unsigned long long tickIndex;
+        std::chrono::high_resolution_clock::time_point lastTime;
+        bool started;
+    };
+}
+
+#endif /* SimulationClock_hpp */
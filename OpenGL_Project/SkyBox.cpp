@@ -7,12 +7,17 @@
 //
 
 #include "SkyBox.hpp"
+#include "Stats.hpp"
+#include "Profiler.hpp"
+#include "LoadReport.hpp"
+#include "FileSystem.hpp"
 
 namespace gps {
     
     SkyBox::SkyBox()
     {
-        
+        samplerProgram = 0;
+        samplerLocation = -1;
     }
     
     void SkyBox::Load(std::vector<const GLchar*> cubeMapFaces)
@@ -21,22 +26,26 @@ namespace gps {
         InitSkyBox();
     }
     
-    void SkyBox::Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    void SkyBox::Draw(const gps::Shader& shader)
     {
         shader.useShaderProgram();
         
-        //set the view and projection matrices
-        glm::mat4 transformedView = glm::mat4(glm::mat3(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        //the view and projection matrices come from the FrameData uniform block
         
         glDepthFunc(GL_LEQUAL);
         
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
+        if (shader.shaderProgram != samplerProgram) {
+            samplerLocation = glGetUniformLocation(shader.shaderProgram, "skybox");
+            samplerProgram = shader.shaderProgram;
+        }
+        glUniform1i(samplerLocation, 0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        Stats::Add(STAT_DRAW_CALLS, 1);
+        Stats::Add(STAT_TRIANGLES, 12);
+        Stats::Add(STAT_TEXTURE_BINDS, 1);
         glBindVertexArray(0);
         
         glDepthFunc(GL_LESS);
@@ -44,6 +53,7 @@ namespace gps {
     
     GLuint SkyBox::LoadSkyBoxTextures(std::vector<const GLchar*> skyBoxFaces)
     {
+        GPS_PROFILE_SCOPE("SkyBox::LoadSkyBoxTextures");
         GLuint textureID;
         glGenTextures(1, &textureID);
         glActiveTexture(GL_TEXTURE0);
@@ -55,15 +65,32 @@ namespace gps {
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
         for(GLuint i = 0; i < skyBoxFaces.size(); i++)
         {
-            image = stbi_load(skyBoxFaces[i], &width, &height, &n, force_channels);
+            size_t report = LoadReport::Begin(LOAD_TEXTURE, skyBoxFaces[i]);
+            long long start = Profiler::Now();
+            FileData file;
+            FileSystem::ReadFile(skyBoxFaces[i], file);
+            LoadReport::Get(report).diskBytes = file.GetSize();
+            LoadReport::Get(report).ioMs = LoadReport::Elapsed(start, Profiler::Now());
+
+            start = Profiler::Now();
+            image = file.IsEmpty() ? NULL : stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &n, force_channels);
             if (!image) {
                 fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i]);
                 return false;
             }
+            LoadReport::Get(report).decodeMs = LoadReport::Elapsed(start, Profiler::Now());
+
+            start = Profiler::Now();
             glTexImage2D(
                          GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
                          GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image
                          );
+            LoadReport::Get(report).uploadMs = LoadReport::Elapsed(start, Profiler::Now());
+            stbi_image_free(image);
+            // drivers usually pad RGB8 to four bytes per texel
+            Stats::AddMemory(MEMORY_TEXTURES, (long long)width * height * 4);
+            LoadReport::Get(report).cpuBytes = (unsigned long long)width * height * 3;
+            LoadReport::Get(report).gpuBytes = (unsigned long long)width * height * 4;
         }
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -127,6 +154,7 @@ namespace gps {
         glBindVertexArray(skyboxVAO);
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        Stats::AddMemory(MEMORY_BUFFERS, sizeof(skyboxVertices));
         
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
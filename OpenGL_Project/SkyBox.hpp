@@ -22,12 +22,15 @@ namespace gps {
     public:
         SkyBox();
         void Load(std::vector<const GLchar*> cubeMapFaces);
-        void Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        void Draw(const gps::Shader& shader);
         GLuint GetTextureId();
     private:
         GLuint skyboxVAO;
         GLuint skyboxVBO;
         GLuint cubemapTexture;
+        // "skybox" sampler location, looked up again only when the program changes
+        GLuint samplerProgram;
+        GLint samplerLocation;
         GLuint LoadSkyBoxTextures(std::vector<const GLchar*> cubeMapFaces);
         void InitSkyBox();
     };
@@ -0,0 +1,77 @@
+#include "Stats.hpp"
+#include "AllocTracker.hpp"
+
+namespace gps {
+
+    unsigned long long Stats::current[STAT_COUNTER_COUNT];
+    unsigned long long Stats::lastFrame[STAT_COUNTER_COUNT];
+    std::atomic<long long> Stats::memory[STAT_MEMORY_COUNT];
+    unsigned long long Stats::frameAllocations;
+
+    namespace {
+        // indexed by STAT_COUNTER
+        const char* counterNames[STAT_COUNTER_COUNT] = {
+            "draw_calls",
+            "triangles",
+            "visible_meshes",
+            "culled_meshes",
+            "texture_binds",
+            "program_switches",
+            "allocations",
+        };
+
+        // indexed by STAT_MEMORY
+        const char* memoryNames[STAT_MEMORY_COUNT] = {
+            "buffer_bytes",
+            "texture_bytes",
+        };
+    }
+
+    void Stats::Add(STAT_COUNTER counter, unsigned long long value)
+    {
+        current[counter] += value;
+    }
+
+    void Stats::BeginFrame()
+    {
+        // allocations happen on any thread, so they are counted by the tracker
+        unsigned long long allocations = AllocTracker::GetAllocationCount();
+        current[STAT_ALLOCATIONS] = allocations - frameAllocations;
+        frameAllocations = allocations;
+
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+            lastFrame[i] = current[i];
+            current[i] = 0;
+        }
+    }
+
+    unsigned long long Stats::GetLastFrame(STAT_COUNTER counter)
+    {
+        return lastFrame[counter];
+    }
+
+    unsigned long long Stats::GetCurrent(STAT_COUNTER counter)
+    {
+        return current[counter];
+    }
+
+    const char* Stats::GetName(STAT_COUNTER counter)
+    {
+        return counterNames[counter];
+    }
+
+    void Stats::AddMemory(STAT_MEMORY kind, long long bytes)
+    {
+        memory[kind].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    long long Stats::GetMemory(STAT_MEMORY kind)
+    {
+        return memory[kind].load(std::memory_order_relaxed);
+    }
+
+    const char* Stats::GetName(STAT_MEMORY kind)
+    {
+        return memoryNames[kind];
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef Stats_hpp
+#define Stats_hpp
+
+#include <atomic>
+
+namespace gps {
+
+    // counters the renderer increments while it builds a frame
+    enum STAT_COUNTER {
+        STAT_DRAW_CALLS,
+        STAT_TRIANGLES,
+        // meshes submitted / rejected before submission
+        STAT_VISIBLE_MESHES,
+        STAT_CULLED_MESHES,
+        STAT_TEXTURE_BINDS,
+        // glUseProgram calls that changed the bound program
+        STAT_PROGRAM_SWITCHES,
+        // heap allocations made during the frame (sampled from AllocTracker)
+        STAT_ALLOCATIONS,
+        STAT_COUNTER_COUNT
+    };
+
+    // running totals of GPU memory, estimated from the sizes passed to GL
+    enum STAT_MEMORY {
+        MEMORY_BUFFERS,
+        MEMORY_TEXTURES,
+        STAT_MEMORY_COUNT
+    };
+
+    // Central registry of per-frame render statistics. Counters are plain
+    // integers bumped from the draw paths; BeginFrame moves the running values
+    // into the "last frame" snapshot that reports and overlays read.
+    class Stats
+    {
+    public:
+        static void Add(STAT_COUNTER counter, unsigned long long value);
+        // snapshots the counters of the finished frame and clears them
+        static void BeginFrame();
+
+        // value accumulated during the previous complete frame
+        static unsigned long long GetLastFrame(STAT_COUNTER counter);
+        // value accumulated so far in the current frame
+        static unsigned long long GetCurrent(STAT_COUNTER counter);
+        static const char* GetName(STAT_COUNTER counter);
+
+        // bytes is negative when memory is released; safe from any thread,
+        // the upload thread creates buffers and textures too
+        static void AddMemory(STAT_MEMORY memory, long long bytes);
+        static long long GetMemory(STAT_MEMORY memory);
+        static const char* GetName(STAT_MEMORY memory);
+
+    private:
+        static unsigned long long current[STAT_COUNTER_COUNT];
+        static unsigned long long lastFrame[STAT_COUNTER_COUNT];
+        static std::atomic<long long> memory[STAT_MEMORY_COUNT];
+        // allocation count when the current frame began
+        static unsigned long long frameAllocations;
+    };
+}
+
+#endif /* Stats_hpp */
@@ -0,0 +1,196 @@
+#include "StreamBuffer.hpp"
+#include "Stats.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace gps {
+
+    StreamBuffer::StreamBuffer()
+    {
+        target = GL_UNIFORM_BUFFER;
+        bufferId = 0;
+        frameSize = 0;
+        framesInFlight = 0;
+        frameIndex = 0;
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            fences[i] = 0;
+        }
+        persistent = false;
+        persistentPtr = NULL;
+        writePtr = NULL;
+        writeOffset = 0;
+        alignment = 1;
+        stallCount = 0;
+        stallMilliseconds = 0.0;
+    }
+
+    StreamBuffer::~StreamBuffer()
+    {
+        Delete();
+    }
+
+    void StreamBuffer::Create(GLenum target, GLsizeiptr frameSize, int framesInFlight)
+    {
+        Delete();
+
+        if (framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+            framesInFlight = MAX_FRAMES_IN_FLIGHT;
+        }
+
+        // every region must start on a bindable offset
+        alignment = 1;
+        if (target == GL_UNIFORM_BUFFER) {
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        }
+        this->target = target;
+        this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+        this->framesInFlight = framesInFlight;
+        this->frameIndex = framesInFlight - 1;
+
+        GLsizeiptr totalSize = this->frameSize * framesInFlight;
+        glGenBuffers(1, &bufferId);
+        glBindBuffer(target, bufferId);
+
+        persistent = GLEW_ARB_buffer_storage ? true : false;
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(target, totalSize, NULL, flags);
+            persistentPtr = (unsigned char*)glMapBufferRange(target, 0, totalSize, flags);
+            if (persistentPtr == NULL) {
+                // storage is immutable now, start over with a mutable buffer
+                glBindBuffer(target, 0);
+                glDeleteBuffers(1, &bufferId);
+                glGenBuffers(1, &bufferId);
+                glBindBuffer(target, bufferId);
+                persistent = false;
+            }
+        }
+        if (!persistent) {
+            glBufferData(target, totalSize, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(target, 0);
+        Stats::AddMemory(MEMORY_BUFFERS, totalSize);
+
+        std::cout << "Stream buffer: " << framesInFlight << " x " << this->frameSize << " bytes, "
+            << (persistent ? "persistent mapping" : "unsynchronized mapping") << std::endl;
+    }
+
+    void StreamBuffer::Delete()
+    {
+        if (bufferId == 0) {
+            return;
+        }
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (fences[i] != 0) {
+                glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+        }
+        if (persistentPtr != NULL || writePtr != NULL) {
+            glBindBuffer(target, bufferId);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+        glDeleteBuffers(1, &bufferId);
+        Stats::AddMemory(MEMORY_BUFFERS, -(long long)(frameSize * framesInFlight));
+        bufferId = 0;
+        persistentPtr = NULL;
+        writePtr = NULL;
+    }
+
+    void StreamBuffer::WaitForRegion(int region)
+    {
+        GLsync fence = fences[region];
+        if (fence == 0) {
+            return;
+        }
+
+        // fast path: the GPU is already done with the region
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            stallCount++;
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+            std::chrono::duration<double, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+            stallMilliseconds += waited.count();
+        }
+
+        glDeleteSync(fence);
+        fences[region] = 0;
+    }
+
+    void StreamBuffer::BeginFrame()
+    {
+        frameIndex = (frameIndex + 1) % framesInFlight;
+        WaitForRegion(frameIndex);
+
+        writeOffset = 0;
+        if (persistent) {
+            writePtr = persistentPtr + frameIndex * frameSize;
+        }
+        else {
+            // the fence already guarantees the region is idle, so skip the driver's own sync
+            glBindBuffer(target, bufferId);
+            writePtr = (unsigned char*)glMapBufferRange(target, frameIndex * frameSize, frameSize,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+            glBindBuffer(target, 0);
+        }
+    }
+
+    void* StreamBuffer::Allocate(GLsizeiptr size, GLintptr* offset)
+    {
+        GLsizeiptr alignedSize = (size + alignment - 1) / alignment * alignment;
+        if (writePtr == NULL || writeOffset + alignedSize > frameSize) {
+            return NULL;
+        }
+
+        void* ptr = writePtr + writeOffset;
+        *offset = frameIndex * frameSize + writeOffset;
+        writeOffset += alignedSize;
+        return ptr;
+    }
+
+    void StreamBuffer::FinishWrites()
+    {
+        if (persistent || writePtr == NULL) {
+            // coherent persistent mappings need no explicit flush
+            return;
+        }
+        glBindBuffer(target, bufferId);
+        if (writeOffset > 0) {
+            glFlushMappedBufferRange(target, 0, writeOffset);
+        }
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        writePtr = NULL;
+    }
+
+    void StreamBuffer::EndFrame()
+    {
+        FinishWrites();
+        fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    GLuint StreamBuffer::GetId()
+    {
+        return bufferId;
+    }
+
+    bool StreamBuffer::IsPersistent()
+    {
+        return persistent;
+    }
+
+    unsigned int StreamBuffer::GetStallCount()
+    {
+        return stallCount;
+    }
+
+    double StreamBuffer::GetStallMilliseconds()
+    {
+        return stallMilliseconds;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef StreamBuffer_hpp
+#define StreamBuffer_hpp
+
+#include "GL/glew.h"
+
+namespace gps {
+
+    // Ring buffer for data written by the CPU every frame (per-object uniforms,
+    // instance data). The buffer is split into framesInFlight regions; the CPU
+    // fills region N+2 while the GPU still reads region N, and a fence per region
+    // guards against overwriting data that is still in use.
+    // Uses persistently mapped storage (ARB_buffer_storage) when available and
+    // falls back to unsynchronized glMapBufferRange on plain 4.1 contexts.
+    class StreamBuffer
+    {
+    public:
+        static const int MAX_FRAMES_IN_FLIGHT = 4;
+
+        StreamBuffer();
+        ~StreamBuffer();
+
+        // reserves frameSize bytes for each frame in flight
+        void Create(GLenum target, GLsizeiptr frameSize, int framesInFlight = 3);
+        void Delete();
+
+        // waits for the GPU to release the next region and makes it writable
+        void BeginFrame();
+        // returns a write pointer to size bytes of the current region (NULL when full),
+        // offset receives the buffer offset to bind, aligned for uniform blocks
+        void* Allocate(GLsizeiptr size, GLintptr* offset);
+        // makes the written data visible to the GPU (must be called before drawing)
+        void FinishWrites();
+        // fences the current region, call after the last draw that reads it
+        void EndFrame();
+
+        GLuint GetId();
+        bool IsPersistent();
+        // number of frames where BeginFrame had to block on the GPU
+        unsigned int GetStallCount();
+        // total time spent blocked, in milliseconds
+        double GetStallMilliseconds();
+
+    private:
+        GLenum target;
+        GLuint bufferId;
+        GLsizeiptr frameSize;
+        int framesInFlight;
+        int frameIndex;
+        GLsync fences[MAX_FRAMES_IN_FLIGHT];
+
+        bool persistent;
+        unsigned char* persistentPtr;
+        unsigned char* writePtr;
+        GLsizeiptr writeOffset;
+        GLint alignment;
+
+        unsigned int stallCount;
+        double stallMilliseconds;
+
+        void WaitForRegion(int region);
+    };
+}
+
+#endif /* StreamBuffer_hpp */
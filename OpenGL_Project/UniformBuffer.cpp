@@ -0,0 +1,79 @@
+#include "UniformBuffer.hpp"
+#include "Stats.hpp"
+
+namespace gps {
+
+    UniformBuffer::UniformBuffer()
+    {
+        bufferId = 0;
+        size = 0;
+    }
+
+    UniformBuffer::~UniformBuffer()
+    {
+        Delete();
+    }
+
+    // allocates the buffer storage (contents undefined)
+    void UniformBuffer::Create(GLsizeiptr size)
+    {
+        Delete();
+        this->size = size;
+        glGenBuffers(1, &bufferId);
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+        glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        Stats::AddMemory(MEMORY_BUFFERS, size);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void UniformBuffer::Delete()
+    {
+        if (bufferId != 0) {
+            glDeleteBuffers(1, &bufferId);
+            Stats::AddMemory(MEMORY_BUFFERS, -(long long)size);
+            bufferId = 0;
+            size = 0;
+        }
+    }
+
+    // copies size bytes from data at the given offset
+    void UniformBuffer::Update(GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void UniformBuffer::BindBase(GLuint bindingPoint)
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, bufferId);
+    }
+
+    void UniformBuffer::BindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, bufferId, offset, size);
+    }
+
+    GLuint UniformBuffer::GetId()
+    {
+        return bufferId;
+    }
+
+    GLsizeiptr UniformBuffer::GetSize()
+    {
+        return size;
+    }
+
+    GLint UniformBuffer::GetOffsetAlignment()
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment;
+    }
+
+    GLsizeiptr UniformBuffer::AlignSize(GLsizeiptr size)
+    {
+        GLsizeiptr alignment = GetOffsetAlignment();
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef UniformBuffer_hpp
+#define UniformBuffer_hpp
+
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+namespace gps {
+
+    // binding points shared by every program that declares the blocks
+    enum UNIFORM_BINDING { FRAME_DATA_BINDING = 0, OBJECT_DATA_BINDING = 1 };
+
+    // std140 mirror of the FrameData block - updated once per frame
+    struct FrameData {
+        glm::mat4 view;
+        glm::mat4 projection;
+        // projection * rotation part of view, used by the skybox
+        glm::mat4 skyboxViewProjection;
+        // lighting is done in world space: direction towards the light and eye position
+        glm::vec4 lightDir;
+        glm::vec4 cameraPosition;
+        glm::vec4 lightColor;
+    };
+
+    // std140 mirror of the ObjectData block - one slot per drawn object
+    struct ObjectData {
+        glm::mat4 model;
+        glm::mat4 modelViewProjection;
+        // world space, a std140 mat3 is stored as three vec4 columns
+        glm::mat3x4 normalMatrix;
+    };
+
+    class UniformBuffer
+    {
+    public:
+        UniformBuffer();
+        ~UniformBuffer();
+
+        // allocates the buffer storage (contents undefined)
+        void Create(GLsizeiptr size);
+        void Delete();
+
+        // copies size bytes from data at the given offset
+        void Update(GLintptr offset, GLsizeiptr size, const void* data);
+
+        // binds the whole buffer to a binding point
+        void BindBase(GLuint bindingPoint);
+        // binds a sub-range (offset must respect GetOffsetAlignment())
+        void BindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size);
+
+        GLuint GetId();
+        GLsizeiptr GetSize();
+
+        // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of the current context
+        static GLint GetOffsetAlignment();
+        // rounds size up to a multiple of GetOffsetAlignment()
+        static GLsizeiptr AlignSize(GLsizeiptr size);
+
+    private:
+        GLuint bufferId;
+        GLsizeiptr size;
+    };
+}
+
+#endif /* UniformBuffer_hpp */
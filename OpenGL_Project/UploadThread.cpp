@@ -0,0 +1,208 @@
+#include "UploadThread.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gps {
+
+    namespace {
+        // how long an idle upload thread waits on a fence before checking for new requests
+        const GLuint64 FENCE_POLL_NANOSECONDS = 1000000;
+    }
+
+    UploadThread::UploadThread()
+    {
+        window = NULL;
+        queueHead = 0;
+        queueCount = 0;
+        running = false;
+        stopping = false;
+        inFlightHead = 0;
+        inFlightCount = 0;
+        staging = 0;
+        uploadCount = 0;
+        stagedBytes = 0;
+    }
+
+    bool UploadThread::Start(Window& window)
+    {
+        if (!window.createUploadContext()) {
+            return false;
+        }
+        this->window = &window;
+        running = true;
+        stopping = false;
+        thread = std::thread(&UploadThread::Run, this);
+        return true;
+    }
+
+    bool UploadThread::IsRunning()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running && !stopping;
+    }
+
+    void UploadThread::Stop()
+    {
+        if (!thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    bool UploadThread::Submit(UploadFunction upload, JobFunction done, void* data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running || stopping || queueCount == QUEUE_CAPACITY) {
+                return false;
+            }
+            Request& request = queue[(queueHead + queueCount) % QUEUE_CAPACITY];
+            request.upload = upload;
+            request.done = done;
+            request.data = data;
+            request.fence = 0;
+            queueCount++;
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    void UploadThread::Run()
+    {
+        Profiler::SetThreadName("Upload");
+        window->makeUploadContextCurrent();
+        glGenBuffers(1, &staging);
+
+        while (true) {
+            Request request;
+            bool started = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // with fences pending the thread polls them instead of sleeping
+                while (queueCount == 0 && inFlightCount == 0 && !stopping) {
+                    wake.wait(lock);
+                }
+                if (queueCount > 0) {
+                    request = queue[queueHead];
+                    queueHead = (queueHead + 1) % QUEUE_CAPACITY;
+                    queueCount--;
+                    started = true;
+                }
+                else if (stopping && inFlightCount == 0) {
+                    break;
+                }
+            }
+
+            if (started) {
+                GPS_PROFILE_SCOPE("UploadThread::Upload");
+                request.upload(*this, request.data);
+                request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                // submit now, the fence would otherwise sit in this context's queue
+                glFlush();
+                inFlight[(inFlightHead + inFlightCount) % QUEUE_CAPACITY] = request;
+                inFlightCount++;
+                uploadCount++;
+            }
+            // keep issuing while there is work, wait on the GPU only when idle
+            Retire(started ? 0 : FENCE_POLL_NANOSECONDS);
+        }
+
+        glDeleteBuffers(1, &staging);
+        staging = 0;
+        glFinish();
+        window->releaseUploadContext();
+    }
+
+    void UploadThread::Retire(GLuint64 timeout)
+    {
+        while (inFlightCount > 0) {
+            Request& request = inFlight[inFlightHead];
+            GLenum result = glClientWaitSync(request.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                return;
+            }
+            // GL_WAIT_FAILED only happens on a lost context, nothing would ever signal
+            glDeleteSync(request.fence);
+            request.done(request.data);
+            inFlightHead = (inFlightHead + 1) % QUEUE_CAPACITY;
+            inFlightCount--;
+            timeout = 0;
+        }
+    }
+
+    void* UploadThread::MapStaging(GLenum target, GLsizeiptr size)
+    {
+        glBindBuffer(target, staging);
+        // orphaning hands the driver a new block while the GPU still reads the old one
+        glBufferData(target, std::max(size, (GLsizeiptr)STAGING_BYTES), NULL, GL_STREAM_DRAW);
+        stagedBytes += size;
+        return glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    void UploadThread::UploadBuffer(GLuint buffer, const void* data, GLsizeiptr size)
+    {
+        // the copy targets leave every other binding (and any vertex array) alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+        const unsigned char* source = (const unsigned char*)data;
+        for (GLsizeiptr offset = 0; offset < size; offset += STAGING_BYTES) {
+            GLsizeiptr chunk = std::min((GLsizeiptr)STAGING_BYTES, size - offset);
+            void* mapped = MapStaging(GL_COPY_READ_BUFFER, chunk);
+            if (mapped == NULL) {
+                // no mapping: let the driver copy from client memory instead
+                glBufferSubData(GL_COPY_WRITE_BUFFER, offset, chunk, source + offset);
+                continue;
+            }
+            memcpy(mapped, source + offset, (size_t)chunk);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, chunk);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void UploadThread::UploadTexture(GLuint texture, int level, GLint internalFormat, int width, int height, const unsigned char* pixels)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // whole rows per chunk, at least one
+        GLsizeiptr rowBytes = (GLsizeiptr)width * 4;
+        int rowsPerChunk = (int)std::max((GLsizeiptr)1, STAGING_BYTES / rowBytes);
+        for (int row = 0; row < height; row += rowsPerChunk) {
+            int rows = std::min(rowsPerChunk, height - row);
+            GLsizeiptr chunk = rowBytes * rows;
+            void* mapped = MapStaging(GL_PIXEL_UNPACK_BUFFER, chunk);
+            if (mapped == NULL) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels + rowBytes * row);
+                continue;
+            }
+            memcpy(mapped, pixels + rowBytes * row, (size_t)chunk);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            // with an unpack buffer bound the pointer is an offset into it
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    unsigned int UploadThread::GetUploadCount()
+    {
+        return uploadCount;
+    }
+
+    unsigned long long UploadThread::GetStagedBytes()
+    {
+        return stagedBytes;
+    }
+}
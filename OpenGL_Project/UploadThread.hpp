@@ -0,0 +1,97 @@
+#ifndef UploadThread_hpp
+#define UploadThread_hpp
+
+#include "GL/glew.h"
+
+#include "JobSystem.hpp"
+#include "Window.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace gps {
+
+    class UploadThread;
+
+    // issues the GL commands of one request, with the upload context current
+    typedef void (*UploadFunction)(UploadThread& uploader, void* data);
+
+    // Thread owning a second GL context that shares buffers and textures with
+    // the render context. Requests run in submission order; each one is
+    // followed by a fence, and its done function is called (on this thread)
+    // only once the GPU has signaled it, so whatever the request created can
+    // be published to the renderer fully written. Data goes through one
+    // staging buffer, orphaned for every chunk so the CPU never waits for the
+    // previous copy, instead of glBufferData / glTexImage2D straight from
+    // client memory.
+    //
+    // Vertex arrays are not shared between contexts: they are left to the
+    // render thread, which creates them from the published buffers.
+    class UploadThread
+    {
+    public:
+        // requests waiting or in flight; a model has at most one of each
+        static const int QUEUE_CAPACITY = 256;
+        // size of one staging chunk
+        static const GLsizeiptr STAGING_BYTES = 4 * 1024 * 1024;
+
+        UploadThread();
+
+        // creates the shared context (on the thread owning the window's
+        // context) and starts the thread; false when contexts cannot be shared
+        bool Start(Window& window);
+        bool IsRunning();
+        // finishes the queued requests, waits for their fences and joins
+        void Stop();
+
+        // any thread; false when the thread is not running or the queue is
+        // full, the caller then uploads on the render thread as before
+        bool Submit(UploadFunction upload, JobFunction done, void* data);
+
+        // for upload functions: gives buffer size bytes of storage and fills it
+        void UploadBuffer(GLuint buffer, const void* data, GLsizeiptr size);
+        // one level of an RGBA8 texture, through the staging buffer as a pixel
+        // unpack buffer; the texture is left bound to GL_TEXTURE_2D
+        void UploadTexture(GLuint texture, int level, GLint internalFormat, int width, int height, const unsigned char* pixels);
+
+        // totals, read after Stop
+        unsigned int GetUploadCount();
+        unsigned long long GetStagedBytes();
+
+    private:
+        struct Request {
+            UploadFunction upload;
+            JobFunction done;
+            void* data;
+            GLsync fence;
+        };
+
+        Window* window;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        // submitted, not started yet
+        Request queue[QUEUE_CAPACITY];
+        int queueHead;
+        int queueCount;
+        bool running;
+        bool stopping;
+
+        // upload thread only: issued and fenced, oldest first
+        Request inFlight[QUEUE_CAPACITY];
+        int inFlightHead;
+        int inFlightCount;
+        GLuint staging;
+        unsigned int uploadCount;
+        unsigned long long stagedBytes;
+
+        void Run();
+        // maps a fresh staging chunk of size bytes bound to target
+        void* MapStaging(GLenum target, GLsizeiptr size);
+        // publishes the finished requests, waiting up to timeout for the oldest
+        void Retire(GLuint64 timeout);
+    };
+}
+
+#endif /* UploadThread_hpp */
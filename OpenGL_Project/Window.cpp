@@ -1,7 +1,32 @@
 #include "Window.h"
 
+#include <fstream>
+#include <vector>
+
+#ifdef GPS_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
 namespace gps {
 
+    Window::Window() {
+        this->window = NULL;
+        this->headless = false;
+        this->closeRequested = false;
+        this->framebuffer = 0;
+        this->colorRenderbuffer = 0;
+        this->depthRenderbuffer = 0;
+        this->eglDisplay = NULL;
+        this->eglContext = NULL;
+        this->eglSurface = NULL;
+        this->eglConfig = NULL;
+        this->uploadWindow = NULL;
+        this->eglUploadContext = NULL;
+        this->eglUploadSurface = NULL;
+    }
+
     void Window::Create(int width, int height, const char *title) {
         if (!glfwInit()) {
             throw std::runtime_error("Could not start GLFW3!");
@@ -28,21 +53,184 @@ namespace gps {
 
         glfwSwapInterval(1);
 
+        // start GLEW extension handler
+        initGLEW();
+
+        //for RETINA display
+        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    }
+
+    void Window::CreateHeadless(int width, int height) {
+        this->headless = true;
+
+        if (!createEGLContext()) {
+            // no EGL backend: a hidden window still gives us a context
+            if (!glfwInit()) {
+                throw std::runtime_error("Could not start GLFW3!");
+            }
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+            this->window = glfwCreateWindow(16, 16, "OpenGL Project (headless)", NULL, NULL);
+            if (!this->window) {
+                throw std::runtime_error("Could not create a headless OpenGL context!");
+            }
+            glfwMakeContextCurrent(window);
+            // never wait for a display that does not exist
+            glfwSwapInterval(0);
+        }
+
+        initGLEW();
+        createFramebuffer(width, height);
+    }
+
+    bool Window::createEGLContext() {
+#ifdef GPS_HEADLESS_EGL
+        // prefer Mesa's surfaceless platform, which needs no X/Wayland/GBM device
+        EGLDisplay display = EGL_NO_DISPLAY;
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+            std::cerr << "EGL: no display available" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cerr << "EGL: desktop OpenGL is not supported" << std::endl;
+            eglTerminate(display);
+            return false;
+        }
+
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool surfaceless = extensions != NULL && strstr(extensions, "EGL_KHR_surfaceless_context") != NULL;
+
+        EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+        EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        EGLContext context = eglCreateContext(display, configCount > 0 ? config : NULL, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT) {
+            std::cerr << "EGL: could not create an OpenGL 4.1 core context" << std::endl;
+            eglTerminate(display);
+            return false;
+        }
+
+        // we always render into our own framebuffer object, a 1x1 pbuffer is enough
+        EGLSurface surface = EGL_NO_SURFACE;
+        if (!surfaceless && configCount > 0) {
+            EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context)) {
+            std::cerr << "EGL: could not make the context current" << std::endl;
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            return false;
+        }
+
+        this->eglDisplay = display;
+        this->eglContext = context;
+        this->eglSurface = surface;
+        this->eglConfig = configCount > 0 ? config : NULL;
+        std::cout << "EGL headless context (" << (surfaceless ? "surfaceless" : "pbuffer") << ")" << std::endl;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Window::initGLEW() {
         // start GLEW extension handler
         glewExperimental = GL_TRUE;
-        glewInit();
+        GLenum glewError = glewInit();
+        // an EGL context has no GLX display, the core entry points are loaded regardless
+        if (glewError != GLEW_OK && glewError != GLEW_ERROR_NO_GLX_DISPLAY) {
+            std::cerr << "GLEW: " << glewGetErrorString(glewError) << std::endl;
+        }
 
         // get version info
         const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
         const GLubyte* version = glGetString(GL_VERSION); // version as a string
         std::cout << "Renderer: " << renderer << std::endl;
         std::cout << "OpenGL version: " << version << std::endl;
+    }
 
-        //for RETINA display
-        glfwGetFramebufferSize(window, &this->dimensions.width, &this->dimensions.height);
+    void Window::createFramebuffer(int width, int height) {
+        this->dimensions.width = width;
+        this->dimensions.height = height;
+
+        // sRGB color to match the window's GL_FRAMEBUFFER_SRGB output
+        glGenRenderbuffers(1, &colorRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Headless framebuffer is incomplete!");
+        }
+        // stays bound: the render loop draws into it as if it were the window
     }
 
     void Window::Delete() {
+        if (uploadWindow) {
+            glfwDestroyWindow(uploadWindow);
+            uploadWindow = NULL;
+        }
+#ifdef GPS_HEADLESS_EGL
+        if (eglUploadContext) {
+            if (eglUploadSurface != EGL_NO_SURFACE) {
+                eglDestroySurface((EGLDisplay)eglDisplay, (EGLSurface)eglUploadSurface);
+            }
+            eglDestroyContext((EGLDisplay)eglDisplay, (EGLContext)eglUploadContext);
+            eglUploadContext = NULL;
+        }
+#endif
+        if (framebuffer) {
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorRenderbuffer);
+            glDeleteRenderbuffers(1, &depthRenderbuffer);
+            framebuffer = 0;
+        }
+#ifdef GPS_HEADLESS_EGL
+        if (eglDisplay) {
+            eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (eglSurface != EGL_NO_SURFACE) {
+                eglDestroySurface((EGLDisplay)eglDisplay, (EGLSurface)eglSurface);
+            }
+            eglDestroyContext((EGLDisplay)eglDisplay, (EGLContext)eglContext);
+            eglTerminate((EGLDisplay)eglDisplay);
+            eglDisplay = NULL;
+            return;
+        }
+#endif
         if (window)
             glfwDestroyWindow(window);
         //close GL context and any other GLFW resources
@@ -60,4 +248,162 @@ namespace gps {
     void Window::setWindowDimensions(WindowDimensions dimensions) {
         this->dimensions = dimensions;
     }
-}
\ No newline at end of file
+
+    bool Window::isHeadless() {
+        return this->headless;
+    }
+
+    bool Window::shouldClose() {
+        if (closeRequested) {
+            return true;
+        }
+        return window != NULL && !headless && glfwWindowShouldClose(window);
+    }
+
+    void Window::setShouldClose(bool close) {
+        closeRequested = close;
+        if (window) {
+            glfwSetWindowShouldClose(window, close ? GL_TRUE : GL_FALSE);
+        }
+    }
+
+    void Window::pollEvents() {
+        if (window) {
+            glfwPollEvents();
+        }
+    }
+
+    void Window::swapBuffers() {
+        if (!headless) {
+            glfwSwapBuffers(window);
+        }
+        else {
+            // nothing to present, just hand the frame to the GPU
+            glFlush();
+        }
+    }
+
+    void Window::setSwapInterval(int interval) {
+        if (window && !headless) {
+            glfwSwapInterval(interval);
+        }
+    }
+
+    void Window::makeContextCurrent() {
+#ifdef GPS_HEADLESS_EGL
+        if (eglDisplay) {
+            EGLSurface surface = (EGLSurface)eglSurface;
+            eglMakeCurrent((EGLDisplay)eglDisplay, surface, surface, (EGLContext)eglContext);
+            return;
+        }
+#endif
+        if (window) {
+            glfwMakeContextCurrent(window);
+        }
+    }
+
+    void Window::releaseContext() {
+#ifdef GPS_HEADLESS_EGL
+        if (eglDisplay) {
+            eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            return;
+        }
+#endif
+        if (window) {
+            glfwMakeContextCurrent(NULL);
+        }
+    }
+
+    bool Window::createUploadContext() {
+#ifdef GPS_HEADLESS_EGL
+        if (eglDisplay) {
+            EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 4,
+                EGL_CONTEXT_MINOR_VERSION, 1,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            EGLContext context = eglCreateContext((EGLDisplay)eglDisplay, (EGLConfig)eglConfig, (EGLContext)eglContext, contextAttributes);
+            if (context == EGL_NO_CONTEXT) {
+                std::cerr << "EGL: could not create a shared upload context" << std::endl;
+                return false;
+            }
+            // surfaceless like the main context, or its own 1x1 pbuffer
+            EGLSurface surface = EGL_NO_SURFACE;
+            if (eglSurface != EGL_NO_SURFACE) {
+                EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+                surface = eglCreatePbufferSurface((EGLDisplay)eglDisplay, (EGLConfig)eglConfig, pbufferAttributes);
+            }
+            this->eglUploadContext = context;
+            this->eglUploadSurface = surface;
+            return true;
+        }
+#endif
+        if (!window) {
+            return false;
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        this->uploadWindow = glfwCreateWindow(1, 1, "OpenGL Project (uploads)", NULL, window);
+        glfwDefaultWindowHints();
+        if (!this->uploadWindow) {
+            std::cerr << "Could not create a shared upload context" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void Window::makeUploadContextCurrent() {
+#ifdef GPS_HEADLESS_EGL
+        if (eglUploadContext) {
+            EGLSurface surface = (EGLSurface)eglUploadSurface;
+            eglMakeCurrent((EGLDisplay)eglDisplay, surface, surface, (EGLContext)eglUploadContext);
+            return;
+        }
+#endif
+        if (uploadWindow) {
+            glfwMakeContextCurrent(uploadWindow);
+        }
+    }
+
+    void Window::releaseUploadContext() {
+#ifdef GPS_HEADLESS_EGL
+        if (eglUploadContext) {
+            eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            return;
+        }
+#endif
+        if (uploadWindow) {
+            glfwMakeContextCurrent(NULL);
+        }
+    }
+
+    GLuint Window::getFramebuffer() {
+        return this->framebuffer;
+    }
+
+    bool Window::saveScreenshot(const std::string& fileName) {
+        int width = dimensions.width;
+        int height = dimensions.height;
+        std::vector<unsigned char> pixels(width * height * 3);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+        std::ofstream file(fileName.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Could not write screenshot " << fileName << std::endl;
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        // OpenGL rows start at the bottom, PPM rows at the top
+        for (int row = height - 1; row >= 0; row--) {
+            file.write((const char*)&pixels[row * width * 3], width * 3);
+        }
+        return true;
+    }
+}
@@ -5,6 +5,7 @@
 #include "GLFW/glfw3.h"
 #include <stdexcept>
 #include <iostream>
+#include <string>
 
 struct WindowDimensions {
     int width;
@@ -16,16 +17,64 @@ namespace gps {
     class Window {
 
     public:
+        Window();
+
         void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        // offscreen context rendering into a width x height framebuffer object;
+        // built with GPS_HEADLESS_EGL it needs no display at all (EGL surfaceless
+        // or pbuffer, e.g. Mesa llvmpipe), otherwise it uses a hidden GLFW window
+        void CreateHeadless(int width, int height);
         void Delete();
 
         GLFWwindow* getWindow();
         WindowDimensions getWindowDimensions();
         void setWindowDimensions(WindowDimensions dimensions);
 
+        bool isHeadless();
+        bool shouldClose();
+        void setShouldClose(bool close);
+        void pollEvents();
+        void swapBuffers();
+        // 1 = vsync, 0 = present as fast as possible (no effect when headless)
+        void setSwapInterval(int interval);
+        // the context is current on one thread at a time: release it on the
+        // old thread before making it current on the new one
+        void makeContextCurrent();
+        void releaseContext();
+        // second context sharing buffers and textures (not vertex arrays) with
+        // the main one, for a thread that uploads in the background; created
+        // on the thread that created the window, false when the platform
+        // cannot share
+        bool createUploadContext();
+        void makeUploadContextCurrent();
+        void releaseUploadContext();
+        // framebuffer the scene is rendered into (0 for a visible window)
+        GLuint getFramebuffer();
+        // reads back the current frame and writes it as a binary .ppm
+        bool saveScreenshot(const std::string& fileName);
+
     private:
         WindowDimensions dimensions;
         GLFWwindow *window;
+
+        bool headless;
+        bool closeRequested;
+        GLuint framebuffer;
+        GLuint colorRenderbuffer;
+        GLuint depthRenderbuffer;
+        // EGLDisplay / EGLContext / EGLSurface, kept opaque to not leak EGL headers
+        void* eglDisplay;
+        void* eglContext;
+        void* eglSurface;
+        void* eglConfig;
+        // the upload context: a hidden window, or an EGL context and its surface
+        GLFWwindow* uploadWindow;
+        void* eglUploadContext;
+        void* eglUploadSurface;
+
+        bool createEGLContext();
+        void initGLEW();
+        void createFramebuffer(int width, int height);
     };
 }
 
@@ -0,0 +1,210 @@
+#include "World.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    World::World(Scene& scene, ResidencyManager& residency)
+        : scene(scene), residency(residency)
+    {
+        tileSize = 10.0f;
+        height = 0.0f;
+        streamRadius = 2;
+        pass = 0;
+        origin = glm::dvec3(0.0);
+        cameraColumn = 0;
+        cameraRow = 0;
+        cameraTileKnown = false;
+    }
+
+    long long World::Key(int column, int row)
+    {
+        return (long long)(((unsigned long long)(unsigned int)column << 32) | (unsigned int)row);
+    }
+
+    bool World::Load(const std::string& fileName, int pass)
+    {
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cerr << "Could not open world " << fileName << std::endl;
+            return false;
+        }
+
+        this->pass = pass;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream values(line);
+            std::string first;
+            values >> first;
+            if (first == "tile_size") {
+                values >> tileSize;
+                continue;
+            }
+            if (first == "height") {
+                values >> height;
+                continue;
+            }
+            int column = atoi(first.c_str());
+            int row;
+            float yaw;
+            float scale;
+            std::string modelFile;
+            if (!(values >> row >> yaw >> scale >> modelFile)) {
+                std::cerr << fileName << ":" << lineNumber << ": expected column row yaw scale model_file" << std::endl;
+                return false;
+            }
+            AddTile(column, row, yaw, scale, modelFile);
+        }
+        if (tileSize <= 0.0f) {
+            std::cerr << fileName << ": tile_size must be positive" << std::endl;
+            return false;
+        }
+        std::cout << "World " << fileName << ": " << tiles.size() << " tiles, " << models.size() << " models" << std::endl;
+        return !tiles.empty();
+    }
+
+    void World::CreateGrid(const std::string& modelFile, int columns, int rows, float tileSize, float height, float scale, int pass)
+    {
+        this->tileSize = tileSize;
+        this->height = height;
+        this->pass = pass;
+        int firstColumn = -(columns - 1) / 2;
+        int firstRow = -(rows - 1) / 2;
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                AddTile(firstColumn + column, firstRow + row, 0.0f, scale, modelFile);
+            }
+        }
+    }
+
+    void World::AddTile(int column, int row, float yaw, float scale, const std::string& modelFile)
+    {
+        long long key = Key(column, row);
+        if (tileIndex.find(key) != tileIndex.end()) {
+            std::cerr << "World tile " << column << " " << row << " is defined twice, the first one is kept" << std::endl;
+            return;
+        }
+        // models have to be registered before the render thread starts
+        std::unordered_map<std::string, ModelHandle>::iterator model = models.find(modelFile);
+        if (model == models.end()) {
+            model = models.insert(std::make_pair(modelFile, residency.AddModel(modelFile.c_str()))).first;
+        }
+        if (model->second == PLACEHOLDER_MODEL) {
+            return;
+        }
+
+        WorldTile tile;
+        tile.column = column;
+        tile.row = row;
+        tile.yaw = yaw;
+        tile.scale = scale;
+        tile.model = model->second;
+        tile.entity = INVALID_ENTITY;
+        tileIndex[key] = (int)tiles.size();
+        tiles.push_back(tile);
+    }
+
+    void World::SetStreamRadius(int radius)
+    {
+        streamRadius = radius;
+        cameraTileKnown = false;
+    }
+
+    glm::vec3 World::TilePosition(const WorldTile& tile)
+    {
+        glm::dvec3 position(tile.column * (double)tileSize, height, tile.row * (double)tileSize);
+        return ToLocal(position);
+    }
+
+    void World::StreamIn(WorldTile& tile)
+    {
+        tile.entity = scene.CreateEntity(tile.model, pass);
+        scene.SetPosition(tile.entity, TilePosition(tile));
+        scene.SetRotation(tile.entity, glm::angleAxis(glm::radians(tile.yaw), glm::vec3(0.0f, 1.0f, 0.0f)));
+        scene.SetScale(tile.entity, tile.scale);
+    }
+
+    void World::Update(const glm::vec3& cameraPosition)
+    {
+        glm::dvec3 camera = ToWorld(cameraPosition);
+        int column = (int)floor(camera.x / tileSize + 0.5);
+        int row = (int)floor(camera.z / tileSize + 0.5);
+        if (cameraTileKnown && column == cameraColumn && row == cameraRow) {
+            return;
+        }
+        GPS_PROFILE_SCOPE("World::Update");
+        cameraColumn = column;
+        cameraRow = row;
+        cameraTileKnown = true;
+
+        // one extra ring before a tile leaves, so walking along a border does not thrash
+        for (size_t i = 0; i < streamed.size();) {
+            WorldTile& tile = tiles[streamed[i]];
+            if (abs(tile.column - column) > streamRadius + 1 || abs(tile.row - row) > streamRadius + 1) {
+                scene.DestroyEntity(tile.entity);
+                tile.entity = INVALID_ENTITY;
+                streamed[i] = streamed.back();
+                streamed.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+
+        for (int r = row - streamRadius; r <= row + streamRadius; r++) {
+            for (int c = column - streamRadius; c <= column + streamRadius; c++) {
+                std::unordered_map<long long, int>::iterator found = tileIndex.find(Key(c, r));
+                if (found != tileIndex.end() && tiles[found->second].entity == INVALID_ENTITY) {
+                    StreamIn(tiles[found->second]);
+                    streamed.push_back(found->second);
+                }
+            }
+        }
+    }
+
+    glm::vec3 World::Rebase(const glm::vec3& cameraPosition)
+    {
+        float limit = REBASE_TILES * tileSize;
+        if (fabs(cameraPosition.x) < limit && fabs(cameraPosition.z) < limit) {
+            return glm::vec3(0.0f);
+        }
+        // whole tiles, so tile positions stay exact multiples around the new origin
+        double columns = floor(cameraPosition.x / tileSize + 0.5);
+        double rows = floor(cameraPosition.z / tileSize + 0.5);
+        glm::dvec3 delta(columns * tileSize, 0.0, rows * tileSize);
+        origin += delta;
+        glm::vec3 shift = -glm::vec3(delta);
+        scene.ShiftOrigin(shift);
+        return shift;
+    }
+
+    glm::vec3 World::ToLocal(const glm::dvec3& position)
+    {
+        return glm::vec3(position - origin);
+    }
+
+    glm::dvec3 World::ToWorld(const glm::vec3& position)
+    {
+        return origin + glm::dvec3(position);
+    }
+
+    int World::GetTileCount()
+    {
+        return (int)tiles.size();
+    }
+
+    int World::GetStreamedTileCount()
+    {
+        return (int)streamed.size();
+    }
+}
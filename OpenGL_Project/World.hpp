@@ -0,0 +1,95 @@
+#ifndef World_hpp
+#define World_hpp
+
+#include "ResidencyManager.hpp"
+#include "Scene.hpp"
+
+#include "glm/glm.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gps {
+
+    // one cell of the city grid
+    struct WorldTile {
+        int column;
+        int row;
+        // rotation around Y in degrees and uniform scale of the tile's model
+        float yaw;
+        float scale;
+        ModelHandle model;
+        // INVALID_ENTITY while the tile is streamed out
+        Entity entity;
+    };
+
+    // A grid of city tiles streamed around the camera. Tiles within the
+    // stream radius get an entity in the scene; their models are requested
+    // from the residency manager like any other, so they load on the job
+    // system and are evicted under memory pressure. Work is done only when the
+    // camera enters another tile and is bounded by the radius, not by the
+    // size of the world.
+    //
+    // Positions are kept in double precision around a floating origin: the
+    // scene only ever sees positions relative to it, and the origin follows
+    // the camera in whole tiles once it gets REBASE_TILES tiles away.
+    //
+    // Text format, one entry per line (lines starting with # are comments):
+    //   tile_size S         edge of a tile in world units
+    //   height H            world Y of every tile
+    //   column row yaw scale model_file
+    class World
+    {
+    public:
+        static const int REBASE_TILES = 4;
+
+        World(Scene& scene, ResidencyManager& residency);
+
+        bool Load(const std::string& fileName, int pass);
+        // columns x rows copies of one model, centered on tile (0, 0)
+        void CreateGrid(const std::string& modelFile, int columns, int rows, float tileSize, float height, float scale, int pass);
+        // tiles within radius tiles of the camera are kept in the scene
+        void SetStreamRadius(int radius);
+
+        // streams tiles in and out for the camera position (relative to the origin)
+        void Update(const glm::vec3& cameraPosition);
+        // when the camera is far from the origin, moves the origin next to it
+        // and shifts the scene; returns what was added to every relative
+        // position (zero when nothing moved)
+        glm::vec3 Rebase(const glm::vec3& cameraPosition);
+
+        glm::vec3 ToLocal(const glm::dvec3& position);
+        glm::dvec3 ToWorld(const glm::vec3& position);
+
+        int GetTileCount();
+        int GetStreamedTileCount();
+
+    private:
+        Scene& scene;
+        ResidencyManager& residency;
+        std::vector<WorldTile> tiles;
+        // column/row -> index in tiles
+        std::unordered_map<long long, int> tileIndex;
+        // indices of the tiles that currently have an entity
+        std::vector<int> streamed;
+        // model file -> handle, tiles sharing a file share the model
+        std::unordered_map<std::string, ModelHandle> models;
+        float tileSize;
+        float height;
+        int streamRadius;
+        int pass;
+        glm::dvec3 origin;
+        // tile the camera was in at the last Update
+        int cameraColumn;
+        int cameraRow;
+        bool cameraTileKnown;
+
+        void AddTile(int column, int row, float yaw, float scale, const std::string& modelFile);
+        void StreamIn(WorldTile& tile);
+        glm::vec3 TilePosition(const WorldTile& tile);
+        static long long Key(int column, int row);
+    };
+}
+
+#endif /* World_hpp */
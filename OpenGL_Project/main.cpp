@@ -9,35 +9,68 @@
 #include "glm/gtc/type_ptr.hpp" //glm extension for accessing the internal data structure of glm types
 
 #include "Window.h"
+#include "Options.hpp"
 #include "Shader.hpp"
+#include "ShaderPermutations.hpp"
+#include "ShaderCompiler.hpp"
 #include "Camera.hpp"
 #include "Model3D.hpp"
-#include "Skybox.hpp"
+#include "Scene.hpp"
+#include "ResidencyManager.hpp"
+#include "UploadThread.hpp"
+#include "World.hpp"
+#include "SimdMath.hpp"
+#include "SkyBox.hpp"
+#include "UniformBuffer.hpp"
+#include "StreamBuffer.hpp"
+#include "Stats.hpp"
+#include "Benchmark.hpp"
+#include "CameraPath.hpp"
+#include "InputRecorder.hpp"
+#include "Profiler.hpp"
+#include "GpuTimer.hpp"
+#include "Overlay.hpp"
+#include "LoadReport.hpp"
+#include "AllocTracker.hpp"
+#include "SimulationClock.hpp"
+#include "FramePipeline.hpp"
+#include "JobSystem.hpp"
+#include "JobBenchmark.hpp"
+#include "FileSystem.hpp"
 
 #include <iostream>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+
+// command-line options
+gps::Options options;
 
 // window
 gps::Window myWindow;
 GLFWwindow* window = NULL;
+// framebuffer size reported by the resize callback
 int retina_width, retina_height;
 
-// matrices
-glm::mat4 model;
+// matrices of the frame being drawn (render thread)
 glm::mat4 view;
 glm::mat4 projection;
-glm::mat3 normalMatrix;
 
 // light parameters
 glm::vec3 lightDir;
 glm::vec3 lightColor;
 
-// shader uniform locations
-GLuint modelLoc;
-GLuint viewLoc;
-GLuint projectionLoc;
-GLuint normalMatrixLoc;
-GLuint lightDirLoc;
-GLuint lightColorLoc;
+// uniform buffers
+gps::UniformBuffer frameUniforms;
+gps::FrameData frameData;
+
+// one ObjectData slot per draw item, streamed through a triple-buffered ring
+const int MAX_DRAW_ITEMS = 4096;
+gps::StreamBuffer objectStream;
+GLintptr objectOffsets[MAX_DRAW_ITEMS];
 
 // camera
 gps::Camera myCamera(
@@ -45,39 +78,128 @@ gps::Camera myCamera(
     glm::vec3(0.0f, 0.0f, -10.0f),
     glm::vec3(0.0f, 1.0f, 0.0f));
 
-GLfloat cameraSpeed = 0.1f;
+// motion rates per second, applied once per simulation tick
+const float CAMERA_SPEED = 6.0f;
+const float LIGHT_ROTATION_SPEED = 60.0f;
+const float ALIEN_SPEED = 4.2f;
+const float FREIGHTER_SPEED = 6.0f;
+const float TRANSPORT_ROTATION_SPEED = 12.0f;
+const float SHOW_ROTATION_SPEED = 60.0f;
+const float SHOW_CLIMB_SPEED = 3.0f;
 
 GLboolean pressedKeys[1024];
 int sceneMode = 0;
 
-//fog
+//fog (selects the FOG variant of the basic shader)
 int putFog = 0;
 
-
-// models
-gps::Model3D city;
-gps::Model3D dissapearingCombatJet;
-gps::Model3D freighter;
-gps::Model3D transportShuttle;
-gps::Model3D grass;
-gps::Model3D ufo;
-gps::Model3D alien;
+// performance HUD toggle (H)
+bool showOverlay = false;
+
+
+// entities and the models they draw
+gps::Scene scene;
+// world matrices recomputed by the last UpdateWorldMatrices
+int transformsUpdated = 0;
+
+// every model of the scene besides the city tiles; loaded on the job system, uploaded by the render thread
+enum SCENE_MODEL { ALIEN_MODEL, UFO_MODEL, GRASS_MODEL, JET_MODEL, FREIGHTER_MODEL, SHUTTLE_MODEL, MODEL_COUNT };
+struct ModelFile {
+    const char* fileName;
+    gps::ModelHandle model;
+};
+ModelFile modelFiles[MODEL_COUNT] = {
+    { "models/alien/elite_static.obj", -1 },
+    { "models/ufo/ufo.obj", -1 },
+    { "models/grass/grass.obj", -1 },
+    { "models/combat_jet/Futuristic_combat_jet.obj", -1 },
+    { "models/freigther/Freigther_BI_Export.obj", -1 },
+    { "models/transport_shuttle/TransportShuttle_obj.obj", -1 },
+};
+// loads the models on demand and keeps them within the memory budgets
+gps::ResidencyManager residency(scene);
+// copies streamed models to the GPU on a shared context, off the render thread
+gps::UploadThread uploadThread;
+
+// city tiles streamed around the camera; without --world, a grid of copies of the original city
+gps::World world(scene, residency);
+const char* CITY_MODEL_FILE = "models/city/Nimbasa.obj";
+// everything the application reads at run time, cooked by --pack
+const char* ASSET_DIRECTORIES[] = { "models", "textures", "shaders" };
+const float CITY_TILE_SIZE = 12.0f;
+const float CITY_HEIGHT = -1.0f;
+const float CITY_SCALE = 1 / 10000.0f;
+
+// entities driven by the keyboard
+gps::Entity freighterEntity = gps::INVALID_ENTITY;
+gps::Entity alienEntity = gps::INVALID_ENTITY;
+gps::Entity jetEntity = gps::INVALID_ENTITY;
+// the freighter and the alien wrap around between these
+const float FREIGHTER_MIN_X = -3.9f;
+const float FREIGHTER_MAX_X = 3.9f;
+const float ALIEN_MIN_Y = -1.0f;
+const float ALIEN_MAX_Y = 0.9f;
 
 GLfloat angle;
-GLfloat angleTransport;
-
-GLfloat freighterXModifier = -3.0f;
-GLfloat alientYModifier = 0.9f;
 
-bool doRenderJet = false;
 bool show = false;
+// presentation mode: climb first, then one full turn around the scene
+float showAngle = 0.0f;
+float showUp = 0.0f;
+
+// fixed-timestep simulation; rendering blends the state of the last two ticks
+gps::SimulationClock simulationClock;
+struct SimulationState {
+    glm::vec3 cameraPosition;
+    float lightAngle;
+    float showAngle;
+    float showUp;
+};
+SimulationState previousState;
+SimulationState renderState;
 
 // skybox
 gps::SkyBox skyBox;
 
 // shaders
+gps::ShaderPermutations basicShaderVariants;
+// currently selected variant of the basic shader
 gps::Shader myBasicShader;
 gps::Shader skyboxShader;
+// builds the programs while the models load
+gps::ShaderCompiler shaderCompiler;
+
+// per-pass GPU timings, read back a few frames late
+gps::GpuTimer gpuTimer;
+
+// the simulation hands one packet per frame to the render thread, which owns
+// the GL context until the main loop ends (--single-thread draws it in place)
+gps::FramePipeline framePipeline;
+std::thread renderThread;
+// set by the render thread when --assert-no-alloc fails
+std::atomic<bool> renderFailed(false);
+// state the render thread last applied from a packet
+int appliedSceneMode = 0;
+int appliedFog = -1;
+int viewportWidth = 0, viewportHeight = 0;
+
+// performance HUD (H), fed from the stats registry and the timers
+gps::Overlay overlay;
+long long lastFrameStart = -1;
+float lastFrameMs = 0.0f;
+float lastCpuMs = 0.0f;
+
+// benchmark mode
+gps::Benchmark benchmark;
+gps::CameraPath cameraPath;
+// interactive camera recording (--record-path)
+gps::CameraPath recordedPath;
+std::chrono::high_resolution_clock::time_point recordStart;
+float lastRecordedTime = -1.0f;
+// input logs (--record-input / --replay-input), stamped with the simulation tick
+gps::InputRecorder inputRecorder;
+gps::InputReplay inputReplay;
+unsigned int frameCount = 0;
 
 GLenum glCheckError_(const char* file, int line)
 {
@@ -115,21 +237,25 @@ GLenum glCheckError_(const char* file, int line)
 
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
     fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
-    //TODO
+    // the viewport and projection follow on the render thread with the next frame packet
     glfwGetFramebufferSize(window, &retina_width, &retina_height);
-    myBasicShader.useShaderProgram();
-    //set projection matrix
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)retina_width / (float)retina_height, 0.1f, 1000.0f);
-    //send matrix data to shader
-    GLint projLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    //set Viewport transform
-    glViewport(0, 0, retina_width, retina_height);
 }
 
-void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+// seconds since the main loop started, shared by the camera and input recorders
+float sessionTime() {
+    std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - recordStart;
+    return elapsed.count();
+}
+
+// key handling shared by the live callback and the input replay
+void handleKey(int key, int /*scancode*/, int action, int /*mode*/) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GL_TRUE);
+        myWindow.setShouldClose(true);
+    }
+
+    // dump the profile collected so far
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        gps::Profiler::WriteTrace(options.tracePath.empty() ? "trace.json" : options.tracePath);
     }
 
     if (key >= 0 && key < 1024) {
@@ -146,7 +272,7 @@ double pitch = 0.0f;
 double yaw = -90.0f;
 double lastX = 512, lastY = 384;
 
-void mouseCallback(GLFWwindow* window, double xpos, double ypos)
+void handleCursor(double xpos, double ypos)
 {
     float xoffset = xpos - lastX;
     float yoffset = lastY - ypos;
@@ -167,142 +293,127 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos)
         pitch = -89.0f;
     }
 
+    // the view matrix is rebuilt from the camera once per frame in renderScene
     myCamera.rotate(pitch, yaw);
-    view = myCamera.getViewMatrix();
+}
 
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    // compute normal matrix 
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+    inputRecorder.RecordKey(simulationClock.GetTickIndex(), sessionTime(), key, scancode, action, mode);
+    // while replaying only escape still reaches the application
+    if (inputReplay.IsActive() && key != GLFW_KEY_ESCAPE) {
+        return;
+    }
+    handleKey(key, scancode, action, mode);
 }
 
-void processMovement() {
-    if (pressedKeys[GLFW_KEY_W]) {
-        myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
+void mouseCallback(GLFWwindow* window, double xpos, double ypos)
+{
+    inputRecorder.RecordCursor(simulationClock.GetTickIndex(), sessionTime(), xpos, ypos);
+    if (inputReplay.IsActive()) {
+        return;
+    }
+    handleCursor(xpos, ypos);
+}
 
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+// defines of the basic shader variant matching the current feature switches
+std::vector<std::string> basicShaderDefines(int fog) {
+    std::vector<std::string> defines;
+    defines.push_back("CLAMP_NEAR_BLACK");
+    if (fog == 1) {
+        defines.push_back("FOG");
     }
+    return defines;
+}
 
-    if (pressedKeys[GLFW_KEY_S]) {
-        myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
+// switches to the precompiled variant instead of setting a uniform
+void selectBasicShader(int fog) {
+    myBasicShader = basicShaderVariants.Get(basicShaderDefines(fog));
+    appliedFog = fog;
+}
 
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+// applies the held keys for one simulation tick of deltaTime seconds
+void processMovement(float deltaTime) {
+    GPS_PROFILE_SCOPE("processMovement");
+    float cameraStep = CAMERA_SPEED * deltaTime;
+    if (pressedKeys[GLFW_KEY_W]) {
+        myCamera.move(gps::MOVE_FORWARD, cameraStep);
     }
 
-    if (pressedKeys[GLFW_KEY_A]) {
-        myCamera.move(gps::MOVE_LEFT, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
+    if (pressedKeys[GLFW_KEY_S]) {
+        myCamera.move(gps::MOVE_BACKWARD, cameraStep);
+    }
 
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        // compute normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+    if (pressedKeys[GLFW_KEY_A]) {
+        myCamera.move(gps::MOVE_LEFT, cameraStep);
     }
 
     if (pressedKeys[GLFW_KEY_D]) {
-        myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
-        //update view matrix
-        view = myCamera.getViewMatrix();
-
-        myBasicShader.useShaderProgram();
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-        // compute normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+        myCamera.move(gps::MOVE_RIGHT, cameraStep);
     }
 
-    // rotate the light source
+    // rotate the light source (applied to lightDir in updateFrameUniforms)
     if (pressedKeys[GLFW_KEY_Q]) {
-        angle -= 1.0f;
-        // update model matrix 
-        model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-        // update normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+        angle -= LIGHT_ROTATION_SPEED * deltaTime;
     }
 
     // rotate the light source
     if (pressedKeys[GLFW_KEY_E]) {
-        angle += 1.0f;
-        // update model matrix 
-        model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0, 1, 0));
-        // update normal matrix 
-        normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
+        angle += LIGHT_ROTATION_SPEED * deltaTime;
     }
 
-    // move the alien to the ground
+    // move the alien to the ground (the wrap limits are in world coordinates)
+    glm::vec3 alienPosition = glm::vec3(world.ToWorld(scene.GetPosition(alienEntity)));
     if (pressedKeys[GLFW_KEY_Z]) {
-        alientYModifier -= 0.07f;
-        if (alientYModifier < -1.0f)
-            alientYModifier = 0.9f;
+        alienPosition.y -= ALIEN_SPEED * deltaTime;
+        if (alienPosition.y < ALIEN_MIN_Y)
+            alienPosition.y = ALIEN_MAX_Y;
     }
 
     // move the alien back into the ship
     if (pressedKeys[GLFW_KEY_X]) {
-        alientYModifier += 0.07f;
-        if (alientYModifier > 0.9f)
-            alientYModifier = -1.0f;
+        alienPosition.y += ALIEN_SPEED * deltaTime;
+        if (alienPosition.y > ALIEN_MAX_Y)
+            alienPosition.y = ALIEN_MIN_Y;
     }
+    scene.SetPosition(alienEntity, world.ToLocal(glm::dvec3(alienPosition)));
 
     // move the freighter
+    glm::vec3 freighterPosition = glm::vec3(world.ToWorld(scene.GetPosition(freighterEntity)));
     if (pressedKeys[GLFW_KEY_U]) {
-        freighterXModifier -= 0.1f;
-        if (freighterXModifier < -3.9f)
-            freighterXModifier = 3.9f;
+        freighterPosition.x -= FREIGHTER_SPEED * deltaTime;
+        if (freighterPosition.x < FREIGHTER_MIN_X)
+            freighterPosition.x = FREIGHTER_MAX_X;
     }
 
     // move the freighter
     if (pressedKeys[GLFW_KEY_I]) {
-        freighterXModifier += 0.1f;
-        if (freighterXModifier > 3.9f)
-            freighterXModifier = -3.9f;
+        freighterPosition.x += FREIGHTER_SPEED * deltaTime;
+        if (freighterPosition.x > FREIGHTER_MAX_X)
+            freighterPosition.x = FREIGHTER_MIN_X;
     }
+    scene.SetPosition(freighterEntity, world.ToLocal(glm::dvec3(freighterPosition)));
 
     // make the jet appear / dissapear
     if (pressedKeys[GLFW_KEY_M]) {
-        doRenderJet = !doRenderJet;
+        scene.SetVisible(jetEntity, !scene.IsVisible(jetEntity));
         pressedKeys[GLFW_KEY_M] = false;
     }
 
-    // visualize the 3 modes
+    // visualize the 3 modes (applied by applySceneMode on the render thread)
     if (pressedKeys[GLFW_KEY_G]) {
         sceneMode += 1;
-        switch (sceneMode) {
-        case 0:
-            // solid mode;
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            break;
-        case 1:
-            // wireframe objects;
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            break;
-        case 2:
-            // polygonal and smooth;
-            glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-            break;
-        case 3:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glEnable(GL_POLYGON_SMOOTH);
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA);
-            break;
-        }
         if (sceneMode == 3) {
             sceneMode = -1;
         }
         pressedKeys[GLFW_KEY_G] = false;
     }
 
+    // show / hide the performance HUD
+    if (pressedKeys[GLFW_KEY_H]) {
+        showOverlay = !showOverlay;
+        pressedKeys[GLFW_KEY_H] = false;
+    }
+
     // visualize the entire scene using animation (enter show mode)
     if (pressedKeys[GLFW_KEY_C]) {
         if (show)
@@ -315,24 +426,30 @@ void processMovement() {
     //enable fog option
     if (pressedKeys[GLFW_KEY_F]) {
         putFog = 1;
-        myBasicShader.useShaderProgram();       
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "putFog"), putFog);
-        
     }
     
     //disable fog option
     if (pressedKeys[GLFW_KEY_V]) {
         putFog = 0;
-        myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "putFog"), putFog);
     }
 }
 
 void initOpenGLWindow() {
-    myWindow.Create(1024, 768, "OpenGL Project");
+    if (options.headless) {
+        myWindow.CreateHeadless(options.width, options.height);
+    }
+    else {
+        myWindow.Create(options.width, options.height, "OpenGL Project");
+        // the fixed-timestep simulation keeps motion speed independent of this
+        myWindow.setSwapInterval(options.vsync ? 1 : 0);
+    }
 }
 
 void setWindowCallbacks() {
+    // a headless context has no window and therefore no input
+    if (myWindow.getWindow() == NULL || myWindow.isHeadless()) {
+        return;
+    }
     glfwSetWindowSizeCallback(myWindow.getWindow(), windowResizeCallback);
     glfwSetKeyCallback(myWindow.getWindow(), keyboardCallback);
     glfwSetCursorPosCallback(myWindow.getWindow(), mouseCallback);
@@ -340,7 +457,9 @@ void setWindowCallbacks() {
 
 void initOpenGLState() {
     glClearColor(0.7f, 0.7f, 0.7f, 1.0f);
-    glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+    retina_width = viewportWidth = myWindow.getWindowDimensions().width;
+    retina_height = viewportHeight = myWindow.getWindowDimensions().height;
+    glViewport(0, 0, viewportWidth, viewportHeight);
     glEnable(GL_FRAMEBUFFER_SRGB);
     glEnable(GL_DEPTH_TEST); // enable depth-testing
     glDepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
@@ -349,14 +468,27 @@ void initOpenGLState() {
     glFrontFace(GL_CCW); // GL_CCW for counter clock-wise
 }
 
-void initModels() {
-    city.LoadModel("models/city/Nimbasa.obj");
-    alien.LoadModel("models/alien/elite_static.obj");
-    ufo.LoadModel("models/ufo/ufo.obj");
-    grass.LoadModel("models/grass/grass.obj");
-    dissapearingCombatJet.LoadModel("models/combat_jet/Futuristic_combat_jet.obj");
-    freighter.LoadModel("models/freigther/Freigther_BI_Export.obj");
-    transportShuttle.LoadModel("models/transport_shuttle/TransportShuttle_obj.obj");
+// registers the models with the residency manager; they stream in once they
+// are seen, or load right here with --preload. The skybox is always loaded
+bool initModels() {
+    GPS_PROFILE_SCOPE("initModels");
+    residency.SetBudget((unsigned long long)options.cpuBudgetMB * 1024 * 1024,
+        (unsigned long long)options.gpuBudgetMB * 1024 * 1024, options.loadDistance);
+    // preloaded models keep every level, a steady scene is the point of --preload
+    residency.SetMipStreaming(options.mipStreaming && !options.preload);
+    for (int i = 0; i < MODEL_COUNT; i++) {
+        modelFiles[i].model = residency.AddModel(modelFiles[i].fileName);
+    }
+    if (!options.worldPath.empty()) {
+        if (!world.Load(options.worldPath, gps::GPU_PASS_CITY)) {
+            return false;
+        }
+    }
+    else {
+        world.CreateGrid(CITY_MODEL_FILE, options.worldGrid, options.worldGrid, CITY_TILE_SIZE, CITY_HEIGHT, CITY_SCALE, gps::GPU_PASS_CITY);
+    }
+    world.SetStreamRadius(options.streamRadius);
+
     std::vector<const GLchar*> faces;
     faces.push_back("textures/skybox/right.tga");
     faces.push_back("textures/skybox/left.tga");
@@ -364,236 +496,699 @@ void initModels() {
     faces.push_back("textures/skybox/bottom.tga");
     faces.push_back("textures/skybox/back.tga");
     faces.push_back("textures/skybox/front.tga");
+    // the models load on the job system while the skybox is decoded here
+    if (options.preload) {
+        residency.StartPreload();
+    }
    skyBox.Load(faces);
+
+    if (options.preload) {
+        // help with the loads, finishing every program the driver is done with between jobs
+        while (residency.IsLoading()) {
+            shaderCompiler.Poll();
+            if (gps::JobSystem::RunPending(1) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        if (!residency.FinishPreload()) {
+            return false;
+        }
+    }
+    shaderCompiler.Poll();
+    // models streamed in from now on, and preloaded ones loaded again after an eviction
+    if (!options.syncUploads && uploadThread.Start(myWindow)) {
+        residency.SetUploadThread(&uploadThread);
+    }
+    return true;
+}
+
+// adds an entity drawing one of the scene models, placed with a translate * rotate * scale transform
+gps::Entity addEntity(SCENE_MODEL model, gps::GPU_PASS pass, const glm::vec3& position, float scale,
+    float angle = 0.0f, const glm::vec3& axis = glm::vec3(0.0f, 1.0f, 0.0f)) {
+    gps::Entity entity = scene.CreateEntity(modelFiles[model].model, pass);
+    scene.SetPosition(entity, position);
+    scene.SetRotation(entity, glm::angleAxis(glm::radians(angle), axis));
+    scene.SetScale(entity, scale);
+    return entity;
 }
 
-void initShaders() {
-    myBasicShader.loadShader(
+// the objects of the city, each an entity in the scene store
+void initScene() {
+    addEntity(GRASS_MODEL, gps::GPU_PASS_GRASS, glm::vec3(0.0f, -1.0f, 0.0f), 1 / 20.0f, 90.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+
+    // the shuttle circles the city
+    gps::Entity shuttle = addEntity(SHUTTLE_MODEL, gps::GPU_PASS_VEHICLES, glm::vec3(-1.0f, 0.0f, -5.0f), 1 / 30.0f);
+    scene.AddOrbit(shuttle, glm::vec3(-1.0f, 0.0f, -5.0f), 0.0f, TRANSPORT_ROTATION_SPEED);
+
+    freighterEntity = addEntity(FREIGHTER_MODEL, gps::GPU_PASS_VEHICLES, glm::vec3(-3.0f, 0.0f, -2.0f), 1 / 20.0f, 90.0f);
+    jetEntity = addEntity(JET_MODEL, gps::GPU_PASS_VEHICLES, glm::vec3(0.6f, -0.7f, -1.8f), 1 / 25.0f);
+    scene.SetVisible(jetEntity, false);
+    addEntity(UFO_MODEL, gps::GPU_PASS_VEHICLES, glm::vec3(2.7f, 1.4f, 0.0f), 1 / 230.0f, 270.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+    alienEntity = addEntity(ALIEN_MODEL, gps::GPU_PASS_VEHICLES, glm::vec3(2.7f, 0.9f, 0.0f), 1 / 330.0f, 270.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+}
+
+// starts compiling every program; finishShaders waits for them after the models are loaded
+void submitShaders() {
+    gps::ShaderCompiler::EnableParallelCompile();
+
+    basicShaderVariants.Init(
         "shaders/basic.vert",
         "shaders/basic.frag");
-    skyboxShader.loadShader(
+    // compile every variant the toggles can reach before the first frame
+    basicShaderVariants.Submit(shaderCompiler, basicShaderDefines(0));
+    basicShaderVariants.Submit(shaderCompiler, basicShaderDefines(1));
+    shaderCompiler.Submit(&skyboxShader,
         "shaders/skyboxShader.vert",
-        "shaders/skyboxShader.frag");
+        "shaders/skyboxShader.frag",
+        std::vector<std::string>());
 }
 
-void initUniforms() {
-    myBasicShader.useShaderProgram();
+void finishShaders() {
+    GPS_PROFILE_SCOPE("finishShaders");
+    // only the programs initModels did not see finish are waited for
+    shaderCompiler.WaitAll();
+    selectBasicShader(putFog);
+}
 
-    
-    modelLoc = glGetUniformLocation(myBasicShader.shaderProgram, "model");
+// vertical field of view, in degrees
+const float FIELD_OF_VIEW = 45.0f;
+
+// same near/far planes at startup and after every resize
+glm::mat4 buildProjection(int width, int height) {
+    return glm::perspective(glm::radians(FIELD_OF_VIEW), (float)width / (float)height, 0.1f, 20.0f);
+}
 
+void initUniforms() {
     // get view matrix for current camera
     view = myCamera.getViewMatrix();
-    viewLoc = glGetUniformLocation(myBasicShader.shaderProgram, "view");
-    // send view matrix to shader
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    // compute normal matrix
-    normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-    normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
 
     // create projection matrix
-    projection = glm::perspective(glm::radians(45.0f),
-        (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
-        0.1f, 20.0f);
-    projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-    // send projection matrix to shader
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    projection = buildProjection(viewportWidth, viewportHeight);
 
     //set the light direction (direction towards the light)
     lightDir = glm::vec3(0.0f, 1.0f, 1.0f);
-    lightDirLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDir");
-    // send light dir to shader
-    glUniform3fv(lightDirLoc, 1, glm::value_ptr(lightDir));
 
     //set light color
     lightColor = glm::vec3(1.0f, 1.0f, 1.0f); //white light
-    lightColorLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightColor");
-    // send light color to shader
-    glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
 
+    // per-frame block, shared by both programs
+    frameUniforms.Create(sizeof(gps::FrameData));
+    frameUniforms.BindBase(gps::FRAME_DATA_BINDING);
 
-    //SKYBOX SHADER
-    skyboxShader.useShaderProgram();
+    // per-object block, one aligned slot for each scene object per frame in flight
+    objectStream.Create(GL_UNIFORM_BUFFER, gps::UniformBuffer::AlignSize(sizeof(gps::ObjectData)) * MAX_DRAW_ITEMS, 3);
 
-    modelLoc = glGetUniformLocation(skyboxShader.shaderProgram, "model");
+    basicShaderVariants.BindUniformBlock("FrameData", gps::FRAME_DATA_BINDING);
+    basicShaderVariants.BindUniformBlock("ObjectData", gps::OBJECT_DATA_BINDING);
+    skyboxShader.bindUniformBlock("FrameData", gps::FRAME_DATA_BINDING);
 
-    // get view matrix for current camera
-    view = myCamera.getViewMatrix();
-    viewLoc = glGetUniformLocation(skyboxShader.shaderProgram, "view");
-    // send view matrix to shader
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    // create projection matrix
-    projection = glm::perspective(glm::radians(45.0f),
-        (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
-        0.1f, 20.0f);
-    projectionLoc = glGetUniformLocation(skyboxShader.shaderProgram, "projection");
-    // send projection matrix to shader
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
+    gpuTimer.Create();
+    overlay.Create("shaders/overlay.vert", "shaders/overlay.frag");
 }
 
+// computes the per-frame block from the packet's view and the projection and uploads it
+void updateFrameUniforms(const gps::FramePacket& packet) {
+    GPS_PROFILE_SCOPE("updateFrameUniforms");
+    frameData.view = view;
+    frameData.projection = projection;
+    frameData.skyboxViewProjection = projection * glm::mat4(glm::mat3(view));
+    frameData.lightDir = glm::vec4(glm::normalize(packet.lightDir), 0.0f);
+    frameData.cameraPosition = glm::inverse(view)[3];
+    frameData.lightColor = glm::vec4(lightColor, 1.0f);
+
+    frameUniforms.Update(0, sizeof(gps::FrameData), &frameData);
+}
 
-void renderCity(gps::Shader shader) {
-    shader.useShaderProgram();
+// writes the ObjectData slot of a draw item into the stream buffer; world and
+// normal matrices come from the scene, only the MVP changes with the camera
+void setObjectData(int object, const gps::DrawItem& item, const glm::mat4& viewProjection) {
+    gps::ObjectData data;
+    data.model = item.world;
+    gps::SimdMath::Multiply(viewProjection, item.world, data.modelViewProjection);
+    data.normalMatrix = item.normalMatrix;
+
+    // the mapping may be write-combined, so store the slot in one go and never read it back
+    void* slot = objectStream.Allocate(sizeof(gps::ObjectData), &objectOffsets[object]);
+    if (slot != NULL) {
+        memcpy(slot, &data, sizeof(gps::ObjectData));
+    }
+}
 
-    // create model matrix
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(1 / 10000.0f, 1 / 10000.0f, 1 / 10000.0f));
+// binds the ObjectData slot of a draw item before drawing it
+void bindObjectData(int object) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, gps::OBJECT_DATA_BINDING, objectStream.GetId(), objectOffsets[object], sizeof(gps::ObjectData));
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// writes the ObjectData slot of every draw item in the packet for this frame
+void updateObjectUniforms(const gps::FramePacket& packet) {
+    GPS_PROFILE_SCOPE("updateObjectUniforms");
+    objectStream.BeginFrame();
+    glm::mat4 viewProjection = projection * view;
+    for (int i = 0; i < packet.drawCount; i++) {
+        setObjectData(i, packet.drawItems[i], viewProjection);
+    }
+    objectStream.FinishWrites();
+}
 
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+void renderSkyBox(const gps::Shader& shader) {
+    GPS_PROFILE_SCOPE("renderSkyBox");
+    // view and projection come from the FrameData block
+    skyBox.Draw(shader);
+}
 
-    city.Draw(shader);
+// draws the items of one pass, starting at first; returns the first item of the next pass
+int renderPass(const gps::Shader& shader, const gps::FramePacket& packet, int pass, int first) {
+    int item = first;
+    while (item < packet.drawCount && packet.drawItems[item].pass == pass) {
+        shader.useShaderProgram();
+        bindObjectData(item);
+        if (packet.drawItems[item].model == gps::PLACEHOLDER_MODEL) {
+            residency.DrawPlaceholder(shader);
+        }
+        else {
+            scene.GetModel(packet.drawItems[item].model)->Draw(shader);
+        }
+        item++;
+    }
+    return item;
 }
 
-void renderTransportShuttle(gps::Shader shader) {
-    shader.useShaderProgram();
+// advances the presentation mode by one tick
+void updateShowMode(float deltaTime) {
+    if (!show) {
+        return;
+    }
+    // we check if we reached a desired position with the camera
+    if (showUp < -1.0f) {
+        // circling the scene
+        showAngle += SHOW_ROTATION_SPEED * deltaTime;
+        // after a full turn the presentation mode is over and the values are reinitialized
+        if (showAngle >= 360.0f) {
+            show = false;
+            showAngle = 0.0f;
+            showUp = 0.0f;
+        }
+    }
+    else {
+        // if not, we keep moving the camera up until it reaches a point where it stops
+        showUp -= SHOW_CLIMB_SPEED * deltaTime;
+    }
+}
 
-    // create model matrix
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(angleTransport), glm::vec3(0.0f, 1.0f, 0.0f));
-      model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -5.0f));
-      model = glm::scale(model, glm::vec3(1 / 30.0f, 1 / 30.0f, 1 / 30.0f));
+// view matrix of the camera placed between the last two ticks
+glm::mat4 computeViewMatrix() {
+    gps::Camera renderCamera = myCamera;
+    renderCamera.setPosition(renderState.cameraPosition);
+    glm::mat4 viewMatrix = renderCamera.getViewMatrix();
+    // if the presentation mode is requested
+    if (show) {
+        if (renderState.showUp < -1.0f) {
+            // the view will rotate on the Y axis -> circling the scene
+            // around the city centre, which moves away from (0, 0, 0) after a rebase
+            glm::vec3 center = world.ToLocal(glm::dvec3(0.0));
+            viewMatrix = glm::translate(viewMatrix, center + glm::vec3(0, -1.0f, 0));
+            viewMatrix = glm::rotate(viewMatrix, glm::radians(renderState.showAngle), glm::vec3(0, 1, 0));
+            viewMatrix = glm::translate(viewMatrix, -center);
+        }
+        else {
+            // translating the camera on the Y axis -> move above the ground
+            viewMatrix = glm::translate(viewMatrix, glm::vec3(0, renderState.showUp, 0));
+        }
+    }
+    return viewMatrix;
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// fills the packet the render thread draws next from the interpolated state
+void buildFramePacket(gps::FramePacket& packet, long long simulationStart) {
+    GPS_PROFILE_SCOPE("buildFramePacket");
+    packet.frameIndex = frameCount;
+    packet.view = computeViewMatrix();
+    // rotate the light source around the Y axis
+    packet.lightDir = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(renderState.lightAngle), glm::vec3(0, 1, 0)) * glm::vec4(lightDir, 0.0f));
+    // cull with the projection the render thread will use for this size
+    glm::mat4 cullProjection = retina_width > 0 && retina_height > 0 ? buildProjection(retina_width, retina_height) : projection;
+    scene.BuildDrawList(cullProjection * packet.view, packet.drawItems, &packet.culledMeshes);
+    // models come and go with what is seen, unloaded ones become placeholders
+    // texture resolution follows the size on screen
+    residency.SetProjectionScale(retina_height / (2.0f * tanf(glm::radians(FIELD_OF_VIEW) * 0.5f)));
+    residency.Update(packet.drawItems, glm::vec3(glm::inverse(packet.view)[3]), packet.frameIndex);
+    packet.residency = residency.GetStats();
+    packet.streamedTiles = world.GetStreamedTileCount();
+    packet.worldTiles = world.GetTileCount();
+    packet.drawCount = (int)packet.drawItems.size();
+    if (packet.drawCount > MAX_DRAW_ITEMS) {
+        packet.drawCount = MAX_DRAW_ITEMS;
+    }
+    packet.fog = putFog;
+    packet.sceneMode = sceneMode;
+    packet.showOverlay = showOverlay;
+    packet.framebufferWidth = retina_width;
+    packet.framebufferHeight = retina_height;
+    packet.simulationMs = (gps::Profiler::Now() - simulationStart) / 1000000.0f;
+    packet.transformsUpdated = transformsUpdated;
+}
 
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+// polygon mode of the G key cycle
+void applySceneMode(int mode) {
+    switch (mode) {
+    case 0:
+        // solid mode;
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        break;
+    case 1:
+        // wireframe objects;
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        break;
+    case 2:
+        // polygonal and smooth;
+        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        break;
+    case -1:
+        // the last mode, stored as -1 so the next press wraps back to 0
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glEnable(GL_POLYGON_SMOOTH);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA);
+        break;
+    }
+    appliedSceneMode = mode;
+}
 
-    transportShuttle.Draw(shader);
+// applies the toggles and the framebuffer size of a packet that changed since the last frame
+void applyPacketState(const gps::FramePacket& packet) {
+    if (packet.sceneMode != appliedSceneMode) {
+        applySceneMode(packet.sceneMode);
+    }
+    if (packet.fog != appliedFog) {
+        selectBasicShader(packet.fog);
+    }
+    overlay.SetVisible(packet.showOverlay);
+    // a minimized window reports an empty framebuffer, keep the last size
+    if (packet.framebufferWidth > 0 && packet.framebufferHeight > 0 &&
+        (packet.framebufferWidth != viewportWidth || packet.framebufferHeight != viewportHeight)) {
+        viewportWidth = packet.framebufferWidth;
+        viewportHeight = packet.framebufferHeight;
+        projection = buildProjection(viewportWidth, viewportHeight);
+        glViewport(0, 0, viewportWidth, viewportHeight);
+    }
 }
 
+void renderScene(const gps::FramePacket& packet) {
+    GPS_PROFILE_SCOPE("renderScene");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-void renderFreighter(gps::Shader shader) {
-    shader.useShaderProgram();
+    //render the scene
+    view = packet.view;
+
+    // upload the shared per-frame data and every object's matrices once
+    updateFrameUniforms(packet);
+    updateObjectUniforms(packet);
+
+    // the draw list is sorted by pass, each pass is timed on the GPU
+    gps::Stats::Add(gps::STAT_CULLED_MESHES, packet.culledMeshes);
+    int item = 0;
+    for (int pass = 0; pass < gps::GPU_PASS_COUNT; pass++) {
+        gpuTimer.BeginPass((gps::GPU_PASS)pass);
+        if (pass == gps::GPU_PASS_SKYBOX) {
+            renderSkyBox(skyboxShader);
+        }
+        item = renderPass(myBasicShader, packet, pass, item);
+        gpuTimer.EndPass((gps::GPU_PASS)pass);
+    }
 
-    // create model matrix
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(freighterXModifier, 0.0f, -2.0f));
-    model = glm::scale(model, glm::vec3(1 / 20.0f, 1 / 20.0f, 1 / 20.0f));
-    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    // the GPU owns this frame's object slots until the fence is signaled
+    objectStream.EndFrame();
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// prints last frame's counters and timings over the scene
+void renderOverlay(const gps::FramePacket& packet) {
+    if (!overlay.IsVisible()) {
+        return;
+    }
+    GPS_PROFILE_SCOPE("renderOverlay");
+    overlay.Begin(viewportWidth, viewportHeight);
+    overlay.Rect(4.0f, 4.0f, 392.0f, 10 * gps::Overlay::GLYPH_HEIGHT + 8.0f, 0x000000A0);
+
+    char line[128];
+    float y = 8.0f;
+    unsigned int color = 0xFFFFFFFF;
+    snprintf(line, sizeof(line), "frame %6.2f ms  %5.0f fps  cpu %6.2f ms",
+        lastFrameMs, lastFrameMs > 0.0f ? 1000.0f / lastFrameMs : 0.0f, lastCpuMs);
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "sim %6.2f ms  waited sim %.2f render %.2f ms  transforms %d",
+        packet.simulationMs, framePipeline.GetProducerWaitMs(), framePipeline.GetConsumerWaitMs(), packet.transformsUpdated);
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "gpu grass %.2f  sky %.2f  city %.2f  veh %.2f ms",
+        gpuTimer.GetPassMilliseconds(gps::GPU_PASS_GRASS), gpuTimer.GetPassMilliseconds(gps::GPU_PASS_SKYBOX),
+        gpuTimer.GetPassMilliseconds(gps::GPU_PASS_CITY), gpuTimer.GetPassMilliseconds(gps::GPU_PASS_VEHICLES));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "draws %llu  triangles %llu",
+        gps::Stats::GetLastFrame(gps::STAT_DRAW_CALLS), gps::Stats::GetLastFrame(gps::STAT_TRIANGLES));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "meshes %llu visible  %llu culled",
+        gps::Stats::GetLastFrame(gps::STAT_VISIBLE_MESHES), gps::Stats::GetLastFrame(gps::STAT_CULLED_MESHES));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "texture binds %llu  program switches %llu",
+        gps::Stats::GetLastFrame(gps::STAT_TEXTURE_BINDS), gps::Stats::GetLastFrame(gps::STAT_PROGRAM_SWITCHES));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "vram ~%.1f MB buffers  ~%.1f MB textures",
+        gps::Stats::GetMemory(gps::MEMORY_BUFFERS) / (1024.0 * 1024.0), gps::Stats::GetMemory(gps::MEMORY_TEXTURES) / (1024.0 * 1024.0));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "allocations %llu / frame", gps::Stats::GetLastFrame(gps::STAT_ALLOCATIONS));
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+    snprintf(line, sizeof(line), "models %d resident %d loading %d mips  ram %.1f MB  vram %.1f MB  tiles %d / %d",
+        packet.residency.residentModels, packet.residency.loadingModels, packet.residency.mipModels,
+        packet.residency.cpuBytes / (1024.0 * 1024.0), packet.residency.gpuBytes / (1024.0 * 1024.0),
+        packet.streamedTiles, packet.worldTiles);
+    overlay.Print(8.0f, y, line, color);
+    y += gps::Overlay::GLYPH_HEIGHT;
+
+    overlay.FrameGraph(8.0f, y + 4.0f, 384.0f, 2.0f * gps::Overlay::GLYPH_HEIGHT, 33.4f);
+    overlay.End();
+}
 
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+// --assert-no-alloc: once warmed up, the frame loop must not touch the heap on
+// either thread; reports the scopes responsible and returns false when the last
+// frame allocated
+bool checkFrameAllocations(unsigned int completedFrames) {
+    bool clean = true;
+    if (completedFrames > (unsigned int)options.warmupFrames && gps::Stats::GetLastFrame(gps::STAT_ALLOCATIONS) > 0) {
+        printf("Frame %u allocated %llu times:\n", completedFrames - 1, gps::Stats::GetLastFrame(gps::STAT_ALLOCATIONS));
+        gps::AllocTracker::PrintScopes();
+        clean = false;
+    }
+    gps::AllocTracker::ResetScopes();
+    return clean;
+}
 
-    freighter.Draw(shader);
+// loads the camera path to replay and prepares the measurements
+void initBenchmark() {
+    if (options.cameraPath.empty() || !cameraPath.Load(options.cameraPath)) {
+        cameraPath.CreateOrbit(10.0f, 4.0f, 0.3f);
+    }
+    benchmark.Init(options.frames, options.warmupFrames, simulationClock.GetTickSeconds());
+    // vsync would hide the real frame cost
+    myWindow.setSwapInterval(0);
 }
 
+// places the camera on the benchmark path at the current simulated time
+void applyBenchmarkCamera() {
+    float duration = cameraPath.GetDuration();
+    float time = (float)simulationClock.GetSimulationTime();
+    if (duration > 0.0f) {
+        time = fmod(time, duration);
+    }
+    gps::CameraKey key = cameraPath.Sample(time);
+    yaw = key.yaw;
+    pitch = key.pitch;
+    // paths are stored in world coordinates
+    myCamera.setPosition(world.ToLocal(glm::dvec3(key.position)));
+    myCamera.rotate(pitch, yaw);
+}
 
-void renderJet(gps::Shader shader) {
-    shader.useShaderProgram();
+// appends the camera pose to the recorded path a few times per second
+void recordCamera() {
+    float time = sessionTime();
+    if (lastRecordedTime >= 0.0f && time - lastRecordedTime < 0.25f) {
+        return;
+    }
+    gps::CameraKey key;
+    key.time = time;
+    key.position = glm::vec3(world.ToWorld(myCamera.getPosition()));
+    key.yaw = (float)yaw;
+    key.pitch = (float)pitch;
+    recordedPath.AddKey(key);
+    lastRecordedTime = key.time;
+}
 
-    // create model matrix 
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.6f, -0.7f, -1.8f));
-    model = glm::scale(model, glm::vec3(1 / 25.0f, 1 / 25.0f, 1 / 25.0f));
-    model = glm::rotate(model, glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+// the part of the scene the simulation moves
+SimulationState captureState() {
+    SimulationState state;
+    state.cameraPosition = myCamera.getPosition();
+    state.lightAngle = angle;
+    state.showAngle = showAngle;
+    state.showUp = showUp;
+    return state;
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// blends between two ticks, values that wrapped around in between are not blended
+float blendValue(float previous, float current, float alpha, float maxStep) {
+    if (fabs(current - previous) > maxStep) {
+        return current;
+    }
+    return previous + (current - previous) * alpha;
+}
 
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+SimulationState interpolateState(const SimulationState& previous, const SimulationState& current, float alpha) {
+    SimulationState state;
+    state.cameraPosition = glm::distance(previous.cameraPosition, current.cameraPosition) > 1.0f ?
+        current.cameraPosition : glm::mix(previous.cameraPosition, current.cameraPosition, alpha);
+    state.lightAngle = blendValue(previous.lightAngle, current.lightAngle, alpha, 90.0f);
+    state.showAngle = blendValue(previous.showAngle, current.showAngle, alpha, 90.0f);
+    state.showUp = blendValue(previous.showUp, current.showUp, alpha, 1.0f);
+    return state;
+}
 
-    dissapearingCombatJet.Draw(shader);
+// advances everything that moves by one fixed tick
+void simulateTick(float deltaTime) {
+    GPS_PROFILE_SCOPE("simulateTick");
+    // recorded events are replayed before the tick that first saw them live
+    if (inputReplay.IsActive()) {
+        inputReplay.Dispatch(simulationClock.GetTickIndex() - 1, handleKey, handleCursor);
+    }
+    if (options.benchmark && !inputReplay.IsActive()) {
+        // scripted camera, the keyboard and mouse are ignored
+        applyBenchmarkCamera();
+    }
+    else {
+        processMovement(deltaTime);
+    }
+    updateShowMode(deltaTime);
+    scene.UpdateOrbits(deltaTime);
 }
 
-void renderSkyBox(gps::Shader shader) {
-    shader.useShaderProgram();
+// keeps the camera close to the origin, where floats are precise
+void rebaseOrigin() {
+    glm::vec3 shift = world.Rebase(myCamera.getPosition());
+    if (shift != glm::vec3(0.0f)) {
+        myCamera.setPosition(myCamera.getPosition() + shift);
+    }
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-    skyBox.Draw(shader,view, projection);
+// runs the ticks the elapsed time asks for and prepares the state to draw
+void updateSimulation() {
+    if (options.benchmark || myWindow.isHeadless()) {
+        // one tick per frame keeps benchmarks and offscreen captures reproducible
+        simulationClock.AdvanceBy(simulationClock.GetTickSeconds());
+    }
+    else {
+        simulationClock.Advance();
+    }
+    float deltaTime = (float)simulationClock.GetTickSeconds();
+    while (simulationClock.Tick()) {
+        rebaseOrigin();
+        previousState = captureState();
+        scene.BeginTick();
+        simulateTick(deltaTime);
+    }
+    float alpha = (float)simulationClock.GetAlpha();
+    renderState = interpolateState(previousState, captureState(), alpha);
+    world.Update(myCamera.getPosition());
+    transformsUpdated = scene.UpdateWorldMatrices(alpha);
 }
 
+// draws one packet: everything that touches the GL context happens here
+bool renderFrame(const gps::FramePacket& packet) {
+    GPS_PROFILE_SCOPE("Frame");
+    long long frameStart = gps::Profiler::Now();
+    if (lastFrameStart >= 0) {
+        lastFrameMs = (frameStart - lastFrameStart) / 1000000.0f;
+        overlay.AddFrameTime(lastFrameMs);
+    }
+    lastFrameStart = frameStart;
+    gps::Stats::BeginFrame();
+    if (options.assertNoAlloc && !checkFrameAllocations(packet.frameIndex)) {
+        return false;
+    }
+    gpuTimer.BeginFrame();
+    if (options.benchmark) {
+        benchmark.BeginFrame();
+    }
+    applyPacketState(packet);
+    // before drawing: models evicted by this packet are no longer referenced
+    residency.ProcessUploads(packet.frameIndex);
+    renderScene(packet);
+    gpuTimer.EndFrame();
+    renderOverlay(packet);
+    lastCpuMs = (gps::Profiler::Now() - frameStart) / 1000000.0f;
+    if (options.benchmark) {
+        benchmark.EndSubmit();
+    }
+    {
+        GPS_PROFILE_SCOPE("swapBuffers");
+        myWindow.swapBuffers();
+    }
 
-void renderGrass(gps::Shader shader) {
-    shader.useShaderProgram();
+    glCheckError();
 
-    // create model matrix
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(1 / 20.0f, 1 / 20.0f, 1 / 20.0f));
-    model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    grass.Draw(shader);
+    gps::GpuFrameResult gpuResult;
+    while (gpuTimer.PopResult(gpuResult)) {
+        if (options.benchmark) {
+            benchmark.AddGpuPasses(gpuResult);
+        }
+    }
+    if (options.benchmark) {
+        benchmark.EndFrame();
+    }
+    return true;
 }
 
-void renderUFO(gps::Shader shader) {
-    shader.useShaderProgram();
-
-    // create model matrix
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(2.7f, 1.4f, 0.0f));
-    model = glm::scale(model, glm::vec3(1 / 230.0f, 1 / 230.0f, 1 / 230.0f));
-    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    ufo.Draw(shader);
+// takes the next packet from the pipeline and draws it; false once the
+// pipeline is drained or a frame failed, which also stops the simulation
+bool renderNextPacket() {
+    const gps::FramePacket* packet = framePipeline.BeginRead();
+    if (packet == NULL) {
+        return false;
+    }
+    bool rendered = renderFrame(*packet);
+    framePipeline.EndRead();
+    if (!rendered) {
+        renderFailed = true;
+        framePipeline.Stop();
+    }
+    return rendered;
 }
 
-void renderAlien(gps::Shader shader) {
-    shader.useShaderProgram();
-
-    // create model matrix
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(2.7f, alientYModifier, 0.0f));
-    model = glm::scale(model, glm::vec3(1 / 330.0f, 1 / 330.0f, 1 / 330.0f));
-    model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    alien.Draw(shader);
+void renderThreadMain() {
+    gps::Profiler::SetThreadName("Render");
+    myWindow.makeContextCurrent();
+    while (renderNextPacket()) {
+    }
+    // finish the last frame before the main thread takes the context back
+    glFinish();
+    myWindow.releaseContext();
 }
 
-int times = 0;
-float up = 0;
-
-void renderScene() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    //render the scene
-    // initialize the view matrix by taking the current state of the camera
-    view = myCamera.getViewMatrix();
-    // if the presentation mode is requested
-    if (show) {
-        // we check if we reached a desired position with the camera
-        if (up < -1.0f) {
-            // the view will rotate on the Y axis -> circling the scene 
-            view = glm::translate(view, glm::vec3(0, -1.0f, 0));
-            view = glm::rotate(view, glm::radians((float)times++), glm::vec3(0, 1, 0));
-            // after spinning a couple of times -> the presentation mode is over and the values are reinitialized
-            if (times == 360) {
-                show = false;
-                times = 0;
-                up = 0;
-            }
-        }
-        else {
-            // if not, we keep translating the camera on the Y axis -> move above the ground until it reaches a point where it stops
-            up = up - 0.05f;
-            view = glm::translate(view, glm::vec3(0, up, 0));
-        }
+// opens the input logs; a replay drives the scene instead of the live devices
+bool initInput() {
+    if (!options.replayInputPath.empty() && !inputReplay.Load(options.replayInputPath)) {
+        return false;
     }
+    if (!options.recordInputPath.empty() && !inputRecorder.Begin(options.recordInputPath)) {
+        return false;
+    }
+    return true;
+}
 
-    myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    // render all objects
-    renderGrass(myBasicShader);
-    renderSkyBox(skyboxShader);
-    renderTransportShuttle(myBasicShader);
-    renderCity(myBasicShader);
-    renderFreighter(myBasicShader);
-    if (doRenderJet) {
-        renderJet(myBasicShader);
+// prints and writes the load timings; after startup with --preload, else on exit
+void reportLoads() {
+    gps::LoadReport::PrintSummary(5);
+    if (!options.loadReportPath.empty()) {
+        gps::LoadReport::Write(options.loadReportPath);
     }
-    renderUFO(myBasicShader);
-    renderAlien(myBasicShader);
 }
 
 void cleanup() {
+    inputRecorder.End();
+    residency.Shutdown();
+    // after the loads, which may still hand it models
+    if (uploadThread.IsRunning()) {
+        uploadThread.Stop();
+        std::cout << "Upload thread: " << uploadThread.GetUploadCount() << " models, "
+            << uploadThread.GetStagedBytes() / (1024.0 * 1024.0) << " MB staged" << std::endl;
+    }
+    if (!options.preload) {
+        reportLoads();
+    }
+    if (gpuTimer.GetDroppedFrames() > 0) {
+        std::cout << "GPU timer: " << gpuTimer.GetDroppedFrames() << " frames dropped" << std::endl;
+    }
+    gpuTimer.Delete();
+    overlay.Delete();
+    benchmark.Delete();
+    std::cout << "Object stream stalls: " << objectStream.GetStallCount()
+        << " (" << objectStream.GetStallMilliseconds() << " ms)" << std::endl;
+    frameUniforms.Delete();
+    objectStream.Delete();
+    basicShaderVariants.Delete();
+    gps::JobSystem::Shutdown();
+    residency.Delete();
+    scene.Delete();
     myWindow.Delete();
+    // nothing loads any more
+    if (gps::FileSystem::IsMounted()) {
+        std::cout << "Asset reads: " << gps::FileSystem::GetArchiveReads() << " from the archive, "
+            << gps::FileSystem::GetLooseReads() << " loose" << std::endl;
+        gps::FileSystem::Unmount();
+    }
     //cleanup code for your own data
 }
 
+// writes every asset into one archive for the next runs to map, with the
+// small mip levels streamed models start with prebuilt for their textures
+bool packAssets() {
+    std::vector<std::string> directories(ASSET_DIRECTORIES, ASSET_DIRECTORIES + sizeof(ASSET_DIRECTORIES) / sizeof(ASSET_DIRECTORIES[0]));
+    std::vector<std::string> files = gps::FileSystem::ListFiles(directories);
+    std::vector<gps::CookedFile> cooked;
+    for (size_t i = 0; i < files.size(); i++) {
+        size_t dot = files[i].find_last_of('.');
+        std::string extension = dot == std::string::npos ? std::string() : files[i].substr(dot);
+        if (extension != ".obj" && extension != ".glb") {
+            continue;
+        }
+        gps::Model3D model;
+        if (model.Parse(files[i])) {
+            model.CookMipTails(gps::ResidencyManager::MIP_TAIL_SIZE, cooked);
+        }
+    }
+    std::cout << "Prebuilt the mip tails of " << cooked.size() << " textures" << std::endl;
+    return gps::AssetArchive::Cook(options.packPath, files, cooked);
+}
+
+// the archive is optional: without one every asset is read from its loose file
+bool mountArchive() {
+    if (options.archivePath.empty()) {
+        gps::FileSystem::Mount(gps::FileSystem::DEFAULT_ARCHIVE);
+        return true;
+    }
+    if (!gps::FileSystem::Mount(options.archivePath)) {
+        std::cerr << "Could not mount " << options.archivePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, const char* argv[]) {
 
+    if (!gps::parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!options.packPath.empty()) {
+        return packAssets() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (!mountArchive()) {
+        return EXIT_FAILURE;
+    }
+
+    if (options.jobsBench) {
+        std::vector<std::string> files;
+        files.push_back(CITY_MODEL_FILE);
+        for (int i = 0; i < MODEL_COUNT; i++) {
+            files.push_back(modelFiles[i].fileName);
+        }
+        gps::JobBenchmark::Run(files, options.jobs >= 0 ? options.jobs + 1 : 0);
+        return EXIT_SUCCESS;
+    }
+
     try {
         initOpenGLWindow();
     }
@@ -602,26 +1197,116 @@ int main(int argc, const char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    gps::JobSystem::Init(options.jobs);
     initOpenGLState();
-    initModels();
+    // shader compilation overlaps model and texture loading
+    submitShaders();
+    if (!initModels()) {
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    initScene();
+    world.Update(myCamera.getPosition());
     glCheckError();
-    initShaders();
+    finishShaders();
+    if (options.preload) {
+        reportLoads();
+    }
     initUniforms();
     setWindowCallbacks();
 
     glCheckError();
+    if (options.benchmark) {
+        initBenchmark();
+    }
+    if (!initInput()) {
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    recordStart = std::chrono::high_resolution_clock::now();
+    simulationClock.Start(options.tickRate);
+    previousState = captureState();
+    scene.BeginTick();
+
     // application loop
-    while (!glfwWindowShouldClose(myWindow.getWindow())) {
-        processMovement();
-        renderScene();
-        angleTransport+=0.2f;
-        glfwPollEvents();
-        glfwSwapBuffers(myWindow.getWindow());
+    int exitCode = EXIT_SUCCESS;
+    gps::Profiler::SetThreadName("Main");
+    if (!options.singleThread) {
+        // the render thread owns the context until the loop ends
+        myWindow.releaseContext();
+        renderThread = std::thread(renderThreadMain);
+    }
+    while (!myWindow.shouldClose()) {
+        GPS_PROFILE_SCOPE("Simulate");
+        long long simulationStart = gps::Profiler::Now();
+        myWindow.pollEvents();
+        updateSimulation();
+        // waits while the render thread is a whole frame behind
+        gps::FramePacket* packet = framePipeline.BeginWrite();
+        if (packet == NULL) {
+            break;
+        }
+        buildFramePacket(*packet, simulationStart);
+        framePipeline.EndWrite();
+        if (options.singleThread && !renderNextPacket()) {
+            break;
+        }
+
+        if (!options.benchmark && !options.recordPath.empty()) {
+            recordCamera();
+        }
+
+        frameCount++;
+        if (options.frames > 0 && frameCount >= (unsigned int)options.frames) {
+            myWindow.setShouldClose(true);
+        }
+        // without --frames a replay runs exactly as long as its log
+        else if (options.frames <= 0 && inputReplay.IsActive() && inputReplay.IsFinished()) {
+            std::cout << "Input replay finished after " << frameCount << " frames" << std::endl;
+            myWindow.setShouldClose(true);
+        }
+    }
 
-        glCheckError();
+    // the render thread draws the packets still queued, then gives the context back
+    framePipeline.Stop();
+    if (renderThread.joinable()) {
+        renderThread.join();
+        myWindow.makeContextCurrent();
+    }
+    if (renderFailed) {
+        exitCode = EXIT_FAILURE;
+    }
+
+    // the loop ends before the last frame is checked
+    if (options.assertNoAlloc && exitCode == EXIT_SUCCESS) {
+        gps::Stats::BeginFrame();
+        if (checkFrameAllocations(frameCount)) {
+            std::cout << "No heap allocations after frame " << options.warmupFrames << std::endl;
+        }
+        else {
+            exitCode = EXIT_FAILURE;
+        }
+    }
+
+    if (options.benchmark) {
+        benchmark.Finish();
+        benchmark.PrintSummary();
+        if (!options.benchmarkOut.empty()) {
+            benchmark.WriteReport(options.benchmarkOut, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
+        }
+    }
+    if (!options.recordPath.empty()) {
+        recordedPath.Save(options.recordPath);
+    }
+
+    if (!options.screenshotPath.empty()) {
+        myWindow.saveScreenshot(options.screenshotPath);
+    }
+    if (!options.tracePath.empty()) {
+        gps::Profiler::WriteTrace(options.tracePath);
     }
 
     cleanup();
 
-    return EXIT_SUCCESS;
+    return exitCode;
 }
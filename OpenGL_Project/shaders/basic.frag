@@ -1,18 +1,22 @@
 #version 410 core
 
 in vec3 fPosition;
-in vec3 fNormal;
+in vec3 fPosWorld;
+in vec3 fNormalWorld;
 in vec2 fTexCoords;
 
 out vec4 fColor;
 
-//matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat3 normalMatrix;
-//lighting
-uniform vec3 lightDir;
-uniform vec3 lightColor;
+//per-frame data (matrices and lighting)
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 skyboxViewProjection;
+	vec4 lightDir;
+	vec4 cameraPosition;
+	vec4 lightColor;
+};
 // textures
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
@@ -23,33 +27,36 @@ float ambientStrength = 0.2f;
 vec3 diffuse;
 vec3 specular;
 float specularStrength = 0.5f;
-uniform int putFog;
+
+//feature switches are compile-time defines injected by the application:
+//FOG - exponential squared distance fog
+//CLAMP_NEAR_BLACK - snap almost black colors to pure black
 
 
 void computeDirLight()
 {
-    //compute eye space coordinates
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 normalEye = normalize(normalMatrix * fNormal);
+    //world space position and normal come from the vertex shader
+    vec3 normalWorld = normalize(fNormalWorld);
 
-    //normalize light direction
-    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
+    //light direction is already normalized and in world space
+    vec3 lightDirN = lightDir.xyz;
 
-    //compute view direction (in eye coordinates, the viewer is situated at the origin
-    vec3 viewDir = normalize(- fPosEye.xyz);
+    //compute view direction (from the fragment towards the camera)
+    vec3 viewDir = normalize(cameraPosition.xyz - fPosWorld);
 
     //compute ambient light
-    ambient = ambientStrength * lightColor;
+    ambient = ambientStrength * lightColor.rgb;
 
     //compute diffuse light
-    diffuse = max(dot(normalEye, lightDirN), 0.0f) * lightColor;
+    diffuse = max(dot(normalWorld, lightDirN), 0.0f) * lightColor.rgb;
 
     //compute specular light
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    vec3 reflectDir = reflect(-lightDirN, normalWorld);
     float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
-    specular = specularStrength * specCoeff * lightColor;
+    specular = specularStrength * specCoeff * lightColor.rgb;
 }
 
+#ifdef FOG
 float computeFog()
 {
  float fogDensity = 0.004f;
@@ -58,6 +65,7 @@ float computeFog()
 
  return clamp(fogFactor, 0.0f, 1.0f);
 }
+#endif
 
 
 void main() 
@@ -67,20 +75,20 @@ void main()
     //compute final vertex color
     vec3 color = min((ambient + diffuse) * texture(diffuseTexture, fTexCoords).rgb + specular * texture(specularTexture, fTexCoords).rgb, 1.0f);
 
-	float fogFactor = computeFog();
-	vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
-
+#ifdef CLAMP_NEAR_BLACK
 	if (color.r < 0.01f && color.g < 0.01f && color.b < 0.01f)
 	{
 		color.r = 0.0f;
 		color.g = 0.0f;
 		color.b = 0.0f;
 	}
-	
-    if(putFog == 1){
-		fColor = fogColor * (1 - fogFactor) + vec4(color * fogFactor, 1.0f);
-	}
-	else{
-		fColor = vec4(color, 1.0f);
-	}
+#endif
+
+#ifdef FOG
+	float fogFactor = computeFog();
+	vec4 fogColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	fColor = fogColor * (1 - fogFactor) + vec4(color * fogFactor, 1.0f);
+#else
+	fColor = vec4(color, 1.0f);
+#endif
 }
@@ -5,17 +5,34 @@ layout(location=1) in vec3 vNormal;
 layout(location=2) in vec2 vTexCoords;
 
 out vec3 fPosition;
-out vec3 fNormal;
+out vec3 fPosWorld;
+out vec3 fNormalWorld;
 out vec2 fTexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+//per-frame data, shared with the skybox shader
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 skyboxViewProjection;
+	vec4 lightDir;
+	vec4 cameraPosition;
+	vec4 lightColor;
+};
+
+//per-object data, matrices are precomputed on the CPU
+layout(std140) uniform ObjectData
+{
+	mat4 model;
+	mat4 modelViewProjection;
+	mat3 normalMatrix;
+};
 
 void main() 
 {
-	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
+	gl_Position = modelViewProjection * vec4(vPosition, 1.0f);
 	fPosition = vPosition;
-	fNormal = vNormal;
+	fPosWorld = vec3(model * vec4(vPosition, 1.0f));
+	fNormalWorld = normalMatrix * vNormal;
 	fTexCoords = vTexCoords;
 }
@@ -0,0 +1,15 @@
+#version 410 core
+
+in vec2 fTexCoords;
+in vec4 fColor;
+
+out vec4 fColorOut;
+
+// glyph coverage, the last cell is solid for rectangles and graph bars
+uniform sampler2D fontTexture;
+
+void main()
+{
+    float coverage = texture(fontTexture, fTexCoords).r;
+    fColorOut = vec4(fColor.rgb, fColor.a * coverage);
+}
@@ -0,0 +1,19 @@
+#version 410 core
+
+layout(location=0) in vec2 vPosition;
+layout(location=1) in vec2 vTexCoords;
+layout(location=2) in vec4 vColor;
+
+// framebuffer size in pixels, vPosition is in pixels from the top left corner
+uniform vec2 screenSize;
+
+out vec2 fTexCoords;
+out vec4 fColor;
+
+void main()
+{
+    vec2 ndc = vPosition / screenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    fTexCoords = vTexCoords;
+    fColor = vColor;
+}
@@ -3,13 +3,20 @@
 layout (location = 0) in vec3 vertexPosition;
 out vec3 textureCoordinates;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+//per-frame data, shared with the basic shader
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 skyboxViewProjection;
+	vec4 lightDir;
+	vec4 cameraPosition;
+	vec4 lightColor;
+};
 
 void main()
 {
-    vec4 tempPos = projection * view * vec4(vertexPosition, 1.0);
+    vec4 tempPos = skyboxViewProjection * vec4(vertexPosition, 1.0);
     gl_Position = tempPos.xyww;
     textureCoordinates = vertexPosition;
 }